@@ -2,9 +2,12 @@
 #define CHECKER_HPP
 
 #include <stack>
+#include <unordered_set>
 
 #include "nemesis/analysis/type.hpp"
 #include "nemesis/analysis/environment.hpp"
+#include "nemesis/analysis/dependencies.hpp"
+#include "nemesis/analysis/statistics.hpp"
 #include "nemesis/driver/compilation.hpp"
 
 namespace nemesis {
@@ -22,7 +25,9 @@ namespace nemesis {
         friend class code_generator;
     public:
         // semantic errors in the program that are printed and then analysis continues
-        struct semantic_error {};
+        struct semantic_error {
+            semantic_error() { statistics::semantic_error(); }
+        };
         // for errors that cause the interruption of static analysis
         struct abort_error {};
         // for cyclic definitions of types or variables
@@ -98,7 +103,35 @@ namespace nemesis {
         const ast::declaration* resolve_type(const ast::path& path, const environment* context = nullptr) const;
         const ast::declaration* resolve_variable(const ast::path& path, const environment* context = nullptr) const;
         std::string fullname(const ast::declaration* decl) const;
+        class dependencies dependencies() const;
+        // tells if identifier is the last use of a local variable, so that its value may be moved instead of copied
+        bool last_use(const ast::identifier_expression& expr) const { return last_uses_.count(&expr); }
+        // tells if index is proven to be inside bounds of the indexed array or slice, so that it needs no check
+        bool safe_index(const ast::array_index_expression& expr) const { return safe_indices_.count(&expr); }
+        // tells if condition of a loop contract doesn't change among iterations, so that it may be evaluated once before the loop
+        bool hoisted(const ast::contract_statement& stmt) const { return hoisted_.count(&stmt); }
+        // tells if variable is captured by a lambda or used by a deferred statement
+        bool escaping(const ast::var_declaration* var) const { auto it = locals_.find(var); return it != locals_.end() && it->second.escaping; }
+        // tells if local variable is only ever called, so that a closure it holds cannot outlive its block
+        bool invoked_only(const ast::var_declaration* var) const;
+        // tells if parameter is only ever called, so that a closure passed to it may be bound statically
+        bool invoked_only(const ast::parameter_declaration* param) const;
+        // tells if function is implemented in C++ instead of its body, like builtin and extern functions
+        bool intrinsic(const ast::function_declaration* fn) const;
+        // gets the implementation which a behaviour method call is statically bound to, if any
+        const ast::declaration* devirtualized(const ast::member_expression& expr) const { auto it = devirtualized_.find(&expr); return it == devirtualized_.end() ? nullptr : it->second; }
     private:
+        /**
+         * Interval of values taken by an integer expression, which is also below the size of an object when it is known
+         */
+        struct index_range {
+            bool bounded_below = false;
+            bool bounded_above = false;
+            std::int64_t lower = 0;
+            std::int64_t upper = 0;
+            const ast::declaration* sized = nullptr;
+        };
+
         environment* begin_scope(const ast::node* enclosing);
         void end_scope();
         void add_to_scope(environment* scope, ast::pointer<ast::declaration> decl, const ast::statement* after = nullptr, bool is_after = true) const;
@@ -121,9 +154,21 @@ namespace nemesis {
         bool is_string_convertible(ast::pointer<ast::type> type, const ast::property_declaration*& procedure) const;
         void test_immutable_assignment(const ast::var_declaration& decl, const ast::expression& value) const;
         void test_immutable_assignment(ast::pointer<ast::type> lvalue, const ast::expression& rvalue) const;
+        // tells if value is a slice of arrays which may be read-only in C++, like constants and immutable parameters
+        bool readonly_view(const ast::expression& value) const;
         void add_type(ast::pointer<ast::type> type);
         void add_function(const ast::function_declaration* fn);
         ast::pointer<ast::var_declaration> create_temporary_var(const ast::expression& value) const;
+        std::string temporary() const;
+        void use(const ast::identifier_expression& expr, const ast::var_declaration* var);
+        void find_last_uses();
+        ast::pointer<ast::type> concrete_type(const ast::expression& object) const;
+        const ast::declaration* sized_object(const ast::expression& expr) const;
+        index_range range_of(const ast::expression& expr) const;
+        void find_safe_indices();
+        bool loop_invariant(const ast::expression& expr, const ast::declaration* variable) const;
+        void hoist_contracts();
+        void devirtualize();
 
         void visit(const ast::bit_field_type_expression& expr);
         void visit(const ast::path_type_expression& expr);
@@ -184,6 +229,7 @@ namespace nemesis {
         void visit(const ast::generic_const_parameter_declaration& decl);
         void visit(const ast::generic_type_parameter_declaration& decl);
         void visit(const ast::test_declaration& decl);
+        void visit(const ast::bench_declaration& decl);
         void visit(const ast::function_declaration& decl);
         void visit(const ast::property_declaration& decl);
         void visit(const ast::concept_declaration& decl);
@@ -209,7 +255,7 @@ namespace nemesis {
         /**
          * Current analyzed file
          */
-        source_file* file_;
+        source_file* file_ = nullptr;
         /**
          * Current statement
          */
@@ -226,6 +272,14 @@ namespace nemesis {
          * All scopes
          */
         std::unordered_map<const ast::node*, environment*> scopes_;
+        /**
+         * Lookup observer for all scopes, which records references between files while checking
+         */
+        environment::observer observer_;
+        /**
+         * For each source file, files containing declarations which it references
+         */
+        std::unordered_map<utf8::span, std::unordered_set<utf8::span>> references_;
         /**
          * Queue of declarations to be added to scope, this is performed later
          * as it would invalidate vector of statements because of insertion
@@ -240,6 +294,67 @@ namespace nemesis {
          * Third pass fully checks remained statements
          */
         enum class pass { zero, first, second, third, fourth } pass_;
+        /**
+         * Uses of a local variable in the scopes where they occur, collected while checking.
+         * A variable escapes if its address is taken, if it is captured by a lambda or used by a `later` statement,
+         * so that its lifetime goes beyond its last use in source order
+         */
+        struct local_uses {
+            std::vector<std::pair<const ast::identifier_expression*, const environment*>> uses;
+            bool escaping = false;
+        };
+        /**
+         * Uses of each local variable declared inside a block
+         */
+        std::unordered_map<const ast::var_declaration*, local_uses> locals_;
+        /**
+         * Uses of each parameter of a function
+         */
+        std::unordered_map<const ast::parameter_declaration*, std::vector<const ast::identifier_expression*>> parameters_;
+        /**
+         * Last uses of local variables, after which a variable is never read again
+         */
+        std::unordered_set<const ast::identifier_expression*> last_uses_;
+        /**
+         * Depth of `later` statements being checked, whose expressions are executed at exit from scope
+         */
+        unsigned deferred_ = 0;
+        /**
+         * Values taken by iteration variables of loops over ranges
+         */
+        std::unordered_map<const ast::declaration*, index_range> loop_ranges_;
+        /**
+         * All checked indexing expressions
+         */
+        std::vector<const ast::array_index_expression*> indexings_;
+        /**
+         * Indexing expressions whose index is proven to be inside bounds
+         */
+        std::unordered_set<const ast::array_index_expression*> safe_indices_;
+        /**
+         * Loops with contracts
+         */
+        std::vector<const ast::expression*> contracted_loops_;
+        /**
+         * Contracts of loops whose condition doesn't depend on values changed by the loop
+         */
+        std::unordered_set<const ast::contract_statement*> hoisted_;
+        /**
+         * Identifiers which are callees of call expressions
+         */
+        std::unordered_set<const ast::identifier_expression*> callees_;
+        /**
+         * Calls of behaviour methods through pointers to behaviour, which are dispatched through virtual tables
+         */
+        std::vector<const ast::member_expression*> dispatches_;
+        /**
+         * Behaviour method calls whose implementation is statically known, mapped to the implementation
+         */
+        std::unordered_map<const ast::member_expression*, const ast::declaration*> devirtualized_;
+        /**
+         * Counter of artificial variables introduced by the checker, so that their names are the same at each compilation
+         */
+        mutable std::size_t temporaries_ = 0;
     };
 
     // performs substituions of
@@ -346,6 +461,7 @@ namespace nemesis {
         void visit(const ast::generic_const_parameter_declaration& decl);
         void visit(const ast::generic_type_parameter_declaration& decl);
         void visit(const ast::test_declaration& decl);
+        void visit(const ast::bench_declaration& decl);
         void visit(const ast::function_declaration& decl);
         void visit(const ast::property_declaration& decl);
         void visit(const ast::concept_declaration& decl);
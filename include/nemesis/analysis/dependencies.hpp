@@ -0,0 +1,81 @@
+/**
+ * @file dependencies.hpp
+ *
+ * This file defines the dependency graph between source files which is
+ * recorded during semantic analysis and persisted between builds
+ */
+#ifndef DEPENDENCIES_HPP
+#define DEPENDENCIES_HPP
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+#include "nemesis/utf8/span.hpp"
+
+namespace nemesis {
+    namespace impl {
+        /**
+         * FNV-1a digest of `size` bytes at `data`, which is stable between different builds of the compiler
+         */
+        std::uint64_t fnv1a(const char* data, std::size_t size);
+    }
+    /**
+     * Dependency graph between source files, built by the checker while resolving names.
+     * An edge from file `a` to file `b` means that some declaration inside `a` references a
+     * declaration inside `b`, which includes instantiations of generics declared inside `b`
+     * from call sites in `a`.
+     * Together with a content digest for each file, the graph tells which files are
+     * affected by changes since the build in which it was recorded
+     */
+    class dependencies {
+    public:
+        /**
+         * Records that file `from` references some declaration inside file `to`
+         */
+        void depend(const std::string& from, const std::string& to);
+        /**
+         * Records content digest of a file
+         */
+        void hash(const std::string& file, utf8::span content);
+        /**
+         * Records configuration key of the build, for example options which alter the generated code
+         */
+        void configuration(const std::string& key) { configuration_ = key; }
+        /**
+         * Computes all files which are affected by changes between `previous` build and this one.
+         * Changed files are those whose digest is different, or which were added or removed, then
+         * all files which transitively depend on changed ones inside `previous` graph are affected too.
+         * If configuration differs, then every file is affected
+         */
+        std::set<std::string> affected(const dependencies& previous) const;
+        /**
+         * Copies edges recorded by analysis inside this graph
+         */
+        void merge(const dependencies& other);
+        /**
+         * Reads graph from file at `path`, returns false if it does not exist or it is malformed
+         */
+        bool load(const std::string& path);
+        /**
+         * Writes graph to file at `path`, returns false on failure
+         */
+        bool save(const std::string& path) const;
+    private:
+        /**
+         * Adjacency list of graph, where each file is associated to files it depends on
+         */
+        std::map<std::string, std::set<std::string>> edges_;
+        /**
+         * Content digest for each file
+         */
+        std::map<std::string, std::uint64_t> digests_;
+        /**
+         * Build configuration key
+         */
+        std::string configuration_;
+    };
+}
+
+#endif // DEPENDENCIES_HPP
@@ -1,6 +1,8 @@
 #ifndef ENVIRONMENT_HPP
 #define ENVIRONMENT_HPP
 
+#include <functional>
+#include <string_view>
 #include <unordered_map>
 
 #include <nemesis/parser/ast.hpp>
@@ -9,11 +11,15 @@ namespace nemesis {
     class environment {
     public:
         enum class kind { workspace, global, function, test, block, loop, declaration };
+        // callback invoked on each declaration found by a lookup
+        using observer = std::function<void(const ast::declaration*)>;
 
         environment(const ast::node* enclosing, environment* parent = nullptr);
         const ast::node* enclosing() const { return enclosing_; }
         environment* parent() const { return parent_; }
         void parent(environment* value) { parent_ = value; }
+        // sets lookup observer, which is inherited by scopes created later inside this one
+        void observe(const observer* callback) { observer_ = callback; }
         
         const ast::declaration* value(std::string name, bool recursive = true) const;
         const ast::declaration* function(std::string name, bool recursive = true) const;
@@ -33,6 +39,7 @@ namespace nemesis {
 
         void remove(const ast::declaration* decl)
         {
+            similars_.clear();
             if (auto tdecl = dynamic_cast<const ast::type_declaration*>(decl)) types_.erase(tdecl->name().lexeme().string());
             else if (auto vdecl = dynamic_cast<const ast::var_declaration*>(decl)) values_.erase(vdecl->name().lexeme().string());
             else if (auto cdecl = dynamic_cast<const ast::const_declaration*>(decl)) values_.erase(cdecl->name().lexeme().string());
@@ -46,6 +53,13 @@ namespace nemesis {
         void function(std::string name, const ast::declaration* fdecl);
         void type(std::string name, const ast::type_declaration* tdecl);
         void concept(std::string name, const ast::concept_declaration* tdecl);
+        void remove_value(const std::string& name) { values_.erase(name); similars_.clear(); }
+        /**
+         * Declarations of this scope only (not parents) whose name is at most `distance` edits far from `name`.
+         * Names are indexed by length, so that only near lengths are compared, and the index is lazily
+         * rebuilt after any change to this scope. Order is types, concepts, functions and then values
+         */
+        std::vector<const ast::declaration*> similars(std::string_view name, unsigned distance) const;
 
         std::unordered_map<std::string, const ast::declaration*>& values() const { return values_; }
         std::unordered_map<std::string, const ast::declaration*>& functions() const { return functions_; }
@@ -71,13 +85,20 @@ namespace nemesis {
             while (scope);
         }
     private:
+        // looks for name inside `map` of this scope and then of its parents if recursive
+        template<typename T>
+        T lookup(std::unordered_map<std::string, T> environment::* map, const std::string& name, bool recursive) const;
+
         const ast::node* enclosing_ = nullptr;
         environment* parent_ = nullptr;
+        const observer* observer_ = nullptr;
         std::vector<environment*> children_;
         mutable std::unordered_map<std::string, const ast::declaration*> values_;
         mutable std::unordered_map<std::string, const ast::declaration*> functions_;
         mutable std::unordered_map<std::string, const ast::type_declaration*> types_;
         mutable std::unordered_map<std::string, const ast::concept_declaration*> concepts_;
+        // similars_[n] holds declared names of length n, views point to keys of maps above which are stable
+        mutable std::vector<std::vector<std::pair<std::string_view, const ast::declaration*>>> similars_;
     };
 }
 
@@ -1,7 +1,9 @@
 #ifndef EVALUATOR_HPP
 #define EVALUATOR_HPP
 
+#include <deque>
 #include <stack>
+#include <unordered_map>
 
 #include "nemesis/analysis/environment.hpp"
 
@@ -13,6 +15,18 @@ namespace nemesis {
     public:
         struct error {};
         struct generic_evaluation {};
+        /**
+         * Maximum number of statements, loop iterations and calls executed by compile time function evaluation
+         */
+        static constexpr std::size_t max_steps = 1000000;
+        /**
+         * Maximum number of sequence elements (arrays, tuples and records) created during a single evaluation
+         */
+        static constexpr std::size_t max_memory = 1 << 20;
+        /**
+         * Maximum depth of nested function calls during compile time function evaluation
+         */
+        static constexpr std::size_t max_depth = 256;
         evaluator(checker& checker);
         constval evaluate(ast::pointer<ast::expression> expr);
         static constval integer_parse(const std::string& value);
@@ -21,6 +35,40 @@ namespace nemesis {
     private:
         void test_operation_error(const ast::unary_expression& expr, const std::string& operation, constval result);
         void test_operation_error(const ast::binary_expression& expr, const std::string& operation, constval result);
+        // signals which unwind the evaluation of a function body
+        struct returning {};
+        struct breaking {};
+        struct continuing {};
+        // signal thrown when any of the budgets is exceeded, carrying which one
+        struct exhausted {
+            enum class budget { steps, memory, depth } reason;
+        };
+        // local variables of a function being evaluated at compile time
+        struct frame {
+            std::unordered_map<const ast::declaration*, constval> locals;
+        };
+        // converts value to the given type, like an implicit conversion
+        static constval convert(constval value, ast::pointer<ast::type> type);
+        // storage of an assignable expression inside current frame
+        constval& location(const ast::expression& expr);
+        // pushes value of a temporary introduced by the checker for control expressions, if already computed
+        bool temporary(const ast::expression& expr);
+        // executes a statement inside a function body
+        void execute(const ast::statement& stmt);
+        // accounts for a step and for memory used by the evaluation
+        void step();
+        void allocate(std::size_t elements);
+        // reports exceeded budget on the evaluated call or constant expression
+        void exhaustion(const ast::expression& expr, exhausted signal, const std::string& subject);
+        // checks contracts of function or loop when entering (require and invariant) or leaving (ensure and invariant)
+        void contracts(const ast::node& owner, const ast::pointers<ast::statement>& contracts, bool entry);
+        void visit(const ast::contract_statement& stmt);
+        void visit(const ast::expression_statement& stmt);
+        void visit(const ast::assignment_statement& stmt);
+        void visit(const ast::return_statement& stmt);
+        void visit(const ast::break_statement& stmt);
+        void visit(const ast::continue_statement& stmt);
+        void visit(const ast::var_declaration& decl);
         void visit(const ast::bit_field_type_expression& expr);
         void visit(const ast::path_type_expression& expr);
         void visit(const ast::array_type_expression& expr);
@@ -35,7 +83,7 @@ namespace nemesis {
         void visit(const ast::array_expression& expr);
         void visit(const ast::array_sized_expression& expr);
         void visit(const ast::parenthesis_expression& expr);
-        void visit(const ast::block_expression& expr) {}
+        void visit(const ast::block_expression& expr);
         void visit(const ast::function_expression& expr);
         void visit(const ast::postfix_expression& expr);
         void visit(const ast::call_expression& expr);
@@ -63,17 +111,25 @@ namespace nemesis {
         void visit(const ast::if_expression& expr);
         void visit(const ast::implicit_conversion_expression& expr);
 
-        void push(constval val) { stack_.push(val); }
+        void push(constval val) { stack_.push(std::move(val)); }
         
         constval pop() 
         {
-            constval result = stack_.top();
+            constval result = std::move(stack_.top());
             stack_.pop();
             return result;
         }
         
         checker& checker_;  
         std::stack<constval> stack_;
+        // frames of functions being evaluated, where references to locals stay valid when calls are nested
+        std::deque<frame> frames_;
+        // value carried by return or break signals
+        constval signal_;
+        // binary expressions equivalent to compound assignments like `x += 1`
+        std::unordered_map<const ast::assignment_statement*, ast::pointer<ast::binary_expression>> compounds_;
+        std::size_t steps_ = 0;
+        std::size_t memory_ = 0;
     };
 }
 
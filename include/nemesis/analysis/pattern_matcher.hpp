@@ -26,6 +26,8 @@ namespace nemesis {
 
                 ast::pointer<ast::expression> condition;
                 ast::pointers<ast::declaration> declarations;
+                // test on the whole matched value, used to build decision trees
+                pattern_test test;
 
                 void invalidate() 
                 {
@@ -53,6 +55,8 @@ namespace nemesis {
             void error(const ast::expression* pattern, const std::string& message, const std::string& explanation = "", const std::string& inlined = "") const;
             bool bind(const token& name, const ast::expression* value, result& result) const;
             ast::pointer<ast::expression> from_pattern(const ast::expression* pattern) const;
+            // classifies the test performed by a pattern on the whole matched value of type `expected`
+            pattern_test test(const ast::expression* pattern, ast::pointer<ast::type> expected) const;
 
             const ast::expression* pattern_;
             diagnostic_publisher& publisher_;
@@ -0,0 +1,136 @@
+/**
+ * @file statistics.hpp
+ *
+ * This file defines internal counters of semantic analysis which
+ * are printed by driver option `-stats`
+ */
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+namespace nemesis {
+    /**
+     * Counters are global because they are updated from environments, types and matchers which
+     * have no reference to the checker. Each update is a single predictable branch when counting
+     * is disabled, which is the default
+     */
+    class statistics {
+    public:
+        /**
+         * Enables or disables counting
+         */
+        static void enable(bool flag) { enabled_ = flag; }
+        /**
+         * @return true if counting is enabled
+         */
+        static bool enabled() { return enabled_; }
+        /**
+         * Counts a name lookup inside environments, where depth is the number of parent scopes visited
+         */
+        static void lookup(std::size_t depth, bool found)
+        {
+            if (!enabled_) return;
+            ++lookups_;
+            lookup_depth_ += depth;
+            if (depth > max_lookup_depth_) max_lookup_depth_ = depth;
+            if (!found) {
+                ++lookup_misses_;
+                miss_depth_ += depth;
+            }
+        }
+        /**
+         * Counts a call to types::compatible
+         */
+        static void compatibility() { if (enabled_) ++compatibility_; }
+        /**
+         * Counts an instantiation of a generic declaration and the number of syntax nodes cloned for it
+         */
+        static void instantiation(std::size_t nodes)
+        {
+            if (!enabled_) return;
+            ++instantiations_;
+            cloned_nodes_ += nodes;
+        }
+        /**
+         * Counts a concept test, which may be resolved by the cache of tested concepts
+         */
+        static void concept_test(bool cached)
+        {
+            if (!enabled_) return;
+            ++concept_tests_;
+            if (cached) ++concept_hits_;
+        }
+        /**
+         * Counts an invocation of type matcher
+         */
+        static void type_matching() { if (enabled_) ++type_matchings_; }
+        /**
+         * Counts an evaluation of a constant expression and measures its time while alive,
+         * where nested evaluations are only counted once
+         */
+        class evaluation {
+        public:
+            evaluation() : counted_(enabled_)
+            {
+                if (!counted_) return;
+                ++evaluations_;
+                if (evaluating_++ == 0) start_ = std::chrono::steady_clock::now();
+            }
+
+            ~evaluation()
+            {
+                if (counted_ && --evaluating_ == 0) evaluation_time_ += std::chrono::steady_clock::now() - start_;
+            }
+        private:
+            bool counted_;
+            std::chrono::steady_clock::time_point start_;
+        };
+        /**
+         * Counts a semantic error thrown by the checker
+         */
+        static void semantic_error() { if (enabled_) ++semantic_errors_; }
+        /**
+         * @return Human readable report of all counters
+         */
+        static std::string report()
+        {
+            std::ostringstream oss;
+
+            oss << "here's what I did to check your code:\n";
+            oss << "  ├─> environment lookups: " << lookups_ << " (" << lookup_misses_ << " misses), average depth " << average(lookup_depth_, lookups_) << ", maximum depth " << max_lookup_depth_ << ", average miss depth " << average(miss_depth_, lookup_misses_) << "\n";
+            oss << "  ├─> type compatibility tests: " << compatibility_ << "\n";
+            oss << "  ├─> generic instantiations: " << instantiations_ << " (" << cloned_nodes_ << " cloned nodes)\n";
+            oss << "  ├─> concept tests: " << concept_tests_ << " (" << concept_hits_ << " cache hits)\n";
+            oss << "  ├─> type matcher invocations: " << type_matchings_ << "\n";
+            oss << "  ├─> constant evaluations: " << evaluations_ << " in " << std::chrono::duration<double, std::milli>(evaluation_time_).count() << " ms\n";
+            oss << "  └─> semantic errors thrown: " << semantic_errors_;
+
+            return oss.str();
+        }
+    private:
+        static double average(std::size_t total, std::size_t count) { return count > 0 ? static_cast<double>(total) / count : 0.0; }
+
+        inline static bool enabled_ = false;
+        inline static std::size_t lookups_ = 0;
+        inline static std::size_t lookup_misses_ = 0;
+        inline static std::size_t lookup_depth_ = 0;
+        inline static std::size_t miss_depth_ = 0;
+        inline static std::size_t max_lookup_depth_ = 0;
+        inline static std::size_t compatibility_ = 0;
+        inline static std::size_t instantiations_ = 0;
+        inline static std::size_t cloned_nodes_ = 0;
+        inline static std::size_t concept_tests_ = 0;
+        inline static std::size_t concept_hits_ = 0;
+        inline static std::size_t type_matchings_ = 0;
+        inline static std::size_t evaluations_ = 0;
+        inline static std::size_t evaluating_ = 0;
+        inline static std::chrono::steady_clock::duration evaluation_time_ = std::chrono::steady_clock::duration::zero();
+        inline static std::size_t semantic_errors_ = 0;
+    };
+}
+
+#endif // STATISTICS_HPP
@@ -65,9 +65,35 @@ namespace nemesis {
                 unknown_type
             };
             virtual enum category category() const = 0;
-            virtual std::string string(bool absolute = true) const = 0;
+            // computes name of type, absolute name has the prefix of enclosing types
+            virtual std::string describe(bool absolute) const = 0;
+            // name of type, where absolute name is memoized as canonical name
+            std::string string(bool absolute = true) const { return absolute ? canonical() : describe(false); }
+            /**
+             * Canonical name is the key of instantiations, concepts and variant tags so it is computed once
+             * and memoized with its hash, while substitution creates new types with their own names.
+             * Any change to a type in place or to the scope of a type declaration invalidates all memoized names
+             */
+            const std::string& canonical() const
+            {
+                if (memoized_ != generation_) {
+                    canonical_ = describe(true);
+                    hash_ = std::hash<std::string>()(canonical_);
+                    mangled_.clear();
+                    memoized_ = generation_;
+                }
+
+                return canonical_;
+            }
+            // hash of canonical name
+            std::size_t hash() const { canonical(); return hash_; }
+            // memoized C++ spelling of type, empty if not yet emitted by code generator
+            const std::string& mangled() const { canonical(); return mangled_; }
+            void mangled(const std::string& value) const { canonical(); mangled_ = value; }
+            // invalidates all memoized names
+            static void invalidate() { ++generation_; }
             virtual ~type() {}
-            void declaration(const ast::declaration* decl) { declaration_ = decl; }
+            void declaration(const ast::declaration* decl) { declaration_ = decl; invalidate(); }
             virtual const ast::declaration* declaration() const { return declaration_; }
             std::string prefix() const 
             {
@@ -98,11 +124,26 @@ namespace nemesis {
             }
             // before is current type wrapped as a smart pointer, while map is a mapping between generic type/value declaration and argument (constval or type)
             virtual ast::pointer<ast::type> substitute(ast::pointer<ast::type> before, std::unordered_map<const ast::declaration*, impl::parameter> map, std::set<const ast::type*> visited = {}) const { return before; }
+            // sets mutability bit of a type which may be already named, as it is part of names of function types
+            void mark_mutable(bool flag) 
+            { 
+                if (mutability == flag) return;
+                mutability = flag; 
+                invalidate();
+            }
             // mutability bit, used only for declarations of variables' types and for return types
             bool mutability : 1;
         protected:
             type() : mutability(false) {}
+            // invalidates memoized names of this type only, when it changes before being part of other types
+            void forget() const { memoized_ = 0; }
             const ast::declaration* declaration_ = nullptr;
+        private:
+            static std::size_t generation_;
+            mutable std::size_t memoized_ = 0;
+            mutable std::size_t hash_ = 0;
+            mutable std::string canonical_;
+            mutable std::string mangled_;
         };
 
         using types = std::vector<pointer<type>>;
@@ -111,7 +152,7 @@ namespace nemesis {
         public:
             unknown_type() : type() {}
             ~unknown_type() {}
-            std::string string(bool absolute = true) const { return "_"; }
+            std::string describe(bool absolute) const { return "_"; }
             enum category category() const { return category::unknown_type; }
         };
 
@@ -119,7 +160,7 @@ namespace nemesis {
         public:
             workspace_type() : type() {}
             ~workspace_type() {}
-            std::string string(bool absolute = true) const { return static_cast<const ast::workspace*>(declaration_)->name; }
+            std::string describe(bool absolute) const { return static_cast<const ast::workspace*>(declaration_)->name; }
             enum category category() const { return category::workspace_type; }
             ast::pointer<ast::type> substitute(ast::pointer<ast::type> before, std::unordered_map<const ast::declaration*, impl::parameter> map, std::set<const ast::type*> visited = {}) const { return before; }
         };
@@ -128,7 +169,7 @@ namespace nemesis {
         public:
             generic_type() : type() {}
             ~generic_type() {}
-            std::string string(bool absolute = true) const { return "$" + static_cast<const ast::generic_type_parameter_declaration*>(declaration_)->name().lexeme().string(); }
+            std::string describe(bool absolute) const { return "$" + static_cast<const ast::generic_type_parameter_declaration*>(declaration_)->name().lexeme().string(); }
             enum category category() const { return category::generic_type; }
             ast::pointer<ast::type> substitute(ast::pointer<ast::type> before, std::unordered_map<const ast::declaration*, impl::parameter> map, std::set<const ast::type*> visited = {}) const
             {
@@ -144,7 +185,7 @@ namespace nemesis {
             ~integer_type() {}
             unsigned bits() const { return bits_; }
             bool is_signed() const { return signed_; }
-            std::string string(bool absolute = true) const 
+            std::string describe(bool absolute) const 
             {
                 switch (bits_) {
                     case 8:
@@ -170,7 +211,7 @@ namespace nemesis {
             rational_type(unsigned bits) : type(), bits_(bits) {}
             ~rational_type() {}
             unsigned bits() const { return bits_; }
-            std::string string(bool absolute = true) const { return "r" + std::to_string(bits_); }
+            std::string describe(bool absolute) const { return "r" + std::to_string(bits_); }
             enum category category() const { return category::rational_type; }
         private:
             unsigned bits_;
@@ -181,7 +222,7 @@ namespace nemesis {
             float_type(unsigned bits) : type(), bits_(bits) {}
             ~float_type() {}
             unsigned bits() const { return bits_; }
-            std::string string(bool absolute = true) const { return "f" + std::to_string(bits_); }
+            std::string describe(bool absolute) const { return "f" + std::to_string(bits_); }
             enum category category() const { return category::float_type; }
         private:
             unsigned bits_;
@@ -192,7 +233,7 @@ namespace nemesis {
             complex_type(unsigned bits) : type(), bits_(bits) {}
             ~complex_type() {}
             unsigned bits() const { return bits_; }
-            std::string string(bool absolute = true) const { return "c" + std::to_string(bits_); }
+            std::string describe(bool absolute) const { return "c" + std::to_string(bits_); }
             enum category category() const { return category::complex_type; }
         private:
             unsigned bits_;
@@ -202,7 +243,7 @@ namespace nemesis {
         public:
             bool_type() : type() {}
             ~bool_type() {}
-            std::string string(bool absolute = true) const { return "bool"; }
+            std::string describe(bool absolute) const { return "bool"; }
             enum category category() const { return category::bool_type; }
         };
 
@@ -210,7 +251,7 @@ namespace nemesis {
         public:
             char_type() : type() {}
             ~char_type() {}
-            std::string string(bool absolute = true) const { return "char"; }
+            std::string describe(bool absolute) const { return "char"; }
             enum category category() const { return category::char_type; }
         };
 
@@ -218,7 +259,7 @@ namespace nemesis {
         public:
             chars_type() : type() {}
             ~chars_type() {}
-            std::string string(bool absolute = true) const { return "chars"; }
+            std::string describe(bool absolute) const { return "chars"; }
             enum category category() const { return category::chars_type; }
         };
 
@@ -226,7 +267,7 @@ namespace nemesis {
         public:
             string_type() : type() {}
             ~string_type() {}
-            std::string string(bool absolute = true) const { return "string"; }
+            std::string describe(bool absolute) const { return "string"; }
             enum category category() const { return category::string_type; }
         };
 
@@ -236,14 +277,20 @@ namespace nemesis {
             ~array_type() {}
             pointer<type> base() const { return base_; }
             unsigned size() const { return size_; }
-            std::string string(bool absolute = true) const 
+            std::string describe(bool absolute) const 
             {
                 if (size_ > 0) return "[" + base_->string() + " : " + std::to_string(size_) + "]";
                 if (parametric_size_) return "[" + base_->string() + " : $" + parametric_size_->name().lexeme().string() + "]"; 
                 return "[" + base_->string() + " : _]";
             }
             enum category category() const { return category::array_type; }
-            const ast::generic_const_parameter_declaration*& parametric_size() const { return parametric_size_; }
+            const ast::generic_const_parameter_declaration* parametric_size() const { return parametric_size_; }
+            void parametric_size(const ast::generic_const_parameter_declaration* size)
+            {
+                if (parametric_size_ == size) return;
+                parametric_size_ = size;
+                forget();
+            }
             ast::pointer<ast::type> substitute(ast::pointer<ast::type> before, std::unordered_map<const ast::declaration*, impl::parameter> map, std::set<const ast::type*> visited = {}) const
             {
                 if (visited.count(before.get())) { return before; } else { visited.insert(before.get()); }
@@ -272,7 +319,7 @@ namespace nemesis {
         private:
             pointer<type> base_;
             unsigned size_;
-            mutable const ast::generic_const_parameter_declaration* parametric_size_ = nullptr;
+            const ast::generic_const_parameter_declaration* parametric_size_ = nullptr;
         };
 
         class slice_type : public type {
@@ -280,7 +327,7 @@ namespace nemesis {
             slice_type(pointer<type> base) : type(), base_(base) {}
             ~slice_type() {}
             pointer<type> base() const { return base_; }
-            std::string string(bool absolute = true) const { return "[" + base_->string() + "]"; }
+            std::string describe(bool absolute) const { return "[" + base_->string() + "]"; }
             enum category category() const { return category::slice_type; }
             ast::pointer<ast::type> substitute(ast::pointer<ast::type> before, std::unordered_map<const ast::declaration*, impl::parameter> map, std::set<const ast::type*> visited = {}) const
             {
@@ -303,9 +350,9 @@ namespace nemesis {
             tuple_type(types components) : type(), components_(components) {}
             ~tuple_type() {}
             const types& components() const { return components_; }
-            void components(types value) { components_ = value; }
+            void components(types value) { components_ = value; invalidate(); }
             unsigned length() const { return components_.size(); }
-            std::string string(bool absolute = true) const 
+            std::string describe(bool absolute) const 
             {
                 if (declaration_) {
                     if (absolute) return prefix() + dynamic_cast<const ast::record_declaration*>(declaration_)->name().lexeme().string();
@@ -347,7 +394,7 @@ namespace nemesis {
             pointer_type(pointer<type> base) : type(), base_(base) {}
             ~pointer_type() {}
             pointer<type> base() const { return base_; }
-            std::string string(bool absolute = true) const;
+            std::string describe(bool absolute) const;
             enum category category() const { return category::pointer_type; }
             ast::pointer<ast::type> substitute(ast::pointer<ast::type> before, std::unordered_map<const ast::declaration*, impl::parameter> map, std::set<const ast::type*> visited = {}) const
             {
@@ -369,10 +416,10 @@ namespace nemesis {
             range_type(pointer<type> base, bool open) : type(), base_(base), open_(open) {}
             ~range_type() {}
             bool is_open() const { return open_; }
-            void open(bool flag) { open_ = flag; }
-            void base(pointer<type> b) { base_ = b; }
+            void open(bool flag) { open_ = flag; invalidate(); }
+            void base(pointer<type> b) { base_ = b; invalidate(); }
             pointer<type> base() const { return base_; }
-            std::string string(bool absolute = true) const 
+            std::string describe(bool absolute) const 
             { 
                 if (declaration_) {
                     if (absolute) return prefix() + dynamic_cast<const ast::range_declaration*>(declaration_)->name().lexeme().string();
@@ -403,7 +450,7 @@ namespace nemesis {
             ~function_type() {}
             const types& formals() const { return formals_; }
             pointer<type> result() const { return result_; }
-            std::string string(bool absolute = true) const 
+            std::string describe(bool absolute) const 
             {
                 std::string str = lambda_ ? "lambda" : "function";
                 if (formals_.empty()) str += "()";
@@ -456,8 +503,8 @@ namespace nemesis {
             structure_type(components fields) : type(), fields_(fields) {}
             ~structure_type() {}
             const components& fields() const { return fields_; }
-            void fields(components fields) { fields_ = fields; }
-            std::string string(bool absolute = true) const 
+            void fields(components fields) { fields_ = fields; invalidate(); }
+            std::string describe(bool absolute) const 
             {
                 if (declaration_) {
                     if (absolute) return prefix() + dynamic_cast<const ast::record_declaration*>(declaration_)->name().lexeme().string();
@@ -500,9 +547,11 @@ namespace nemesis {
             variant_type(const types& types) : type(), types_(types) {}
             ~variant_type() {}
             const ast::types& types() const { return types_; }
-            void types(ast::types value) { types_ = value; }
+            void types(ast::types value) { types_ = value; invalidate(); }
             bool contains(ast::pointer<ast::type> subtype) const;
-            std::string string(bool absolute = true) const
+            // run-time tag of subtype, which is its ordinal among types of variant, or the number of types if not contained
+            std::size_t tag(ast::pointer<ast::type> subtype) const;
+            std::string describe(bool absolute) const
             {
                 if (declaration_) {
                     if (absolute) return prefix() + dynamic_cast<const ast::variant_declaration*>(declaration_)->name().lexeme().string();
@@ -541,7 +590,7 @@ namespace nemesis {
         public:
             behaviour_type() : type() {}
             ~behaviour_type() {}
-            std::string string(bool absolute = true) const 
+            std::string describe(bool absolute) const 
             { 
                 if (absolute) return prefix() + dynamic_cast<const behaviour_declaration*>(declaration_)->name().lexeme().string();
                 else return dynamic_cast<const behaviour_declaration*>(declaration_)->name().lexeme().string();
@@ -549,8 +598,9 @@ namespace nemesis {
             enum category category() const { return category::behaviour_type; }
             void implements(ast::pointer<ast::type> type);
             bool implementor(ast::pointer<ast::type> type) const;
+            const std::set<ast::pointer<ast::type>>& implementors() const { return implementors_; }
         private:
-            std::set<ast::pointer<ast::type>> implementors;
+            std::set<ast::pointer<ast::type>> implementors_;
         };
     }
 
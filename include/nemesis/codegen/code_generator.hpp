@@ -12,6 +12,10 @@ namespace nemesis {
         std::list<compilation::target> generate();
         void trace(bool flag);
         bool trace() const;
+        void profile(bool flag);
+        bool profile() const;
+        void unity(bool flag);
+        bool unity() const;
         std::string emit(ast::pointer<ast::type> type) const;
         std::string emit(ast::pointer<ast::type> type, std::string variable) const;
         std::string emit(constval value) const;
@@ -19,6 +23,7 @@ namespace nemesis {
         std::string prototype(const ast::function_declaration* decl) const;
         std::string prototype(const ast::property_declaration* decl) const;
         std::string prototype(const ast::test_declaration* decl) const;
+        std::string prototype(const ast::bench_declaration* decl) const;
         std::string fullname(const ast::declaration *decl) const;
     private:
         struct guard;
@@ -49,12 +54,53 @@ namespace nemesis {
             filestream& stream_;
         };
 
+        std::string mangle(ast::pointer<ast::type> type) const;
+        std::string table(constval value);
+        std::string location(const source_location& location);
+        std::string location(const source_range& range);
+        std::string temporary(const std::string& prefix);
+        std::string emit_tables(std::size_t position);
+        void frame(const std::string& function, const std::string& name, const source_location& location);
+        void emit_site(const source_range& range);
+        std::string emit_frames() const;
+        void emit_constant(constval value);
         bool emit_if_constant(const ast::expression& expr);
+        void emit_subpatterns(const ast::expression* condition);
+        bool emit_decision_tree(const ast::when_expression& expr);
+        std::string exit_from(const ast::node* loop);
         void emit_anonymous_type(ast::pointer<ast::type> type);
+        bool trivial(ast::pointer<ast::type> type) const;
+        bool by_reference(ast::pointer<ast::type> type) const;
+        std::string emit_formal(ast::pointer<ast::type> type) const;
+        std::string emit_parameter(const ast::parameter_declaration* parameter) const;
+        std::string argument(const ast::parameter_declaration* parameter) const;
+        void emit_mutable_parameters(const ast::pointers<ast::declaration>& parameters);
+        bool movable(ast::pointer<ast::type> type) const;
+        void emit_consumed(const ast::expression& expr);
+        bool aliased(const ast::expression& expr) const;
+        bool readonly(const ast::expression& expr) const;
+        void emit_argument(const ast::expression& expr, ast::pointer<ast::type> formal);
+        const ast::declaration* devirtualized(const ast::member_expression& expr) const;
+        void emit_devirtualized_object(const ast::member_expression& expr);
+        ast::pointer<ast::type> niche(ast::pointer<ast::type> type) const;
+        std::string tag(ast::pointer<ast::type> type) const;
+        void emit_niche_members(ast::pointer<ast::type> type);
+        void emit_niche_helpers(ast::pointer<ast::type> type);
+        std::vector<const ast::function_expression*> lambdas(const ast::workspace& workspace) const;
+        std::string closure(const ast::function_expression* lambda) const;
         void emit_lambda_type(const ast::function_expression* lambda);
+        bool closure_parameter(const ast::parameter_declaration* parameter) const;
+        bool specialized(const ast::function_declaration* decl) const;
+        std::string specialization(const ast::function_declaration* decl) const;
+        bool emit_specialized_call(const ast::call_expression& expr);
+        enum compilation::package::contracts contracts_level() const;
+        void emit_hoisted_contracts(const ast::pointers<ast::statement>& contracts);
         void emit_in_contracts(const ast::node& current);
         void emit_out_contracts(const ast::node& current);
         void emit_tests();
+        void emit_benchmarks();
+        std::vector<ast::pointer<ast::workspace>> dependency_order() const;
+        compilation::target emit_unity();
 
         void visit(const ast::bit_field_type_expression& expr);
         void visit(const ast::path_type_expression& expr);
@@ -112,6 +158,7 @@ namespace nemesis {
         void visit(const ast::record_declaration& decl);
         void visit(const ast::variant_declaration& decl);
         void visit(const ast::test_declaration& decl);
+        void visit(const ast::bench_declaration& decl);
         /**
          * Semantic checker contains all information produced by previous analysis
          */
@@ -136,10 +183,77 @@ namespace nemesis {
          */
         std::stack<std::string> result_vars;
         /**
-         * Back tracing mode, slower
-         * Not set by default to speed up the application
+         * Local variable at its last use inside an expression whose value is consumed, so that it's moved instead of copied
+         */
+        const ast::identifier_expression* moved_ = nullptr;
+        /**
+         * When a `when` expression is compiled into a C++ switch, a `break` which exits the enclosing
+         * loop would only exit the switch, so it jumps to a label placed after the switch instead
+         */
+        struct loop_exit {
+            const ast::node* loop;
+            std::string label;
+            bool taken;
+        };
+        /**
+         * Stack of exits from loops enclosing switches being emitted
+         */
+        std::stack<loop_exit> loop_exits_;
+        /**
+         * Big aggregate constants of current output file are hoisted into static read-only tables,
+         * so that each distinct constant is constructed once instead of at each use.
+         * Tables are indexed by hash of their value and are defined before any use
+         */
+        std::unordered_map<std::size_t, std::vector<std::pair<constval, std::string>>> tables_;
+        /**
+         * Definitions of static tables of current output file
+         */
+        std::ostringstream tables_definitions_;
+        /**
+         * Source locations of run-time checks of current output file, indexed in a static table so that
+         * failure paths only carry a reference to their location instead of file name, line and column
+         */
+        std::map<std::tuple<std::string, unsigned, unsigned>, std::size_t> locations_;
+        /**
+         * Contracts of loops whose condition is evaluated once before the loop, mapped to the variable holding the result
+         */
+        std::unordered_map<const ast::contract_statement*, std::string> hoisted_;
+        /**
+         * Functions of current output file which are listed in a static table when tracing, mapped
+         * from the expression of their address to their frame, so that a return address is resolved
+         * to the source function only when the program crashes
+         */
+        std::map<std::string, std::string> frames_;
+        /**
+         * Closures whose types are already defined in current output file, so that they may be passed
+         * by their own type to the specializations of functions taking closures
+         */
+        std::unordered_set<const ast::function_expression*> closures_;
+        /**
+         * Set while emitting the body of a traced function, whose call record keeps the location of the
+         * statement being executed, so that stack traces point at it
+         */
+        bool site_ = false;
+        /**
+         * Counter of temporary variables and labels of the function being emitted, which is reset for
+         * each function so that names don't depend on the rest of the file and output is reproducible
+         */
+        std::size_t temporaries_ = 0;
+        /**
+         * Back tracing mode, which only adds static tables of functions
+         * Not set by default to keep executables smaller
          */
         bool trace_ = false;
+        /**
+         * Profiling mode, the program samples its stack periodically and
+         * resolves samples against tables of functions at exit
+         */
+        bool profile_ = false;
+        /**
+         * Unity mode, the whole program is emitted as a single compilation unit whose definitions
+         * have internal linkage, so that calls among workspaces are visible to the optimizer
+         */
+        bool unity_ = false;
     };
 }
 
@@ -3,10 +3,12 @@
 
 #include <fstream>
 #include <list>
+#include <map>
 #include <string>
 #include <memory>
 
 #include "nemesis/source/source.hpp"
+#include "nemesis/analysis/dependencies.hpp"
 
 /** to remove **/ #include <iostream>
 
@@ -41,6 +43,11 @@ namespace nemesis {
              * If header, then file is created but not compiled
              */
             bool header = false;
+            /**
+             * If reusable, then its object file from last build is linked instead, as long as the unit and
+             * all headers are the same as when the object was compiled
+             */
+            bool reusable = false;
         };
         /**
          * A package represents a node inside the dependency graph
@@ -74,10 +81,17 @@ namespace nemesis {
              * So basically `builtin = true` excludes `src` source files from being compiled to C++
              */
             bool builtin = false;
+            /**
+             * Level of checking of contracts in generated code, which can be
+             * `off` when contracts are never tested,
+             * `entry` when only preconditions of functions are tested at their entry,
+             * `full` when all contracts are tested, as default
+             */
+            enum class contracts { off, entry, full } contracts = contracts::full;
             /**
              * Construct a generic package
              */
-            static package make(std::string name, std::string version, compilation::sources sources, compilation::sources cpp_sources = {}, bool builtin = false, enum kind kind = kind::none) { return package{name, version, sources, cpp_sources, kind, builtin}; }
+            static package make(std::string name, std::string version, compilation::sources sources, compilation::sources cpp_sources = {}, bool builtin = false, enum kind kind = kind::none, enum contracts contracts = contracts::full) { return package{name, version, sources, cpp_sources, kind, builtin, contracts}; }
         };
         /**
          * Constructs a compilation object
@@ -86,13 +100,13 @@ namespace nemesis {
         /**
          * Construct current workspace
          */
-        void current(std::string name, std::string version, sources sources, compilation::sources cpp_sources = {}, bool builtin = false, enum package::kind kind = package::kind::none) { package_ = package::make(name, version, sources, cpp_sources, builtin, kind); }
+        void current(std::string name, std::string version, sources sources, compilation::sources cpp_sources = {}, bool builtin = false, enum package::kind kind = package::kind::none, enum package::contracts contracts = package::contracts::full) { package_ = package::make(name, version, sources, cpp_sources, builtin, kind, contracts); }
         /**
          * Adds a dependency library to current workspace
          */
-        void dependency(std::string name, std::string version, sources sources, compilation::sources cpp_sources = {}, bool builtin = false) 
+        void dependency(std::string name, std::string version, sources sources, compilation::sources cpp_sources = {}, bool builtin = false, enum package::contracts contracts = package::contracts::full) 
         { 
-            auto pkg = package::make(name, version, sources, cpp_sources, builtin);
+            auto pkg = package::make(name, version, sources, cpp_sources, builtin, package::kind::none, contracts);
             dependencies_.push_back(pkg); 
             packages_.emplace(name, pkg);
         }
@@ -126,7 +140,7 @@ namespace nemesis {
         /**
          * @return All packages, including current workspace
          */
-        std::unordered_map<std::string, struct package> packages() const
+        std::map<std::string, struct package> packages() const
         {
             auto result = packages_;
             result.emplace(package_.name, package_);
@@ -135,7 +149,7 @@ namespace nemesis {
         /**
          * @return Namespaces which are declared as `lib` or `app` inside files
          */
-        std::unordered_map<std::string, std::shared_ptr<ast::workspace>>& workspaces() const { return workspaces_; }
+        std::map<std::string, std::shared_ptr<ast::workspace>>& workspaces() const { return workspaces_; }
         /**
          * @return Diagnostic publisher
          */
@@ -153,22 +167,57 @@ namespace nemesis {
             // name of executable file
             std::string executable = compilation::executable_name;
             // C++17 is used as default standard
-            // adds builtin file
-            std::string command = "g++ -std=c++17 -lm -ggdb3";
+            std::string compiler = "g++ -std=c++17 -ggdb3";
             // adds test flag for different behaviour at run-time
-            if (test_) command += " -D __TEST__";
-            // adds output file if it's an application
-            if (package_.kind == package::kind::app) command += " -o " + executable;
+            if (test_) compiler += " -D __TEST__";
+            // adds benchmark flag to count allocations at run-time
+            if (bench_) compiler += " -D __BENCH__";
+            // benchmarks measure optimized code, while single compilation unit of unity builds is optimized as a whole
+            if (bench_ || unity_) compiler += " -O2";
+            // profiler walks frame pointers of sampled stacks, so they are kept even in optimized code
+            if (profile_) compiler += " -fno-omit-frame-pointer";
+            // adds builtin file
+            std::string command = compiler + " -lm";
+            // adds output file if it's an application or if tests of a library are executed
+            if (package_.kind == package::kind::app || test_) command += " -o " + executable;
             // or just compile if library
             else if (package_.kind == package::kind::lib) command += " -c -fsyntax-only";
-            // adds to compilation all cpp targets file generated by code generation
+            // units are compiled one by one into objects kept for next builds when an executable is linked
+            bool separate = !objects_.empty() && !unity_ && (package_.kind == package::kind::app || test_);
+            // creates all cpp files generated by code generation
             for (auto target : targets) {
                 // creates the cpp file
                 std::ofstream outfile(target.name.data());
                 // prints its content
                 outfile << target.content;
+            }
+            // error code
+            std::error_code code;
+            // save exit status
+            int status = 0;
+            // adds to compilation all cpp targets file generated by code generation
+            if (separate) std::filesystem::create_directories(objects_, code);
+            // any header may be included by a unit and instantiations of generics land into units of their workspaces
+            // according to requests of all the others, so object is keyed by the unit together with all headers
+            std::string headers;
+            for (auto target : targets) if (target.header) headers.append(target.content);
+            for (auto target : targets) {
+                if (target.header) continue;
                 // concat file path
-                if (!target.header) command.append(" ").append(target.name);
+                if (!separate) {
+                    command.append(" ").append(target.name);
+                    continue;
+                }
+                // object of unit, which is compiled again unless it's reusable and its digest is the one of last build
+                std::string object = this->object(target.name), content = target.content + headers;
+                std::string digest = std::to_string(impl::fnv1a(content.data(), content.size())), last;
+                std::ifstream(object + ".digest") >> last;
+                if (!target.reusable || last != digest || !std::filesystem::exists(object, code)) {
+                    std::filesystem::remove(object + ".digest", code);
+                    if ((status = std::system((compiler + " -c " + target.name + " -o " + object).data())) != 0) break;
+                    std::ofstream(object + ".digest") << digest;
+                }
+                command.append(" ").append(object);
             }
             // link in compilation all cpp source files from `cpp` directories of each package
             for (auto package : packages()) for (auto cpp : package.second.cpp_sources) {
@@ -179,10 +228,8 @@ namespace nemesis {
 
             // std::cout << "-- " << command << " --\n";
 
-            // save exit status
-            int status = std::system(command.data());
-            // error code
-            std::error_code code;
+            // compiles or links when all units were compiled
+            if (status == 0) status = std::system(command.data());
             // remove all temporary cpp compilation units
             for (auto target : targets) std::filesystem::remove(target.name, code);
             // second round is for running compilation command
@@ -192,15 +239,24 @@ namespace nemesis {
             }
             // success
             publisher_.publish(diagnostic::builder().severity(diagnostic::severity::none).message("compilation success, mate!").build());
-            // executes test if any and remove file
-            if (test_) {
-                status = std::system(("./" + executable).data());
+            // executes benchmarks with their arguments and remove file
+            if (bench_) {
+                status = std::system(("./" + executable + arguments_).data());
                 std::remove(executable.data());
                 return status == 0;
             }
             // exit with success
             return true;
         }
+        /**
+         * Set level of checking of contracts for all packages, overriding the one of their manifests
+         */
+        void contracts(enum package::contracts level)
+        {
+            package_.contracts = level;
+            for (auto& dependency : dependencies_) dependency.contracts = level;
+            for (auto& package : packages_) package.second.contracts = level;
+        }
         /**
          * Set test mode
          */
@@ -209,6 +265,46 @@ namespace nemesis {
          * Get test mode
          */
         bool test() const { return test_; }
+        /**
+         * Set benchmark mode
+         */
+        void bench(bool flag) { bench_ = flag; }
+        /**
+         * Get benchmark mode
+         */
+        bool bench() const { return bench_; }
+        /**
+         * Set unity mode
+         */
+        void unity(bool flag) { unity_ = flag; }
+        /**
+         * Get unity mode
+         */
+        bool unity() const { return unity_; }
+        /**
+         * Set profile mode
+         */
+        void profile(bool flag) { profile_ = flag; }
+        /**
+         * Get profile mode
+         */
+        bool profile() const { return profile_; }
+        /**
+         * Set directory where compilation units are compiled one by one into object files kept for next builds
+         */
+        void objects(std::string directory) { objects_ = directory; }
+        /**
+         * Get directory of object files, empty if units are compiled together
+         */
+        std::string objects() const { return objects_; }
+        /**
+         * @return Path of object file of compilation unit
+         */
+        std::string object(const std::string& unit) const { return objects_ + "/" + unit + ".o"; }
+        /**
+         * Append an argument for the executable of benchmarks
+         */
+        void argument(std::string arg) { arguments_ += " '" + arg + "'"; }
     private:
         /**
          * Diagnostic publisher
@@ -229,16 +325,36 @@ namespace nemesis {
         /**
          * Each dependency is registered with this key <name>@<version> or <name>
          */
-        std::unordered_map<std::string, struct package> packages_;
+        std::map<std::string, struct package> packages_;
         /**
          * This is namespaces map, which associates an entire set of definitions (namespace) to each workspace name (which should be library or app name)
          */
-        mutable std::unordered_map<std::string, std::shared_ptr<ast::workspace>> workspaces_;
+        mutable std::map<std::string, std::shared_ptr<ast::workspace>> workspaces_;
         /**
          * Test mode is used for generating a different entry point for the execution of tests
          * instead of normal main() entry point. It is false by default
          */
         bool test_ = false;
+        /**
+         * Benchmark mode generates an entry point which measures all benchmarks. It is false by default
+         */
+        bool bench_ = false;
+        /**
+         * Unity mode compiles the whole program as a single optimized compilation unit. It is false by default
+         */
+        bool unity_ = false;
+        /**
+         * Profile mode keeps frame pointers, which are walked by the sampler of the program. It is false by default
+         */
+        bool profile_ = false;
+        /**
+         * Directory of object files of compilation units, empty by default as units are compiled together
+         */
+        std::string objects_;
+        /**
+         * Arguments passed to the executable of benchmarks, like the filter on their names
+         */
+        std::string arguments_;
     };
 }
 
@@ -65,7 +65,11 @@ namespace nemesis {
             /**
              * Executes all test of current library
              */
-            test
+            test,
+            /**
+             * Measures all benchmarks of current workspace, or those whose name contains a filter
+             */
+            bench
         };
         /**
          * This class encapsulates argument options
@@ -92,7 +96,31 @@ namespace nemesis {
                 /**
                  * Dumps stack-trace if the program fails
                  */
-                trace = 0x10
+                trace = 0x10,
+                /**
+                 * Prints internal counters of semantic analysis
+                 */
+                stats = 0x20,
+                /**
+                 * Contracts are never tested, overriding manifests
+                 */
+                contracts_off = 0x40,
+                /**
+                 * Only preconditions of functions are tested, overriding manifests
+                 */
+                contracts_entry = 0x80,
+                /**
+                 * All contracts are tested, overriding manifests
+                 */
+                contracts_full = 0x100,
+                /**
+                 * Samples the running program and reports where it spends time
+                 */
+                profile = 0x200,
+                /**
+                 * Generates the whole program as a single optimized compilation unit
+                 */
+                unity = 0x400
             };
             options() = default;
             /**
@@ -225,6 +253,11 @@ namespace nemesis {
          * Compile source files given a compilation chain
          */
         void compile(class compilation& compilation);
+        /**
+         * Runs each test of the test executable in its own process, with many processes at once,
+         * and reports outcome, time and output of each test
+         */
+        void run_tests(const class compilation& compilation);
         /**
          * Exit code
          */
@@ -241,6 +274,26 @@ namespace nemesis {
          * Run-time arguments to pass if compile option is not set
          */
         std::vector<const char*> arguments_;
+        /**
+         * File of a previous run of benchmarks, whose results are compared against the new ones
+         */
+        std::string baseline_;
+        /**
+         * File where results of benchmarks are saved, so that they can be used as baseline later
+         */
+        std::string save_;
+        /**
+         * Number of tests which are executed at the same time, by default as many as hardware threads
+         */
+        unsigned jobs_ = 0;
+        /**
+         * Maximum time in seconds of a single test before it's killed
+         */
+        unsigned timeout_ = 60;
+        /**
+         * File where a JUnit report of tests is written, if any
+         */
+        std::string junit_;
         /**
          * driver executable pathname
          */
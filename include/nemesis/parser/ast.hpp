@@ -8,8 +8,10 @@
 #define AST_HPP
 
 #include <list>
+#include <map>
 #include <sstream>
 #include <memory>
+#include <stdexcept>
 
 #include "utils/safe.hpp"
 #include "nemesis/source/source.hpp"
@@ -82,16 +84,77 @@ namespace nemesis {
         using rational = utils::safe_rational;
         using complex = utils::safe_complex;
         using string = std::string;
-        using sequence = std::vector<constval>;
+        /**
+         * Elements of tuple, array and record values, which are shared between copies
+         * and only duplicated when a shared sequence is modified (copy-on-write).
+         * This way copying a constant aggregate from the evaluation stack into
+         * annotations and back costs a reference count and not its size
+         */
+        class sequence {
+        public:
+            using const_iterator = std::vector<constval>::const_iterator;
+
+            std::size_t size() const { return elements_ ? elements_->size() : 0; }
+            bool empty() const { return size() == 0; }
+            const constval& at(std::size_t i) const
+            {
+                if (!elements_) throw std::out_of_range("constval::sequence::at");
+                return elements_->at(i);
+            }
+            const constval& front() const { return at(0); }
+            const constval& back() const { return at(size() - 1); }
+            const_iterator begin() const { return elements_ ? elements_->cbegin() : const_iterator(); }
+            const_iterator end() const { return elements_ ? elements_->cend() : const_iterator(); }
+            /**
+             * @return Element at position `i` which can be modified without altering other copies
+             */
+            constval& modify(std::size_t i) { return detach().at(i); }
+            void reserve(std::size_t capacity) { detach().reserve(capacity); }
+            void push_back(const constval& value) { detach().push_back(value); }
+            void push_back(constval&& value) { detach().push_back(std::move(value)); }
+        private:
+            std::vector<constval>& detach()
+            {
+                if (!elements_) elements_ = std::make_shared<std::vector<constval>>();
+                else if (elements_.use_count() > 1) elements_ = std::make_shared<std::vector<constval>>(*elements_);
+                return *elements_;
+            }
+
+            std::shared_ptr<std::vector<constval>> elements_;
+        };
 
         constval();
 
         constval(const constval& other) : type(other.type), s(other.s), seq(other.seq)
         {
-            constexpr size_t offset = sizeof(type) + sizeof(s) + sizeof(seq);
             std::memcpy(reinterpret_cast<char*>(this) + offset, reinterpret_cast<const char*>(&other) + offset, sizeof(constval) - offset);
         }
 
+        constval(constval&& other) noexcept : type(std::move(other.type)), s(std::move(other.s)), seq(std::move(other.seq))
+        {
+            std::memcpy(reinterpret_cast<char*>(this) + offset, reinterpret_cast<const char*>(&other) + offset, sizeof(constval) - offset);
+        }
+
+        constval& operator=(const constval& other)
+        {
+            if (this == &other) return *this;
+            type = other.type;
+            s = other.s;
+            seq = other.seq;
+            std::memcpy(reinterpret_cast<char*>(this) + offset, reinterpret_cast<const char*>(&other) + offset, sizeof(constval) - offset);
+            return *this;
+        }
+
+        constval& operator=(constval&& other) noexcept
+        {
+            if (this == &other) return *this;
+            type = std::move(other.type);
+            s = std::move(other.s);
+            seq = std::move(other.seq);
+            std::memcpy(reinterpret_cast<char*>(this) + offset, reinterpret_cast<const char*>(&other) + offset, sizeof(constval) - offset);
+            return *this;
+        }
+
         size_t hash() const;
 
         ~constval() {}
@@ -111,6 +174,9 @@ namespace nemesis {
             complex c;
             real f;
         };
+    private:
+        // numeric members are trivially copyable, so they are copied as raw bytes after non trivial ones
+        static constexpr std::size_t offset = sizeof(type) + sizeof(s) + sizeof(seq);
     };
 
     namespace ast {
@@ -137,6 +203,7 @@ namespace nemesis {
             generic_const_parameter_declaration,
             generic_type_parameter_declaration,
             test_declaration,
+            bench_declaration,
             function_declaration,
             property_declaration,
             concept_declaration,
@@ -219,6 +286,10 @@ namespace nemesis {
              * or contains errors
              */
             mutable unsigned int invalid_ : 1;
+            /**
+             * Counter of constructed nodes
+             */
+            static std::size_t constructed_;
         public:
             /**
              * @return Node kind
@@ -246,6 +317,10 @@ namespace nemesis {
              * @param visitor Generic visitor
              */
             virtual void accept(visitor& visitor) const = 0;
+            /**
+             * @return Number of nodes constructed from a source range so far, clones included
+             */
+            static std::size_t constructed() { return constructed_; }
         };
 
         class function_declaration;
@@ -413,6 +488,10 @@ namespace nemesis {
                  * Resolved symbol for analysis
                  */
                 bool resolved : 1;
+                /**
+                 * Address taken, when a variable may be referenced through pointers or slices
+                 */
+                bool addressed : 1;
                 /**
                  * Use count, which is the number a declaration name is referenced
                  */
@@ -420,7 +499,7 @@ namespace nemesis {
                 /**
                  * Constructor
                  */
-                annotation() : visited(false), resolved(false) {}
+                annotation() : visited(false), resolved(false), addressed(false) {}
             };
             /**
              * Destroys the statement object
@@ -1606,6 +1685,62 @@ namespace nemesis {
              */
             mutable pointer<ast::expression> body_;
         };
+        /**
+         * A benchmark declaration is a block of code which is
+         * executed many times to measure its performance, for example
+         * `bench bench_this_unit {...}`
+         */
+        class bench_declaration : public ast::declaration {
+        public:
+            /**
+             * Constructs a new benchmark declaration object
+             * @param range Range in source code
+             * @param name Name of benchmark
+             * @param body Body of benchmark, which is a block like `{...}`
+             */
+            bench_declaration(source_range range, token name, pointer<ast::expression> body);
+            /**
+             * Destroys the declaration object
+             */
+            ~bench_declaration();
+            /**
+             * @return Benchmark name
+             */
+            token& name() const;
+            /**
+             * @return Benchmark body
+             */
+            pointer<ast::expression>& body() const;
+            /**
+             * Accepts a visitor for traversal
+             * @param visitor Generic visitor
+             */
+            void accept(visitor& visitor) const;
+            /**
+             * Clone a declaration
+             */
+            pointer<declaration> clone() const 
+            { 
+                auto result = create<bench_declaration>(range_, name_, body_->clone());
+                result->annotation_ = annotation_;
+                result->hidden(is_hidden());
+                return result;
+            }
+            pointer<statement> sclone() const { return clone(); }
+            /**
+             * @return Node kind
+             */
+            ast::kind kind() const { return kind::bench_declaration; } 
+        private:
+            /**
+             * Benchmark name 
+             */
+            mutable token name_;
+            /**
+             * Benchmark body
+             */
+            mutable pointer<ast::expression> body_;
+        };
         /**
          * Simple function declaration. For example
          * `function(T) if Compare(T) sort(mutable sequence: [T]) { ... }`
@@ -4448,6 +4583,22 @@ namespace nemesis {
              */
             mutable pointer<ast::expression> end_;
         };
+        /**
+         * Test performed by a pattern on the whole matched value, which is computed by
+         * pattern matcher and lets `when` expressions be compiled into decision trees
+         */
+        struct pattern_test {
+            enum class kind { unknown, any, values, alternative } kind = kind::unknown;
+            /**
+             * Inclusive intervals of integer, character or boolean values matched by the pattern, where values
+             * are mapped to unsigned keys preserving their order (signed values are offset by 2^63)
+             */
+            std::vector<std::pair<std::uint64_t, std::uint64_t>> intervals;
+            /**
+             * Variant alternative matched by the pattern, whose subpatterns are still tested by compiled condition
+             */
+            ast::pointer<ast::type> alternative = nullptr;
+        };
         /**
          * Root class for pattern expressions inside `when` body
          */
@@ -4467,9 +4618,15 @@ namespace nemesis {
              * Sets or gets compiled pattern condition
              */
             ast::pointer<ast::expression>& compiled() const { return compiled_; }
+            /**
+             * Sets or gets test performed by pattern on the whole matched value
+             */
+            pattern_test& test() const { return test_; }
         private:
             // condition compiled from pattern
             mutable ast::pointer<ast::expression> compiled_ = nullptr;
+            // test on the whole matched value
+            mutable pattern_test test_;
         };
         /**
          * In a `when` block we have an path pattern when
@@ -5695,11 +5852,11 @@ namespace nemesis {
             /**
              * Imported workspacees
              */
-            std::unordered_map<std::string, workspace*> imports;
+            std::map<std::string, workspace*> imports;
             /**
              * Source files associated
              */
-            std::unordered_map<std::string, source_file*> sources;
+            std::map<std::string, source_file*> sources;
             /**
              * Instantiated generics
              */
@@ -5743,6 +5900,10 @@ namespace nemesis {
              * List of tests in the same order of declaration
              */
             std::vector<const ast::test_declaration*> tests;
+            /**
+             * List of benchmarks in the same order of declaration
+             */
+            std::vector<const ast::bench_declaration*> benchmarks;
             /**
              * Tells if workspace is builtin
              */
@@ -5842,6 +6003,7 @@ namespace nemesis {
             virtual void visit(const generic_const_parameter_declaration& decl) {}
             virtual void visit(const generic_type_parameter_declaration& decl) {}
             virtual void visit(const test_declaration& decl) {}
+            virtual void visit(const bench_declaration& decl) {}
             virtual void visit(const function_declaration& decl) {}
             virtual void visit(const property_declaration& decl) {}
             virtual void visit(const concept_declaration& decl) {}
@@ -5923,6 +6085,7 @@ namespace nemesis {
             virtual void visit(const generic_const_parameter_declaration& decl);
             virtual void visit(const generic_type_parameter_declaration& decl);
             virtual void visit(const test_declaration& decl);
+            virtual void visit(const bench_declaration& decl);
             virtual void visit(const function_declaration& decl);
             virtual void visit(const property_declaration& decl);
             virtual void visit(const concept_declaration& decl);
@@ -380,6 +380,13 @@ namespace nemesis {
          * }`
          */
         ast::pointer<ast::declaration> test_declaration();
+        /**
+         * @return Benchmark declaration, whose body is executed many times to be measured, like 
+         * `bench my_bench {
+         *     ...
+         * }`
+         */
+        ast::pointer<ast::declaration> bench_declaration();
         /**
          * Parses a name declaration, which is a couple of identifier and type annotation, 
          * like hide a: 3` which has eventually `hide` before
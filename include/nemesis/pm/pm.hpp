@@ -84,6 +84,10 @@ namespace nemesis {
              * cpp files inside `.cpp` get involved
              */
             bool builtin = false;
+            /**
+             * Level of checking of contracts inside generated code of current package
+             */
+            enum compilation::package::contracts contracts = compilation::package::contracts::full;
             /**
              * List of dependencies of current package, no particular order
              */
@@ -171,6 +175,14 @@ namespace nemesis {
              * Path for cached packages' archives
              */
             static constexpr const char cache_path[] = ".cache";
+            /**
+             * Path for dependency graph and digests of sources from last successful build
+             */
+            static constexpr const char build_cache_path[] = ".cache/build";
+            /**
+             * Path for object files of compilation units from last builds
+             */
+            static constexpr const char objects_cache_path[] = ".cache/objects";
             /**
              * Manifest file path
              */
@@ -48,6 +48,8 @@ namespace nemesis {
             as_kw,
             /** 'behaviour' */
             behaviour_kw,
+            /** 'bench' */
+            bench_kw,
             /** 'break' */
             break_kw,
             /** `concept` */
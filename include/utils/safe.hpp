@@ -128,7 +128,7 @@ namespace utils {
         {
             safe_unsigned_int result(precisions::max(precision(), b.precision()));
 
-            if (value() > safe_unsigned_int::max(result.precision()) / b.value()) {
+            if (b.value() != 0 && value() > safe_unsigned_int::max(result.precision()) / b.value()) {
                 result.overflow(true);
             }
             
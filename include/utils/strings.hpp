@@ -3,9 +3,10 @@
 
 #include <algorithm>
 #include <string>
+#include <string_view>
 
 namespace utils {
-    unsigned levenshtein_distance(const std::string& x, const std::string& y)
+    inline unsigned levenshtein_distance(const std::string& x, const std::string& y)
     {
         unsigned** d = new unsigned*[x.size() + 1];
 
@@ -34,6 +35,48 @@ namespace utils {
 
         return distance;
     }
+    /**
+     * Tells if levenshtein distance between `x` and `y` is at most `bound`, which is
+     * equivalent to `levenshtein_distance(x, y) <= bound` but allocation free.
+     * Only the diagonal band of width 2 * bound + 1 is computed, which is the only part of
+     * the matrix that may contain a distance below the bound, and the computation
+     * stops as soon as a whole row exceeds the bound
+     */
+    inline bool levenshtein_within(std::string_view x, std::string_view y, unsigned bound)
+    {
+        constexpr unsigned max_bound = 8;
+        // lengths too different can't be close
+        if ((x.size() > y.size() ? x.size() - y.size() : y.size() - x.size()) > bound) return false;
+        // fallback for wide bands, never used by suggestions
+        if (bound > max_bound) return levenshtein_distance(std::string(x), std::string(y)) <= bound;
+        // values above the bound are saturated to 'infinity'
+        const unsigned infinity = bound + 1, width = 2 * bound + 1;
+        unsigned previous[2 * max_bound + 1], current[2 * max_bound + 1];
+        // cell (i, j) is stored at index j - i + bound of row i
+        std::fill(previous, previous + width, infinity);
+        for (unsigned j = 0; j <= bound && j <= y.size(); ++j) previous[j + bound] = j;
+
+        for (unsigned i = 1; i <= x.size(); ++i) {
+            unsigned minimum = infinity;
+            std::fill(current, current + width, infinity);
+            if (i <= bound) minimum = current[bound - i] = i;
+
+            for (unsigned j = i > bound ? i - bound : 1; j <= y.size() && j <= i + bound; ++j) {
+                unsigned k = j + bound - i;
+                unsigned cost = previous[k] + (x[i - 1] == y[j - 1] ? 0 : 1);
+                if (k + 1 < width) cost = std::min(cost, previous[k + 1] + 1);
+                if (k > 0) cost = std::min(cost, current[k - 1] + 1);
+                current[k] = std::min(cost, infinity);
+                minimum = std::min(minimum, current[k]);
+            }
+            // all paths already exceed the bound
+            if (minimum > bound) return false;
+
+            std::copy(current, current + width, previous);
+        }
+
+        return previous[y.size() + bound - x.size()] <= bound;
+    }
 }
 
 #endif // STRINGS_HPP
\ No newline at end of file
@@ -1,13 +1,25 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <map>
 #include <mutex>
+#include <new>
+#include <regex>
+#include <set>
 #include <unordered_map>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/ucontext.h>
+#include <unistd.h>
+#include <unwind.h>
 
 #include "core.h"
 
-// stack table which is thread local
-thread_local static std::vector<__stack_entry> __stack_table;
+// maximum number of frames which are printed in a stack trace
+constexpr const std::size_t __max_frames = 64;
 // file content table to print stack traces in a pretty way
 static std::unordered_map<std::string, std::unique_ptr<char>> __sources;
 // mutex for shared access among threads to sources table in order to be updated with file content when printing errors
@@ -75,16 +87,70 @@ std::size_t __get_size(std::string arg) { return arg.size(); }
 
 std::size_t __get_length(std::string arg) { return __chars(arg.data(), arg.size()).length(); }
 
-__stack_activation_record::__stack_activation_record(const char* file, const char* function, unsigned int line, unsigned int column) { __stack_table.emplace_back(file, function, line, column); }
+// tables of functions registered by each compiled source file in tracing mode, they are initialized before main so no lock is needed
+static std::vector<std::pair<const __frame*, std::size_t>>& __frames_tables()
+{
+    static std::vector<std::pair<const __frame*, std::size_t>> tables;
+    return tables;
+}
+
+__frames_registration::__frames_registration(const __frame* frames, std::size_t size) { __frames_tables().emplace_back(frames, size); }
+
+static const __frame* __find_frame(const void* function)
+{
+    for (auto& table : __frames_tables()) {
+        for (std::size_t i = 0; i < table.second; ++i) {
+            if (table.first[i].function == function) return &table.first[i];
+        }
+    }
+
+    return nullptr;
+}
+
+struct __backtrace {
+    const __frame* frames[__max_frames];
+    // location of the statement being executed by each frame, or its declaration
+    __location sites[__max_frames];
+    std::size_t size;
+};
+
+// each return address is mapped to its enclosing function, frames of functions not compiled from source (like runtime functions) are skipped
+static _Unwind_Reason_Code __collect_frame(struct _Unwind_Context* context, void* argument)
+{
+    auto trace = static_cast<__backtrace*>(argument);
+    auto address = _Unwind_GetIP(context);
+
+    if (address == 0) return _URC_END_OF_STACK;
+
+    if (auto frame = __find_frame(_Unwind_FindEnclosingFunction(reinterpret_cast<void*>(address - 1)))) {
+        trace->frames[trace->size] = frame;
+        trace->sites[trace->size] = { frame->file, frame->line, frame->column };
+        if (++trace->size == __max_frames) return _URC_END_OF_STACK;
+    }
+
+    return _URC_NO_REASON;
+}
 
-__stack_activation_record::~__stack_activation_record() { __stack_table.pop_back(); }
+thread_local __call* __call::current = nullptr;
 
-void __stack_activation_record::location(int line, int column)
+// calls of traced functions are chained with the statements they are executing, otherwise only declarations of functions are known
+static __backtrace __collect_backtrace()
 {
-    if (!__stack_table.empty()) {
-        __stack_table.back().line = line;
-        __stack_table.back().column = column;
+    __backtrace trace;
+    trace.size = 0;
+    if (__frames_tables().empty()) return trace;
+    if (!__call::current) {
+        _Unwind_Backtrace(__collect_frame, &trace);
+        return trace;
     }
+    for (const __call* call = __call::current; call && trace.size < __max_frames; call = call->caller) {
+        auto frame = __find_frame(call->function);
+        if (!frame) continue;
+        const __location* site = call->location;
+        trace.frames[trace.size] = frame;
+        trace.sites[trace.size++] = site ? *site : __location { frame->file, frame->line, frame->column };
+    }
+    return trace;
 }
 
 inline void __exit(std::int32_t code) 
@@ -107,9 +173,7 @@ void __crash(std::string message, const char* file, int line, int column)
 {
     if (!file || line <= 0) std::cerr << "• crash: " << message << '\n';
     else std::cerr << "• crash at " << file << ":" << line << ":" << column << ": " << message << '\n';
-#if __DEVELOPMENT__
     __stacktrace();
-#endif
     __exit(EXIT_FAILURE);
 }
 
@@ -119,35 +183,50 @@ void __assert(bool condition, std::string message, const char* file, int line, i
     if (!file || line <= 0) std::cerr << "• violation";
     else std::cerr << "• violation at " << file << ":" << line << ":" << column;
     if (!message.empty()) std::cerr << ": " << message << '\n';
-#if __DEVELOPMENT__
     __stacktrace();
-#endif
     __exit(EXIT_FAILURE);
 }
 
+void __crash(const char* message, const __location& location)
+{
+    std::cerr << "• crash at " << location.file << ":" << location.line << ":" << location.column << ": " << message << '\n';
+    __stacktrace();
+    __exit(EXIT_FAILURE);
+}
+
+void __crash(const std::string& message, const __location& location) { __crash(message.c_str(), location); }
+
+void __violation(const char* message, const __location& location)
+{
+    std::cerr << "• violation at " << location.file << ":" << location.line << ":" << location.column;
+    if (*message) std::cerr << ": " << message << '\n';
+    __stacktrace();
+    __exit(EXIT_FAILURE);
+}
+
+void __violation(const std::string& message, const __location& location) { __violation(message.c_str(), location); }
+
 void __stacktrace()
 {
-    if (__stack_table.empty()) return;
+    auto trace = __collect_backtrace();
+
+    if (trace.size == 0) return;
 
     std::unique_lock<std::mutex> lock(__sources_mutex);
 
     std::cout << "• stack traces\n";
 
-    for (unsigned int depth = 0; depth < __stack_table.size(); ++depth) {
-        __stack_entry entry = __stack_table[__stack_table.size() - 1 - depth];
+    for (unsigned int depth = 0; depth < trace.size; ++depth) {
+        const __location& site = trace.sites[depth];
         std::vector<std::string> before, after;
-        std::string line = __get_line_from_source(entry.file, entry.line, entry.column, before, after);
-        unsigned iline = entry.line - before.size(), width = entry.line + after.size() < 10 ? 1 : std::log10(entry.line + after.size()) + 1;
-        std::cout << "  #" << depth << " " << entry.function  << " at " << entry.file << ":" << entry.line << ":" << entry.column << "\n";
+        std::string line = __get_line_from_source(site.file, site.line, site.column, before, after);
+        unsigned iline = site.line - before.size(), width = site.line + after.size() < 10 ? 1 : std::log10(site.line + after.size()) + 1;
+        std::cout << "  #" << depth << " " << trace.frames[depth]->name  << " at " << site.file << ":" << site.line << ":" << site.column << "\n";
         if (line.empty()) continue;
         for (auto line : before) std::cout << "     " << std::setw(width) << iline++ << " | " << line << '\n';
         std::cout << "  -> " << std::setw(width) << iline++ << " | " << line << '\n';
         for (auto line : after) std::cout << "     " << std::setw(width) << iline++ << " | " << line << '\n';
     }
-
-#ifndef __TEST__
-    __stack_table.clear();
-#endif
 }
 
 void __signal_handler(int signo)
@@ -179,18 +258,418 @@ void __signal_handler(int signo)
 
     std::cout << ", terminating the program...\n";
 
-    std::unique_lock<std::mutex> lock(__sources_mutex);
-    
-    std::cout << "• stack traces\n";
+    auto trace = __collect_backtrace();
+
+    if (trace.size > 0) std::cout << "• stack traces\n";
 
-    for (unsigned int depth = 0; depth < __stack_table.size(); ++depth) {
-        __stack_entry entry = __stack_table[__stack_table.size() - 1 - depth];
-        std::cout << "  #" << depth << " " << entry.function  << " at " << entry.file << ":" << entry.line << ":" << entry.column << "\n";
+    for (unsigned int depth = 0; depth < trace.size; ++depth) {
+        const __location& site = trace.sites[depth];
+        std::cout << "  #" << depth << " " << trace.frames[depth]->name  << " at " << site.file << ":" << site.line << ":" << site.column << "\n";
     }
 
-#ifndef __TEST__
-    __stack_table.clear();
+    _Exit(EXIT_FAILURE);
+}
+// maximum number of return addresses recorded by each sample of the profiler
+constexpr const std::size_t __profile_depth = 32;
+// number of samples kept by each thread, older samples are overwritten
+constexpr const std::size_t __profile_capacity = 2048;
+// maximum number of threads which are sampled
+constexpr const std::size_t __profile_threads = 8;
+// sampling period of cpu time in microseconds
+constexpr const long __profile_period = 1000;
+// folded stacks file written at exit, ready to be drawn as a flame graph
+constexpr const char* __profile_output = "profile.folded";
+
+// first address is the interrupted instruction, the others are return addresses decremented into their calls
+struct __sample {
+    std::size_t size;
+    std::uintptr_t addresses[__profile_depth];
+};
+
+// each thread owns a ring of samples, so the signal handler never takes a lock nor allocates memory
+struct __samples_ring {
+    std::atomic<std::size_t> count;
+    __sample samples[__profile_capacity];
+};
+
+static __samples_ring __profile_rings[__profile_threads];
+static std::atomic<std::size_t> __profile_slots(0);
+// samples of threads which found no free ring, they are reported at exit
+static std::atomic<std::size_t> __profile_lost(0);
+static std::atomic<bool> __profiling(false);
+// pipe used to probe whether stack memory is readable, as write fails instead of faulting on bad addresses
+static int __profile_probe[2] = { -1, -1 };
+thread_local static __samples_ring* __profile_ring = nullptr;
+
+// program counter and frame pointer of the interrupted context
+static bool __profile_registers(void* context, std::uintptr_t& pc, std::uintptr_t& fp)
+{
+#if defined(__linux__) && defined(__x86_64__)
+    auto& registers = static_cast<ucontext_t*>(context)->uc_mcontext;
+    pc = registers.gregs[REG_RIP];
+    fp = registers.gregs[REG_RBP];
+#elif defined(__linux__) && defined(__aarch64__)
+    auto& registers = static_cast<ucontext_t*>(context)->uc_mcontext;
+    pc = registers.pc;
+    fp = registers.regs[29];
+#elif defined(__APPLE__) && defined(__x86_64__)
+    auto& registers = static_cast<ucontext_t*>(context)->uc_mcontext->__ss;
+    pc = registers.__rip;
+    fp = registers.__rbp;
+#elif defined(__APPLE__) && defined(__aarch64__)
+    auto& registers = static_cast<ucontext_t*>(context)->uc_mcontext->__ss;
+    pc = registers.__pc;
+    fp = registers.__fp;
+#else
+    return false;
 #endif
+    return true;
+}
 
-    _Exit(EXIT_FAILURE);
-}
\ No newline at end of file
+// tells if a frame record can be read, while the page verified last is not probed again, where zero page is never mapped
+static bool __profile_readable(std::uintptr_t address, std::uintptr_t& page)
+{
+    constexpr std::uintptr_t size = 4096;
+    char record[2 * sizeof(std::uintptr_t)];
+    auto first = address & ~(size - 1), last = (address + sizeof(record) - 1) & ~(size - 1);
+
+    if (page != 0 && first == page && last == page) return true;
+    // written bytes are drained back, even when the write stops early on an unreadable page
+    auto written = write(__profile_probe[1], reinterpret_cast<const void*>(address), sizeof(record));
+    if (written > 0 && read(__profile_probe[0], record, written) != written) return false;
+    if (written != sizeof(record)) return false;
+    page = last;
+
+    return true;
+}
+
+// only the interrupted program counter and return addresses found by walking frame pointers are recorded,
+// since unwinding takes locks and may allocate, which could deadlock a sample landing inside them
+static void __profile_handler(int signo, siginfo_t* info, void* context)
+{
+    if (!__profiling.load(std::memory_order_relaxed)) return;
+
+    auto error = errno;
+
+    if (!__profile_ring) {
+        auto slot = __profile_slots.fetch_add(1, std::memory_order_relaxed);
+        if (slot < __profile_threads) __profile_ring = &__profile_rings[slot];
+    }
+
+    std::uintptr_t pc = 0, fp = 0, page = 0;
+
+    if (!__profile_ring) __profile_lost.fetch_add(1, std::memory_order_relaxed);
+    else if (__profile_registers(context, pc, fp)) {
+        auto count = __profile_ring->count.load(std::memory_order_relaxed);
+        auto& sample = __profile_ring->samples[count % __profile_capacity];
+        sample.size = 0;
+        sample.addresses[sample.size++] = pc;
+        // frame records hold the previous frame pointer followed by the return address, and they go up the stack
+        while (sample.size < __profile_depth && fp != 0 && fp % sizeof(std::uintptr_t) == 0 && __profile_readable(fp, page)) {
+            auto record = reinterpret_cast<const std::uintptr_t*>(fp);
+            if (record[1] == 0) break;
+            // return addresses point after the call
+            sample.addresses[sample.size++] = record[1] - 1;
+            if (record[0] <= fp || record[0] - fp > (1 << 20)) break;
+            fp = record[0];
+        }
+        __profile_ring->count.store(count + 1, std::memory_order_release);
+    }
+
+    errno = error;
+}
+
+__profiler::__profiler()
+{
+    if (pipe(__profile_probe) != 0) return;
+    for (auto fd : __profile_probe) fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_sigaction = __profile_handler;
+    action.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+
+    __profiling.store(true);
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = timer.it_value.tv_sec = 0;
+    timer.it_interval.tv_usec = timer.it_value.tv_usec = __profile_period;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+// samples are resolved against tables of functions only at exit, so that sampling stays cheap
+__profiler::~__profiler()
+{
+    struct itimerval timer;
+    std::memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    __profiling.store(false);
+
+    close(__profile_probe[0]);
+    close(__profile_probe[1]);
+
+    std::unordered_map<std::uintptr_t, const __frame*> resolved;
+    std::map<std::string, std::size_t> stacks;
+    std::map<const __frame*, std::pair<std::size_t, std::size_t>> counts;
+    std::size_t total = 0, dropped = 0;
+
+    auto resolve = [&] (std::uintptr_t address) {
+        auto found = resolved.find(address);
+        if (found != resolved.end()) return found->second;
+        auto frame = __find_frame(_Unwind_FindEnclosingFunction(reinterpret_cast<void*>(address)));
+        resolved.emplace(address, frame);
+        return frame;
+    };
+
+    for (std::size_t slot = 0; slot < std::min(__profile_slots.load(), __profile_threads); ++slot) {
+        auto count = __profile_rings[slot].count.load(std::memory_order_acquire);
+        if (count > __profile_capacity) dropped += count - __profile_capacity;
+        for (std::size_t i = 0; i < std::min(count, __profile_capacity); ++i) {
+            auto& sample = __profile_rings[slot].samples[i];
+            std::vector<const __frame*> frames;
+            for (std::size_t depth = 0; depth < sample.size; ++depth) {
+                if (auto frame = resolve(sample.addresses[depth])) frames.push_back(frame);
+            }
+            // samples taken outside of compiled functions, like during static initialization, are discarded
+            if (frames.empty()) continue;
+            ++total;
+            // folded stack goes from the outermost function to the innermost one
+            std::string stack;
+            for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame) {
+                if (!stack.empty()) stack += ';';
+                stack += (*frame)->name;
+            }
+            ++stacks[stack];
+            // self time goes to the innermost function, while recursive functions are counted once in total time
+            ++counts[frames.front()].first;
+            for (auto frame : std::set<const __frame*>(frames.begin(), frames.end())) ++counts[frame].second;
+        }
+    }
+
+    std::ofstream output(__profile_output);
+    for (auto& stack : stacks) output << stack.first << ' ' << stack.second << '\n';
+    output.close();
+
+    std::cerr << "• profile of " << total << " samples every " << __profile_period << " µs written to " << __profile_output;
+    if (dropped > 0) std::cerr << ", " << dropped << " older samples were overwritten";
+    if (auto lost = __profile_lost.load()) std::cerr << ", " << lost << " samples of threads beyond the first " << __profile_threads << " were dropped";
+    std::cerr << '\n';
+
+    if (total == 0) return;
+
+    std::vector<std::pair<const __frame*, std::pair<std::size_t, std::size_t>>> top(counts.begin(), counts.end());
+    std::sort(top.begin(), top.end(), [] (auto& left, auto& right) { return left.second.first > right.second.first || (left.second.first == right.second.first && left.second.second > right.second.second); });
+    if (top.size() > 10) top.resize(10);
+
+    std::cerr << "     self    total  function\n";
+    for (auto& entry : top) {
+        std::cerr << std::fixed << std::setprecision(1) << "  " << std::setw(6) << 100.0 * entry.second.first / total << "%  " << std::setw(6) << 100.0 * entry.second.second / total << "%  ";
+        std::cerr << entry.first->name << " at " << entry.first->file << ":" << entry.first->line << ":" << entry.first->column << '\n';
+    }
+}
+
+#ifdef __TEST__
+// with no arguments all tests are executed in order, otherwise `-list` prints one test per line
+// as name, file and line separated by tabs, while `-run <index>` executes a single test
+int __run_tests(const __test* tests, std::size_t size, int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp("-list", argv[1]) == 0) {
+        for (std::size_t i = 0; i < size; ++i) std::printf("%s\t%s\t%u\n", tests[i].name, tests[i].file, tests[i].line);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 2 && std::strcmp("-run", argv[1]) == 0) {
+        auto index = std::strtoul(argv[2], nullptr, 10);
+        if (index >= size) {
+            std::printf("• there's no test at index %lu, idiot...\n", index);
+            return EXIT_FAILURE;
+        }
+        // output is redirected to a file by the driver, so it's flushed at each line in case the test gets killed
+        std::setvbuf(stdout, nullptr, _IOLBF, 0);
+        return tests[index].function() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    std::size_t passed = 0;
+    for (std::size_t i = 0; i < size; ++i) passed += tests[i].function();
+    if (size > 0) std::printf("• you passed %lu out of %lu tests! %s\n", passed, size, passed < (float) size / 2 ? "You could have done better, try again, pal. 😑" : "Not bad! 💪");
+
+    return passed == size ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#endif
+
+#ifdef __BENCH__
+// each sample of a benchmark lasts at least this time in nanoseconds
+constexpr const double __bench_sample_time = 1e7;
+// number of samples from which mean and deviation are computed
+constexpr const std::size_t __bench_samples = 10;
+// slowdown relative to baseline which is considered a regression
+constexpr const double __bench_regression = 0.1;
+
+// allocations made by the program, which are counted only when measuring benchmarks
+static std::atomic<std::size_t> __allocations(0);
+
+void* operator new(std::size_t size)
+{
+    __allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto memory = std::malloc(size > 0 ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+static double __bench_measure(const __benchmark& benchmark, std::uint64_t iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    benchmark.function(iterations);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// quotes a string as JSON, escaping quotes, backslashes and control characters
+static std::string __bench_json_string(const char* value)
+{
+    std::ostringstream result;
+
+    result << '"';
+    for (auto c = value; *c; ++c) {
+        switch (*c) {
+            case '"': result << "\\\""; break;
+            case '\\': result << "\\\\"; break;
+            case '\n': result << "\\n"; break;
+            case '\r': result << "\\r"; break;
+            case '\t': result << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(*c) < 0x20) result << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(*c) << std::dec;
+                else result << *c;
+        }
+    }
+    result << '"';
+
+    return result.str();
+}
+
+// reads back a string quoted as JSON by `__bench_json_string`
+static std::string __bench_json_unquote(const std::string& value)
+{
+    std::string result;
+
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        if (value[i] != '\\' || i + 1 == value.size()) {
+            result += value[i];
+            continue;
+        }
+        switch (value[++i]) {
+            case 'n': result += '\n'; break;
+            case 'r': result += '\r'; break;
+            case 't': result += '\t'; break;
+            case 'u': result += static_cast<char>(std::stoi(value.substr(i + 1, 4), nullptr, 16)); i += 4; break;
+            default: result += value[i];
+        }
+    }
+
+    return result;
+}
+
+static bool __bench_load_baseline(const std::string& path, std::unordered_map<std::string, double>& baseline)
+{
+    std::ifstream stream(path);
+
+    if (!stream.is_open()) return false;
+
+    std::string content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    // strings are skipped as a whole, since escaped quotes and braces may appear inside file paths
+    std::regex entry("\"name\"\\s*:\\s*\"((?:[^\"\\\\]|\\\\.)*)\"(?:[^\"}]|\"(?:[^\"\\\\]|\\\\.)*\")*\"ns_per_op\"\\s*:\\s*([-+0-9.eE]+)");
+
+    for (auto match = std::sregex_iterator(content.begin(), content.end(), entry); match != std::sregex_iterator(); ++match) {
+        baseline[__bench_json_unquote((*match)[1].str())] = std::stod((*match)[2].str());
+    }
+
+    return true;
+}
+
+int __run_benchmarks(const __benchmark* benchmarks, std::size_t size, int argc, char** argv)
+{
+    std::string filter, baseline_path, save_path;
+    std::unordered_map<std::string, double> baseline;
+    std::string results;
+    std::size_t measured = 0, regressions = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp("-baseline=", argv[i], 10) == 0) baseline_path = argv[i] + 10;
+        else if (std::strncmp("-save=", argv[i], 6) == 0) save_path = argv[i] + 6;
+        else filter = argv[i];
+    }
+
+    if (!baseline_path.empty() && !__bench_load_baseline(baseline_path, baseline)) {
+        std::printf("• I couldn't read baseline '%s', idiot...\n", baseline_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    for (std::size_t i = 0; i < size; ++i) {
+        const __benchmark& benchmark = benchmarks[i];
+        if (std::strstr(benchmark.name, filter.c_str()) == nullptr) continue;
+
+        std::printf("• running benchmark '%s'...\n", benchmark.name);
+        std::fflush(stdout);
+        // iterations are scaled until a run lasts as a sample, which also warms up caches and branch predictors
+        std::uint64_t iterations = 1;
+        for (double elapsed = __bench_measure(benchmark, iterations); elapsed < __bench_sample_time; elapsed = __bench_measure(benchmark, iterations)) {
+            iterations = static_cast<std::uint64_t>(iterations * (elapsed > 0 ? std::max(2.0, std::min(100.0, 1.2 * __bench_sample_time / elapsed)) : 100.0));
+        }
+        // samples of time per iteration
+        double samples[__bench_samples], mean = 0, variance = 0;
+        auto allocations = __allocations.load(std::memory_order_relaxed);
+        for (std::size_t j = 0; j < __bench_samples; ++j) {
+            samples[j] = __bench_measure(benchmark, iterations) / iterations;
+            mean += samples[j];
+        }
+        auto allocations_per_op = static_cast<double>(__allocations.load(std::memory_order_relaxed) - allocations) / (iterations * __bench_samples);
+        mean /= __bench_samples;
+        for (auto sample : samples) variance += (sample - mean) * (sample - mean);
+        auto deviation = std::sqrt(variance / (__bench_samples - 1));
+        auto throughput = mean > 0 ? 1e9 / mean : 0;
+
+        std::printf("• '%s': %.2f ns/op ± %.2f ns, %.0f ops/s, %.2f allocs/op\n", benchmark.name, mean, deviation, throughput, allocations_per_op);
+        
+        auto previous = baseline.find(benchmark.name);
+        if (previous != baseline.end() && previous->second > 0) {
+            auto change = (mean - previous->second) / previous->second;
+            if (change > __bench_regression) {
+                std::printf("• regression for '%s', it's %.1f%% slower than baseline, f*ck...\n", benchmark.name, 100 * change);
+                ++regressions;
+            }
+            else std::printf("• '%s' changed by %+.1f%% from baseline\n", benchmark.name, 100 * change);
+        }
+
+        std::ostringstream entry;
+        entry << std::fixed << (measured++ > 0 ? ",\n" : "") << "        { \"name\": " << __bench_json_string(benchmark.name) << ", \"file\": " << __bench_json_string(benchmark.file) << ", \"line\": " << benchmark.line;
+        entry << std::setprecision(3) << ", \"ns_per_op\": " << mean << ", \"stddev\": " << deviation;
+        entry << std::setprecision(0) << ", \"ops_per_s\": " << throughput << std::setprecision(3) << ", \"allocs_per_op\": " << allocations_per_op << " }";
+        results += entry.str();
+    }
+
+    if (!save_path.empty()) {
+        auto output = std::fopen(save_path.c_str(), "w");
+        if (!output || std::fprintf(output, "{\n    \"benchmarks\": [\n%s\n    ]\n}\n", results.c_str()) < 0) {
+            std::printf("• I couldn't save results into '%s', idiot...\n", save_path.c_str());
+            if (output) std::fclose(output);
+            return EXIT_FAILURE;
+        }
+        std::fclose(output);
+    }
+
+    if (regressions > 0) {
+        std::printf("• %lu out of %lu benchmarks regressed from baseline! 😑\n", regressions, measured);
+        return EXIT_FAILURE;
+    }
+
+    if (measured > 0) std::printf("• you measured %lu benchmarks! 💪\n", measured);
+
+    return EXIT_SUCCESS;
+}
+#endif
@@ -20,18 +20,55 @@
 
 struct __char { std::int32_t codepoint; };
 
-struct __stack_entry {
+struct __location {
     const char* file;
-    const char* function;
     unsigned int line;
     unsigned int column;
-    constexpr __stack_entry(const char* file, const char* function, unsigned int line, unsigned int column) : file(file), function(function), line(line), column(column) {}
 };
 
-struct __stack_activation_record {
-    __stack_activation_record(const char* file, const char* function, unsigned int line, unsigned int column);
-    ~__stack_activation_record();
-    void location(int line, int column);
+struct __frame {
+    const void* function;
+    const char* file;
+    const char* name;
+    unsigned int line;
+    unsigned int column;
+};
+
+// call of a traced function, chained to the one of its caller on the same thread, even when inlined
+struct __call {
+    static thread_local __call* current;
+    const void* function;
+    const __location* volatile location = nullptr;
+    __call* caller;
+
+    explicit __call(const void* function) : function(function), caller(current) { current = this; }
+    ~__call() { current = caller; }
+    __call(const __call&) = delete;
+    __call& operator=(const __call&) = delete;
+};
+
+struct __frames_registration {
+    __frames_registration(const __frame* frames, std::size_t size);
+};
+
+struct __profiler {
+    __profiler();
+    ~__profiler();
+};
+
+struct __test {
+    const char* name;
+    const char* file;
+    unsigned int line;
+    int (*function)();
+};
+
+struct __benchmark {
+    const char* name;
+    const char* file;
+    unsigned int line;
+    unsigned int column;
+    void (*function)(std::uint64_t);
 };
 
 class __chars_iterator;
@@ -47,15 +84,23 @@ template<typename Arg, typename... Args> void __impl_format(std::ostringstream&
 template<typename Arg> void __impl_format(std::ostringstream& os, const char *fmt, Arg arg);
 template<typename... Args> std::string __format(std::string format, Args ...args);
 template<typename T> constexpr std::size_t __sizeof() { return sizeof(T); }
+template<typename T> inline T __black_box(T value) { asm volatile("" : : "g"(&value) : "memory"); return value; }
 template<typename T> __slice<T> __allocate(std::size_t n);
 template<typename T> void __deallocate(__slice<T> slice);
 template<typename T> inline void __free(T* memory);
 void __println(std::string s);
-void __crash(std::string message, const char* file = nullptr, int line = 0, int column = 0);
+[[noreturn]] void __crash(std::string message, const char* file = nullptr, int line = 0, int column = 0);
 void __assert(bool condition, std::string message, const char* file = nullptr, int line = 0, int column = 0);
-void __exit(std::int32_t code);
+[[noreturn]] __attribute__((cold, noinline)) void __crash(const char* message, const __location& location);
+[[noreturn]] __attribute__((cold, noinline)) void __crash(const std::string& message, const __location& location);
+[[noreturn]] __attribute__((cold, noinline)) void __violation(const char* message, const __location& location);
+[[noreturn]] __attribute__((cold, noinline)) void __violation(const std::string& message, const __location& location);
+template<typename... Args> [[noreturn]] __attribute__((cold, noinline)) void __fail(const __location* location, const char* format, Args... args);
+[[noreturn]] void __exit(std::int32_t code);
 void __stacktrace();
 void __signal_handler(int signo);
+int __run_tests(const __test* tests, std::size_t size, int argc, char** argv);
+int __run_benchmarks(const __benchmark* benchmarks, std::size_t size, int argc, char** argv);
 
 class __chars_iterator {
 public:
@@ -155,15 +200,15 @@ public:
     constexpr T& operator[](std::size_t index) const 
     {
 #if __DEVELOPMENT__
-        if (index >= size_) __crash(__format("slice index out of bounds, ? when size is ?", index, size_));
+        if (__builtin_expect(index >= size_, 0)) __fail(nullptr, "slice index out of bounds, ? when size is ?", index, size_);
 #endif 
         return data_[index]; 
     }
     constexpr __slice<T> slice(std::size_t begin, std::size_t end) const
     {
 #if __DEVELOPMENT__
-        if (begin >= size_) __crash(__format("slice start index out of bounds, ? when size is ?", begin, size_));
-        if (end > size_) __crash(__format("slice end index out of bounds, ? when size is ?", end, size_));
+        if (__builtin_expect(begin >= size_, 0)) __fail(nullptr, "slice start index out of bounds, ? when size is ?", begin, size_);
+        if (__builtin_expect(end > size_, 0)) __fail(nullptr, "slice end index out of bounds, ? when size is ?", end, size_);
 #endif
         return __slice<T>(data_ + begin, end - begin); 
     }
@@ -193,7 +238,7 @@ public:
             denominator_ = denominator / divisor;
         }
 #if __DEVELOPMENT__
-        if (denominator == 0) __crash("denominator of rational number cannot be zero, damn!");
+        if (__builtin_expect(denominator == 0, 0)) __crash("denominator of rational number cannot be zero, damn!");
 #endif
     }
     template<typename FloatType>
@@ -278,13 +323,17 @@ private:
     T numerator_, denominator_; 
 };
 
+// closure is a pair of context, which is the closure object holding captured variables, and a plain function pointer to call it
 template<typename Result, typename... Args>
 struct __lambda {
-    __lambda() = default;
-    virtual ~__lambda() {}
-    virtual Result operator()(Args... args) = 0;
+    void* context;
+    Result (*function)(void*, Args...);
+    Result operator()(Args... args) const { return function(context, args...); }
 };
 
+template<typename Closure, typename Result, typename... Args>
+Result __invoke(void* context, Args... args) { return (*static_cast<Closure*>(context))(args...); }
+
 class __later {
 public:
     __later(std::function<void()> callback) : callback_(callback) {}
@@ -321,7 +370,7 @@ public:
     constexpr __range(T min = std::numeric_limits<T>::min(), T max = std::numeric_limits<T>::max()) : min_(min), max_(max) 
     {
 #if __DEVELOPMENT__
-        if (min > max) __crash(__format("in range minimum value ? is greater than ?, idiot", min, max));
+        if (__builtin_expect(min > max, 0)) __fail(nullptr, "in range minimum value ? is greater than ?, idiot", min, max);
 #endif 
     }
     constexpr T min() const { return min_; }
@@ -353,7 +402,7 @@ template<typename T, std::size_t N> constexpr std::size_t __get_size(T (&array)[
 template<std::size_t N, typename T> constexpr T& __array_at(T* array, std::size_t index) 
 {
 #if __DEVELOPMENT__
-    if (index >= N) __crash(__format("array index out of bounds, ? when size is ?", index, N));
+    if (__builtin_expect(index >= N, 0)) __fail(nullptr, "array index out of bounds, ? when size is ?", index, N);
 #endif 
     return array[index]; 
 }
@@ -361,12 +410,18 @@ template<std::size_t N, typename T> constexpr T& __array_at(T* array, std::size_
 template<std::size_t N, typename T> constexpr __slice<T> __get_slice(T* array, std::size_t begin, std::size_t end)
 {
 #if __DEVELOPMENT__
-    if (begin >= N) __crash(__format("array start index out of bounds, ? when size is ?", begin, N));
-    if (end > N) __crash(__format("array end index out of bounds, ? when size is ?", end, N));
+    if (__builtin_expect(begin >= N, 0)) __fail(nullptr, "array start index out of bounds, ? when size is ?", begin, N);
+    if (__builtin_expect(end > N, 0)) __fail(nullptr, "array end index out of bounds, ? when size is ?", end, N);
 #endif
     return __slice<T>(array + begin, end - begin); 
 }
 
+// slice of a read-only array, like a static table of constants, which is never written as the checker rejects mutable slices of it
+template<std::size_t N, typename T> constexpr __slice<T> __get_slice(const T* array, std::size_t begin, std::size_t end)
+{
+    return __get_slice<N>(const_cast<T*>(array), begin, end);
+}
+
 template<std::size_t N, typename T> bool __array_equals(const T (&x)[N], const T (&y)[N])
 {
     std::size_t i = 0;
@@ -517,4 +572,10 @@ template<typename... Args> std::string __format(std::string format, Args ...args
     return output.str();
 }
 
+template<typename... Args> [[noreturn]] __attribute__((cold, noinline)) void __fail(const __location* location, const char* format, Args... args)
+{
+    if (location) __crash(__format(format, args...), *location);
+    __crash(__format(format, args...));
+}
+
 #endif
\ No newline at end of file
@@ -42,7 +42,9 @@ namespace nemesis {
             return source_range(p.front().location(), p.back().range().end());
         }
         
-        node::node(source_range range) : range_(range), invalid_(0) {}
+        std::size_t node::constructed_ = 0;
+
+        node::node(source_range range) : range_(range), invalid_(0) { ++constructed_; }
 
         node::~node() {}
 
@@ -149,6 +151,20 @@ namespace nemesis {
             
         void test_declaration::accept(visitor& visitor) const { visitor.visit(*this); }
 
+        bench_declaration::bench_declaration(source_range range, token name, pointer<ast::expression> body) :
+            declaration(range),
+            name_(name),
+            body_(body)
+        {}
+            
+        bench_declaration::~bench_declaration() {}
+            
+        token& bench_declaration::name() const { return name_; }
+            
+        pointer<ast::expression>& bench_declaration::body() const { return body_; }
+            
+        void bench_declaration::accept(visitor& visitor) const { visitor.visit(*this); }
+
         contract_statement::contract_statement(source_range range, token specifier, pointer<ast::expression> expr) :
             statement(range),
             specifier_(specifier),
@@ -2489,6 +2505,14 @@ namespace nemesis {
             prefix_.pop();
         }
 
+        void printer::visit(const bench_declaration& decl)
+        {
+            stream_ << prefix_.str(decl) << impl::color::green << "bench_declaration " << impl::color::reset << decl.range().begin() << " `" << impl::color::white << decl.name().lexeme() << impl::color::reset  << "`\n";
+            prefix_.push(true);
+            decl.body()->accept(*this);
+            prefix_.pop();
+        }
+
         void printer::visit(const function_declaration& decl)
         {
             stream_ << prefix_.str(decl) << impl::color::green << "function_declaration " << impl::color::reset;
@@ -2,6 +2,7 @@
 #include "nemesis/analysis/evaluator.hpp"
 #include "nemesis/analysis/pattern_matcher.hpp"
 #include "nemesis/analysis/type_matcher.hpp"
+#include "nemesis/analysis/statistics.hpp"
 #include "utils/strings.hpp"
 
 #include <map>
@@ -10,95 +11,111 @@
 
 namespace nemesis {
     environment::environment(const ast::node* enclosing, environment* parent) : 
-        enclosing_(enclosing), parent_(parent) 
+        enclosing_(enclosing), parent_(parent), observer_(parent ? parent->observer_ : nullptr)
     {
         if (parent_) parent_->children_.push_back(this);
     }
 
-    const ast::declaration* environment::value(std::string name, bool recursive) const
+    template<typename T>
+    T environment::lookup(std::unordered_map<std::string, T> environment::* map, const std::string& name, bool recursive) const
     {
-        auto result = values_.find(name);
-        
-        if (result != values_.end()) {
-            return result->second;
-        }
-        else if (parent_ && recursive) {
-            return parent_->value(name);
+        std::size_t depth = 0;
+
+        for (const environment* scope = this; scope; scope = recursive ? scope->parent_ : nullptr, ++depth) {
+            auto result = (scope->*map).find(name);
+
+            if (result != (scope->*map).end()) {
+                statistics::lookup(depth, true);
+                if (scope->observer_ && *scope->observer_) (*scope->observer_)(result->second);
+                return result->second;
+            }
         }
+
+        statistics::lookup(depth, false);
         
         return nullptr;
     }
 
-    const ast::declaration* environment::function(std::string name, bool recursive) const
+    const ast::declaration* environment::value(std::string name, bool recursive) const
     {
-        auto result = functions_.find(name);
-
-        if (result != functions_.end()) {
-            return result->second;
-        }
-        else if (parent_ && recursive) {
-            return parent_->function(name);
-        }
+        return lookup(&environment::values_, name, recursive);
+    }
 
-        return nullptr;
+    const ast::declaration* environment::function(std::string name, bool recursive) const
+    {
+        return lookup(&environment::functions_, name, recursive);
     }
 
     const ast::type_declaration* environment::type(std::string name, bool recursive) const
     {
-        auto result = types_.find(name);
-        
-        if (result != types_.end()) {
-            return result->second;
-        }
-        else if (parent_ && recursive) {
-            return parent_->type(name);
-        }
-
-        return nullptr;
+        return lookup(&environment::types_, name, recursive);
     }
 
     const ast::concept_declaration* environment::concept(std::string name, bool recursive) const
     {
-        auto result = concepts_.find(name);
-        
-        if (result != concepts_.end()) {
-            return result->second;
-        }
-        else if (parent_ && recursive) {
-            return parent_->concept(name);
-        }
-
-        return nullptr;
+        return lookup(&environment::concepts_, name, recursive);
     }
 
     void environment::value(std::string name, const ast::declaration* decl)
     {
-        if (name != "_") values_.emplace(name, decl);
+        if (name != "_" && values_.emplace(name, decl).second) similars_.clear();
         // sets scope only if it was not already set before
         if (!decl->annotation().scope) decl->annotation().scope = enclosing_;
     }
 
     void environment::function(std::string name, const ast::declaration* fdecl)
     {
-        if (name != "_") functions_.emplace(name, fdecl);
+        if (name != "_" && functions_.emplace(name, fdecl).second) similars_.clear();
         // sets scope only if it was not already set before
         if (!fdecl->annotation().scope) fdecl->annotation().scope = enclosing_;
     }
 
     void environment::type(std::string name, const ast::type_declaration* tdecl)
     {
-        if (name != "_") types_.emplace(name, tdecl);
-        // sets scope only if it was not already set before
-        if (!tdecl->annotation().scope) tdecl->annotation().scope = enclosing_;
+        if (name != "_" && types_.emplace(name, tdecl).second) similars_.clear();
+        // sets scope only if it was not already set before, which changes absolute name of the type
+        if (!tdecl->annotation().scope) {
+            tdecl->annotation().scope = enclosing_;
+            ast::type::invalidate();
+        }
     }
 
     void environment::concept(std::string name, const ast::concept_declaration* cdecl)
     {
-        if (name != "_") concepts_.emplace(name, cdecl);
+        if (name != "_" && concepts_.emplace(name, cdecl).second) similars_.clear();
         // sets scope only if it was not already set before
         if (!cdecl->annotation().scope) cdecl->annotation().scope = enclosing_;
     }
 
+    std::vector<const ast::declaration*> environment::similars(std::string_view name, unsigned distance) const
+    {
+        std::vector<const ast::declaration*> result;
+        // index is built again only after a change to this scope
+        if (similars_.empty()) {
+            // bucket 0 is always present, so an empty index is recognizable as invalid
+            similars_.emplace_back();
+            auto insert = [this](std::string_view key, const ast::declaration* decl) {
+                if (similars_.size() <= key.size()) similars_.resize(key.size() + 1);
+                similars_[key.size()].emplace_back(key, decl);
+            };
+            for (auto& pair : types_) insert(pair.first, pair.second);
+            for (auto& pair : concepts_) insert(pair.first, pair.second);
+            for (auto& pair : functions_) insert(pair.first, pair.second);
+            for (auto& pair : values_) insert(pair.first, pair.second);
+        }
+        // names whose length differs more than distance are never compared
+        std::size_t from = name.size() > distance ? name.size() - distance : 0;
+        std::size_t to = std::min(name.size() + distance + 1, similars_.size());
+
+        for (std::size_t length = from; length < to; ++length) {
+            for (auto& candidate : similars_[length]) {
+                if (utils::levenshtein_within(name, candidate.first, distance)) result.push_back(candidate.second);
+            }
+        }
+
+        return result;
+    }
+
     bool environment::inside(environment::kind ctx) const
     {
         auto scope = this;
@@ -251,6 +268,8 @@ namespace nemesis {
 
         if (result == scopes_.end()) {
             scope_ = new environment(enclosing, scope_);
+            // root scopes propagate the observer to all nested scopes
+            if (!scope_->parent()) scope_->observe(&observer_);
             scopes_.emplace(enclosing, scope_);
         }
         else {
@@ -379,11 +398,14 @@ namespace nemesis {
             }
 
             auto map = subs.map();
+            auto constructed = ast::node::constructed();
             auto clone = std::static_pointer_cast<ast::type_declaration>(tdecl.clone());
+            statistics::instantiation(ast::node::constructed() - constructed);
             subs.root(clone.get());
             subs.substitute();
             clone->name() = token(token::kind::identifier, utf8::span::builder().concat(tname.data(), tname.size()).build(), tdecl.name().location());
             clone->annotation().scope = tdecl.annotation().scope;
+            ast::type::invalidate();
 
             std::unordered_map<std::string, types::parameter> arguments;
 
@@ -441,6 +463,7 @@ namespace nemesis {
                     auto cloned = constant.second->clone();
                     cloned->annotation().resolved = cloned->annotation().visited = false;
                     cloned->annotation().scope = clone.get();
+                    ast::type::invalidate();
                     //subs.root(cloned.get());
                     //subs.substitute();
                     //declarations.push_back(cloned);
@@ -472,6 +495,7 @@ namespace nemesis {
                     auto cloned = type.second->clone();
                     cloned->annotation().resolved = cloned->annotation().visited = false;
                     cloned->annotation().scope = clone.get();
+                    ast::type::invalidate();
                     //if (type.second->generic() && scopes_.count(type.second->generic().get())) subs.context(scopes_.at(type.second->generic().get()));
                     //else subs.context(context);
                     //subs.root(cloned.get());
@@ -505,6 +529,7 @@ namespace nemesis {
                     auto cloned = function.second->clone();
                     cloned->annotation().resolved = cloned->annotation().visited = false;
                     cloned->annotation().scope = clone.get();
+                    ast::type::invalidate();
                     //subs.context(scopes_.at(function.second->annotation().scope));
                     //subs.root(cloned.get());
                     //subs.substitute();
@@ -601,7 +626,12 @@ namespace nemesis {
         auto cname = oss.str();
         auto workspace = this->workspace();
 
-        if (workspace->tested_concept.count(cname)) return workspace->tested_concept.at(cname);
+        if (workspace->tested_concept.count(cname)) {
+            statistics::concept_test(true);
+            return workspace->tested_concept.at(cname);
+        }
+
+        statistics::concept_test(false);
 
         // we must allocate a new declaration tree for instantiated generic concept
         // push the new concept declaration to instantiate on the depth stack
@@ -786,7 +816,9 @@ namespace nemesis {
         auto found = workspace->instantiated_functions.find(fname);
         // we must allocate a new declaration tree for instantiated generic type
         if (found == workspace->instantiated_functions.end()) {
+            auto constructed = ast::node::constructed();
             auto clone = std::static_pointer_cast<ast::function_declaration>(fdecl.clone());
+            statistics::instantiation(ast::node::constructed() - constructed);
             subs.root(clone.get());
             subs.context(scopes_.at(&fdecl));
             subs.substitute();
@@ -900,6 +932,7 @@ namespace nemesis {
         }
         // implicit address of
         else if (type->category() == ast::type::category::pointer_type && types::compatible(std::static_pointer_cast<ast::pointer_type>(type)->base(), expression->annotation().type, false)) {
+            if (auto var = expression->lvalue()) var->annotation().addressed = true;
             ast::pointer<ast::expression> result = ast::create<ast::unary_expression>(expression->range(), token(token::kind::amp, utf8::span::builder().concat("&").build(), source_location()), expression);
             result->annotation().type = type;
             result = ast::create<ast::parenthesis_expression>(expression->range(), result);
@@ -916,6 +949,10 @@ namespace nemesis {
         }
         // implicit cast
         else if (!types::compatible(type, expression->annotation().type, true)) {
+            // slices and chars are views of the converted variable
+            if (type->category() == ast::type::category::slice_type || type->category() == ast::type::category::chars_type) {
+                if (auto var = expression->lvalue()) var->annotation().addressed = true;
+            }
             ast::pointer<ast::expression> result = ast::create<ast::implicit_conversion_expression>(expression->range(), expression);
             result->annotation().type = type;
             return result;
@@ -973,6 +1010,19 @@ namespace nemesis {
                 throw semantic_error();
             }
         }
+        else if (decl.annotation().type->category() == ast::type::category::slice_type && readonly_view(value)) {
+            auto diag = diagnostic::builder()
+                        .small(true)
+                        .severity(diagnostic::severity::error)
+                        .location(value.range().begin())
+                        .message("You can't assign a view of constant or immutable values to a mutable slice, sh*thead! \\ This way one could violate mutability, don't you think?")
+                        .highlight(decl.name().range(), diagnostic::highlighter::mode::light)
+                        .highlight(value.range())
+                        .build();
+
+            publisher().publish(diag);
+            throw semantic_error();
+        }
     }
 
     void checker::test_immutable_assignment(ast::pointer<ast::type> lvalue, const ast::expression& rvalue) const
@@ -1010,6 +1060,39 @@ namespace nemesis {
                 throw semantic_error();
             }
         }
+        else if (lvalue->category() == ast::type::category::slice_type && readonly_view(rvalue)) {
+            auto diag = diagnostic::builder()
+                        .small(true)
+                        .severity(diagnostic::severity::error)
+                        .location(rvalue.range().begin())
+                        .message(diagnostic::format("You can't assign a view of constant or immutable values to a mutable slice `$`, sh*thead! \\ This way one could violate mutability, don't you think?", lvalue->string()))
+                        .highlight(rvalue.range(), diagnostic::format("expected mutable $", lvalue->string()))
+                        .build();
+
+            publisher().publish(diag);
+            throw semantic_error();
+        }
+    }
+
+    bool checker::readonly_view(const ast::expression& value) const
+    {
+        auto inner = &value;
+        const ast::expression* viewed = nullptr;
+
+        while (auto parenthesis = dynamic_cast<const ast::parenthesis_expression*>(inner)) inner = parenthesis->expression().get();
+        // arrays are viewed by conversion to slice or by slicing
+        if (auto conversion = dynamic_cast<const ast::implicit_conversion_expression*>(inner)) viewed = conversion->expression().get();
+        else if (auto index = dynamic_cast<const ast::array_index_expression*>(inner)) {
+            if (index->index()->annotation().type && index->index()->annotation().type->category() == ast::type::category::range_type) viewed = index->expression().get();
+        }
+
+        if (!viewed || !viewed->annotation().type || viewed->annotation().type->category() != ast::type::category::array_type) return false;
+        // constant arrays are emitted as static read-only tables, which may be passed to immutable array parameters as well
+        if (viewed->annotation().value.type && viewed->annotation().value.type->category() != ast::type::category::unknown_type) return true;
+        
+        auto immutable = viewed->immutable();
+        
+        return immutable && (immutable->kind() == ast::kind::const_declaration || immutable->kind() == ast::kind::generic_const_parameter_declaration || immutable->kind() == ast::kind::parameter_declaration);
     }
 
     void checker::add_type(ast::pointer<ast::type> type)
@@ -1031,11 +1114,398 @@ namespace nemesis {
 
     ast::pointer<ast::var_declaration> checker::create_temporary_var(const ast::expression& value) const
     {
-        auto binding = ast::create<ast::var_declaration>(value.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(("__temp" + std::to_string(rand())).data()).build()).build(), nullptr, value.clone());
+        auto binding = ast::create<ast::var_declaration>(value.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(temporary().data()).build()).build(), nullptr, value.clone());
         binding->annotation().type = value.annotation().type;
         return binding;
     }
 
+    std::string checker::temporary() const
+    {
+        return "__temp" + std::to_string(temporaries_++);
+    }
+
+    void checker::use(const ast::identifier_expression& expr, const ast::var_declaration* var)
+    {
+        if (auto param = dynamic_cast<const ast::parameter_declaration*>(var)) {
+            parameters_[param].push_back(&expr);
+            return;
+        }
+        // only variables local to a block may be moved after their last use
+        if (var->is_static() || !dynamic_cast<const ast::block_expression*>(var->annotation().scope)) return;
+
+        auto& local = locals_[var];
+        // a deferred expression is executed after any other use
+        if (deferred_ > 0) local.escaping = true;
+        local.uses.emplace_back(&expr, scope_);
+    }
+
+    void checker::find_last_uses()
+    {
+        auto precedes = [](const source_range& x, const source_range& y) { return x.bline < y.bline || (x.bline == y.bline && x.bcolumn < y.bcolumn); };
+        auto contains = [](const source_range& outer, const source_range& inner) {
+            return (outer.bline < inner.bline || (outer.bline == inner.bline && outer.bcolumn <= inner.bcolumn)) &&
+                   (inner.eline < outer.eline || (inner.eline == outer.eline && inner.ecolumn <= outer.ecolumn));
+        };
+
+        for (auto& local : locals_) {
+            auto var = local.first;
+            auto block = static_cast<const ast::block_expression*>(var->annotation().scope);
+            auto& uses = local.second.uses;
+            
+            if (local.second.escaping || var->annotation().addressed || uses.empty()) continue;
+            // hidden variables, like bindings of converted variants, are not statements of their block
+            if (std::none_of(block->statements().begin(), block->statements().end(), [&](ast::pointer<ast::statement> stmt) { return stmt.get() == var; })) continue;
+
+            auto last = std::max_element(uses.begin(), uses.end(), [&](const std::pair<const ast::identifier_expression*, const environment*>& x, const std::pair<const ast::identifier_expression*, const environment*>& y) { return precedes(x.first->range(), y.first->range()); });
+            // a use inside a loop or a lambda may be executed again after the last one in source order
+            bool repeated = false;
+
+            for (auto scope = last->second; scope != scopes_.at(block); scope = scope->parent()) {
+                if (!scope || dynamic_cast<const ast::for_loop_expression*>(scope->enclosing()) || dynamic_cast<const ast::for_range_expression*>(scope->enclosing()) || dynamic_cast<const ast::function_expression*>(scope->enclosing())) {
+                    repeated = true;
+                    break;
+                }
+            }
+
+            if (repeated) continue;
+            // each statement of the block is evaluated as a whole, included hoisted temporaries, 
+            // so no other use may be found inside a statement which contains the last use
+            bool alone = std::any_of(block->statements().begin(), block->statements().end(), [&](ast::pointer<ast::statement> stmt) { return contains(stmt->range(), last->first->range()); });
+
+            for (auto use = uses.begin(); alone && use != uses.end(); ++use) {
+                if (use->first == last->first) continue;
+
+                bool inside = false;
+
+                for (auto stmt : block->statements()) {
+                    if (!contains(stmt->range(), use->first->range())) continue;
+                    inside = true;
+                    if (contains(stmt->range(), last->first->range())) alone = false;
+                }
+
+                if (!inside) alone = false;
+            }
+
+            if (alone) last_uses_.insert(last->first);
+        }
+    }
+
+    bool checker::intrinsic(const ast::function_declaration* fn) const
+    {
+        if (fn->external) return true;
+        // functions of builtin packages only have stub bodies as they are implemented in C++
+        auto scope = scopes_.find(fn);
+        if (scope == scopes_.end()) return false;
+        auto workspace = dynamic_cast<const ast::workspace*>(scope->second->outscope(environment::kind::workspace));
+        if (!workspace || !compilation_.package(workspace->package).builtin) return false;
+        // instances of their generic functions are generated from their bodies, except those mapped to C++ helpers
+        auto name = fn->name().lexeme().string();
+        auto generics = name.find_first_of('(');
+        if (generics == std::string::npos) return true;
+        name.erase(generics);
+        return workspace->name == "core" && (name == "allocate" || name == "deallocate" || name == "free" || name == "sizeof" || name == "black_box");
+    }
+
+    bool checker::invoked_only(const ast::var_declaration* var) const
+    {
+        if (var->is_static() || var->annotation().addressed || !dynamic_cast<const ast::block_expression*>(var->annotation().scope)) return false;
+
+        auto local = locals_.find(var);
+        if (local == locals_.end()) return true;
+        if (local->second.escaping) return false;
+
+        return std::all_of(local->second.uses.begin(), local->second.uses.end(), [this](const std::pair<const ast::identifier_expression*, const environment*>& use) { return callees_.count(use.first) > 0; });
+    }
+
+    bool checker::invoked_only(const ast::parameter_declaration* param) const
+    {
+        if (param->is_mutable() || param->is_variadic() || param->annotation().addressed) return false;
+
+        auto uses = parameters_.find(param);
+        if (uses == parameters_.end()) return true;
+
+        return std::all_of(uses->second.begin(), uses->second.end(), [this](const ast::identifier_expression* use) { return callees_.count(use) > 0; });
+    }
+
+    ast::pointer<ast::type> checker::concrete_type(const ast::expression& object) const
+    {
+        auto core = &object;
+        while (auto parenthesis = dynamic_cast<const ast::parenthesis_expression*>(core)) core = parenthesis->expression().get();
+        // pointer which was upcasted from pointer to implementor
+        const ast::expression* upcasted = nullptr;
+        
+        if (auto conversion = dynamic_cast<const ast::implicit_conversion_expression*>(core)) upcasted = conversion->expression().get();
+        else if (auto binary = dynamic_cast<const ast::binary_expression*>(core)) { if (binary->binary_operator().kind() == token::kind::as_kw) upcasted = binary->left().get(); }
+        // immutable variable keeps pointing to the object it was initialized with
+        else if (auto identifier = dynamic_cast<const ast::identifier_expression*>(core)) {
+            auto var = dynamic_cast<const ast::var_declaration*>(identifier->annotation().referencing);
+            if (var && !var->is_mutable() && var->value()) return concrete_type(*var->value());
+        }
+
+        if (!upcasted || !upcasted->annotation().type || upcasted->annotation().type->category() != ast::type::category::pointer_type) return nullptr;
+
+        auto base = std::static_pointer_cast<ast::pointer_type>(upcasted->annotation().type)->base();
+
+        if (base->category() == ast::type::category::behaviour_type) return concrete_type(*upcasted);
+        
+        return base;
+    }
+
+    void checker::devirtualize()
+    {
+        for (auto dispatch : dispatches_) {
+            auto behaviour = std::static_pointer_cast<ast::behaviour_type>(std::static_pointer_cast<ast::pointer_type>(dispatch->expression()->annotation().type)->base());
+            // concrete type of object is statically known, otherwise behaviour must have a unique implementor in the whole program
+            auto implementor = concrete_type(*dispatch->expression());
+            if (!implementor && behaviour->implementors().size() == 1) implementor = *behaviour->implementors().begin();
+            if (!implementor || !implementor->declaration() || !scopes_.count(implementor->declaration())) continue;
+            // implementation is looked up by name inside extensions of the implementor
+            auto name = std::static_pointer_cast<ast::identifier_expression>(dispatch->member())->identifier().lexeme().string();
+            auto found = scopes_.at(implementor->declaration())->functions().find(name);
+            if (found == scopes_.at(implementor->declaration())->functions().end()) continue;
+
+            ast::pointers<ast::declaration> parameters;
+            
+            if (auto function = dynamic_cast<const ast::function_declaration*>(found->second)) { if (!function->generic()) parameters = function->parameters(); }
+            else if (auto property = dynamic_cast<const ast::property_declaration*>(found->second)) parameters = property->parameters();
+            // object is passed through a pointer to the implementor
+            if (parameters.empty() || !parameters.front()->annotation().type || parameters.front()->annotation().type->category() != ast::type::category::pointer_type) continue;
+            if (!types::compatible(std::static_pointer_cast<ast::pointer_type>(parameters.front()->annotation().type)->base(), implementor)) continue;
+
+            devirtualized_.emplace(dispatch, found->second);
+        }
+    }
+
+    const ast::declaration* checker::sized_object(const ast::expression& expr) const
+    {
+        auto core = &expr;
+        
+        while (true) {
+            if (auto conversion = dynamic_cast<const ast::implicit_conversion_expression*>(core)) core = conversion->expression().get();
+            else if (auto parenthesis = dynamic_cast<const ast::parenthesis_expression*>(core)) core = parenthesis->expression().get();
+            else break;
+        }
+        // size of an immutable array or slice, like `x.size`
+        auto member = dynamic_cast<const ast::member_expression*>(core);
+        if (!member || member->annotation().referencing || !member->expression()->annotation().type) return nullptr;
+        auto name = std::dynamic_pointer_cast<ast::identifier_expression>(member->member());
+        auto object = std::dynamic_pointer_cast<ast::identifier_expression>(member->expression());
+        if (!name || !object || name->identifier().lexeme().string() != "size") return nullptr;
+
+        switch (object->annotation().type->category()) {
+            case ast::type::category::array_type:
+            case ast::type::category::slice_type:
+                return object->immutable();
+            default:
+                return nullptr;
+        }
+    }
+
+    checker::index_range checker::range_of(const ast::expression& expr) const
+    {
+        // bounds are kept far from overflow of computations
+        constexpr std::int64_t limit = std::int64_t(1) << 62;
+        index_range result;
+        auto core = &expr;
+        
+        while (true) {
+            if (auto conversion = dynamic_cast<const ast::implicit_conversion_expression*>(core)) core = conversion->expression().get();
+            else if (auto parenthesis = dynamic_cast<const ast::parenthesis_expression*>(core)) core = parenthesis->expression().get();
+            else break;
+        }
+
+        auto integer = std::dynamic_pointer_cast<ast::integer_type>(core->annotation().type);
+        // constant value
+        if (core->annotation().value.type && core->annotation().value.type->category() == ast::type::category::integer_type) {
+            auto type = std::static_pointer_cast<ast::integer_type>(core->annotation().value.type);
+            if (type->is_signed() && core->annotation().value.i.value() > -limit && core->annotation().value.i.value() < limit) result.lower = result.upper = core->annotation().value.i.value();
+            else if (!type->is_signed() && core->annotation().value.u.value() < static_cast<std::uint64_t>(limit)) result.lower = result.upper = core->annotation().value.u.value();
+            else return result;
+            result.bounded_below = result.bounded_above = true;
+            return result;
+        }
+        // unsigned values are never negative
+        if (integer && !integer->is_signed()) result.bounded_below = true;
+        
+        if (auto identifier = dynamic_cast<const ast::identifier_expression*>(core)) {
+            if (loop_ranges_.count(identifier->annotation().referencing)) result = loop_ranges_.at(identifier->annotation().referencing);
+            // immutable local is bound by its initial value
+            else if (auto var = dynamic_cast<const ast::var_declaration*>(identifier->annotation().referencing)) {
+                if (var->kind() == ast::kind::var_declaration && !var->is_mutable() && !var->is_static() && var->value()) result = range_of(*var->value());
+            }
+        }
+        else if (auto range = dynamic_cast<const ast::range_expression*>(core)) {
+            if (!range->start() || !range->end()) return result;
+
+            auto start = range_of(*range->start()), end = range_of(*range->end());
+            result.bounded_below = start.bounded_below;
+            result.lower = start.lower;
+            result.bounded_above = end.bounded_above;
+            result.upper = range->is_inclusive() ? end.upper : end.upper - 1;
+            // iteration up to the size of an object, excluded
+            if (!range->is_inclusive()) result.sized = sized_object(*range->end()) ? sized_object(*range->end()) : end.sized;
+        }
+        else if (auto binary = dynamic_cast<const ast::binary_expression*>(core)) {
+            auto left = range_of(*binary->left()), right = range_of(*binary->right());
+
+            switch (binary->binary_operator().kind()) {
+                case token::kind::plus:
+                    result.bounded_below = left.bounded_below && right.bounded_below;
+                    result.lower = left.lower + right.lower;
+                    result.bounded_above = left.bounded_above && right.bounded_above;
+                    result.upper = left.upper + right.upper;
+                    if (right.bounded_above && right.upper <= 0) result.sized = left.sized;
+                    break;
+                case token::kind::minus:
+                    result.bounded_below = left.bounded_below && right.bounded_above;
+                    result.lower = left.lower - right.upper;
+                    result.bounded_above = left.bounded_above && right.bounded_below;
+                    result.upper = left.upper - right.lower;
+                    if (right.bounded_below && right.lower >= 0) result.sized = left.sized;
+                    break;
+                case token::kind::percent:
+                    if (!left.bounded_below || left.lower < 0) break;
+                    result.bounded_below = true;
+                    result.lower = 0;
+                    if (right.bounded_below && right.bounded_above && right.lower == right.upper && right.lower > 0) {
+                        result.bounded_above = true;
+                        result.upper = right.upper - 1;
+                    }
+                    else result.sized = sized_object(*binary->right());
+                    break;
+                default:
+                    break;
+            }
+        }
+        // an interval which doesn't fit its type could have been wrapped around
+        if (result.bounded_below && (result.lower <= -limit || result.lower >= limit)) result.bounded_below = false;
+        if (result.bounded_above && (result.upper <= -limit || result.upper >= limit)) result.bounded_above = false;
+        if (integer && integer->bits() < 64) {
+            std::int64_t min = integer->is_signed() ? -(std::int64_t(1) << (integer->bits() - 1)) : 0;
+            std::int64_t max = integer->is_signed() ? (std::int64_t(1) << (integer->bits() - 1)) - 1 : (std::int64_t(1) << integer->bits()) - 1;
+            if ((result.bounded_below && result.lower < min) || (result.bounded_above && result.upper > max)) return index_range();
+        }
+        
+        return result;
+    }
+
+    void checker::find_safe_indices()
+    {
+        for (auto indexing : indexings_) {
+            if (indexing->annotation().implicit_procedure || !indexing->annotation().type || dynamic_cast<const ast::range_expression*>(indexing->index().get())) continue;
+            
+            auto index = range_of(*indexing->index());
+            // a negative index would be converted to a huge unsigned one
+            if (!index.bounded_below || index.lower < 0) continue;
+
+            bool sized = index.sized && dynamic_cast<const ast::identifier_expression*>(indexing->expression().get()) && indexing->expression()->annotation().referencing == index.sized;
+
+            if (auto array = std::dynamic_pointer_cast<ast::array_type>(indexing->expression()->annotation().type)) {
+                if (sized || (index.bounded_above && index.upper < static_cast<std::int64_t>(array->size()))) safe_indices_.insert(indexing);
+            }
+            else if (indexing->expression()->annotation().type->category() == ast::type::category::slice_type && sized) safe_indices_.insert(indexing);
+        }
+    }
+
+    bool checker::loop_invariant(const ast::expression& expr, const ast::declaration* variable) const
+    {
+        if (!expr.annotation().type) return false;
+        // folded values are only trusted on literals and constants, as annotations of expressions on mutable variables may be stale
+        auto constant = [](const ast::expression& expr) {
+            if (!expr.annotation().value.type || expr.annotation().value.type->category() == ast::type::category::unknown_type) return false;
+            if (expr.kind() == ast::kind::literal_expression) return true;
+            if (expr.kind() != ast::kind::identifier_expression || !expr.annotation().referencing) return false;
+            return expr.annotation().referencing->kind() == ast::kind::const_declaration || expr.annotation().referencing->kind() == ast::kind::generic_const_parameter_declaration;
+        };
+        
+        if (constant(expr)) return true;
+        // operators defined by procedures may have side effects
+        if (expr.annotation().implicit_procedure) return false;
+
+        if (auto conversion = dynamic_cast<const ast::implicit_conversion_expression*>(&expr)) {
+            // only conversions between primitive values, which never fail
+            switch (expr.annotation().type->category()) {
+                case ast::type::category::bool_type:
+                case ast::type::category::integer_type:
+                case ast::type::category::rational_type:
+                case ast::type::category::float_type:
+                    return loop_invariant(*conversion->expression(), variable);
+                default:
+                    return false;
+            }
+        }
+        else if (auto parenthesis = dynamic_cast<const ast::parenthesis_expression*>(&expr)) {
+            return loop_invariant(*parenthesis->expression(), variable);
+        }
+        else if (auto identifier = dynamic_cast<const ast::identifier_expression*>(&expr)) {
+            // immutable variables which are not bound by the loop itself
+            auto decl = identifier->immutable();
+            return decl && decl != variable && (decl->kind() == ast::kind::var_declaration || decl->kind() == ast::kind::parameter_declaration || decl->kind() == ast::kind::const_declaration);
+        }
+        else if (auto unary = dynamic_cast<const ast::unary_expression*>(&expr)) {
+            switch (unary->unary_operator().kind()) {
+                case token::kind::minus:
+                case token::kind::bang:
+                case token::kind::tilde:
+                    return loop_invariant(*unary->expression(), variable);
+                default:
+                    return false;
+            }
+        }
+        else if (auto binary = dynamic_cast<const ast::binary_expression*>(&expr)) {
+            switch (binary->binary_operator().kind()) {
+                case token::kind::plus:
+                case token::kind::minus:
+                case token::kind::star:
+                case token::kind::less:
+                case token::kind::greater:
+                case token::kind::less_equal:
+                case token::kind::greater_equal:
+                case token::kind::equal_equal:
+                case token::kind::bang_equal:
+                case token::kind::amp_amp:
+                case token::kind::line_line:
+                    return loop_invariant(*binary->left(), variable) && loop_invariant(*binary->right(), variable);
+                // division by zero would fail before the loop even if the loop never iterates
+                case token::kind::slash:
+                case token::kind::percent:
+                {
+                    auto& divisor = binary->right()->annotation().value;
+                    if (!constant(*binary->right()) || divisor.type->category() != ast::type::category::integer_type) return false;
+                    if (std::static_pointer_cast<ast::integer_type>(divisor.type)->is_signed() ? divisor.i.value() == 0 : divisor.u.value() == 0) return false;
+                    return loop_invariant(*binary->left(), variable);
+                }
+                default:
+                    return false;
+            }
+        }
+        // size of an immutable array or slice
+        else if (auto object = sized_object(expr)) {
+            return object != variable;
+        }
+
+        return false;
+    }
+
+    void checker::hoist_contracts()
+    {
+        for (auto loop : contracted_loops_) {
+            ast::pointers<ast::statement> contracts;
+            const ast::declaration* variable = nullptr;
+
+            if (auto forloop = dynamic_cast<const ast::for_loop_expression*>(loop)) contracts = forloop->contracts();
+            else if (auto forrange = dynamic_cast<const ast::for_range_expression*>(loop)) {
+                contracts = forrange->contracts();
+                variable = forrange->variable().get();
+            }
+
+            for (auto contract : contracts) {
+                auto stmt = std::static_pointer_cast<ast::contract_statement>(contract);
+                if (loop_invariant(*stmt->condition(), variable)) hoisted_.insert(stmt.get());
+            }
+        }
+    }
+
     void checker::mismatch(source_range x, source_range y, const std::string& message, const std::string& explanation, const std::string& inlined)
     {
         auto diag = diagnostic::builder()
@@ -1490,6 +1960,9 @@ namespace nemesis {
                 case ast::kind::test_declaration:
                     levels.push(static_cast<const ast::test_declaration*>(decl)->name().lexeme().string());
                     break;
+                case ast::kind::bench_declaration:
+                    levels.push(static_cast<const ast::bench_declaration*>(decl)->name().lexeme().string());
+                    break;
                 case ast::kind::concept_declaration:
                     levels.push(static_cast<const ast::concept_declaration*>(decl)->name().lexeme().string());
                     break;
@@ -1545,33 +2018,14 @@ namespace nemesis {
     {
         std::unordered_map<std::string, const ast::declaration*> result;
 
-        for (auto pair : impl::builtins) {
-            if (utils::levenshtein_distance(name, pair.first) < 2) {
+        for (auto& pair : impl::builtins) {
+            if (utils::levenshtein_within(name, pair.first, 1)) {
                 result.emplace(pair.first, nullptr);
             }
         }
 
         for (const environment* into = scope; into; into = into->parent()) {
-            for (auto pair : into->types()) {
-                if (utils::levenshtein_distance(name, pair.first) < 2) {
-                    result.emplace(fullname(pair.second), pair.second);
-                }
-            }
-            for (auto pair : into->concepts()) {
-                if (utils::levenshtein_distance(name, pair.first) < 2) {
-                    result.emplace(fullname(pair.second), pair.second);
-                }
-            }
-            for (auto pair : into->functions()) {
-                if (utils::levenshtein_distance(name, pair.first) < 2) {
-                    result.emplace(fullname(pair.second), pair.second);
-                }
-            }
-            for (auto pair : into->values()) {
-                if (utils::levenshtein_distance(name, pair.first) < 2) {
-                    result.emplace(fullname(pair.second), pair.second);
-                }
-            }
+            for (auto decl : into->similars(name, 1)) result.emplace(fullname(decl), decl);
         }
 
         return result;
@@ -1740,7 +2194,7 @@ namespace nemesis {
             }
             else if (auto parametric = dynamic_cast<const ast::generic_const_parameter_declaration*>(expr.size()->annotation().referencing)) {
                 auto type = types::array(base, 0);
-                type->parametric_size() = parametric;
+                type->parametric_size(parametric);
                 expr.annotation().type = type;
             }
         }
@@ -1790,7 +2244,7 @@ namespace nemesis {
 
         for (auto param : expr.parameter_types()) {
             param->accept(*this);
-            param->annotation().type->mutability = std::dynamic_pointer_cast<ast::type_expression>(param)->is_mutable();
+            param->annotation().type->mark_mutable(std::dynamic_pointer_cast<ast::type_expression>(param)->is_mutable());
             formals.push_back(param->annotation().type);
         }
 
@@ -2013,6 +2467,7 @@ namespace nemesis {
                     if (var && dynamic_cast<const ast::expression*>(varscope->enclosing()) && fnscope->has_ancestor_scope(varscope)) {
                         // add captured variable inside lambda scope
                         if (auto lambda = dynamic_cast<const ast::function_expression*>(fn)) lambda->captured().insert(var);
+                        locals_[var].escaping = true;
                         
                         auto diag = diagnostic::builder()
                                     .location(expr.range().begin())
@@ -2850,6 +3305,7 @@ namespace nemesis {
                     if (var && dynamic_cast<const ast::expression*>(varscope->enclosing()) && fnscope->has_ancestor_scope(varscope)) {
                         // add captured variable inside lambda scope
                         if (auto lambda = dynamic_cast<const ast::function_expression*>(fn)) lambda->captured().insert(var);
+                        locals_[var].escaping = true;
                         
                         auto diag = diagnostic::builder()
                                     .location(expr.range().begin())
@@ -3704,6 +4160,8 @@ namespace nemesis {
             expr.invalid(true);
             error(expr.range(), "I was expecting a type but I found value instead!", "", "expected type");
         }
+
+        if (auto var = dynamic_cast<const ast::var_declaration*>(expr.annotation().referencing)) use(expr, var);
     }
 
     void checker::visit(const ast::tuple_expression& expr) 
@@ -4222,7 +4680,7 @@ namespace nemesis {
         // remove variables names to avoid conflicts
         std::set<std::string> vars_to_remove;
         for (auto pair : scope_->values()) if (dynamic_cast<const ast::var_declaration*>(pair.second) || dynamic_cast<const ast::var_tupled_declaration*>(pair.second)) vars_to_remove.insert(pair.first);
-        for (auto var : vars_to_remove) scope_->values().erase(var);
+        for (auto var : vars_to_remove) scope_->remove_value(var);
         // contracts at the beginning
         for (auto contract : contracts) {
             auto prev = statement_;
@@ -5453,6 +5911,7 @@ namespace nemesis {
             // generics are deduced at this level from function call, so we don't need them to be resolved from visit(identifier_expression&)
             expr.callee()->annotation().deduce = false;
             expr.callee()->accept(*this);
+            if (auto identifier = std::dynamic_pointer_cast<ast::identifier_expression>(expr.callee())) callees_.insert(identifier.get());
             if (!expr.callee()->annotation().type || expr.callee()->annotation().type->category() == ast::type::category::unknown_type) {
                 expr.invalid(true);
                 expr.annotation().type = types::unknown();
@@ -6175,6 +6634,10 @@ namespace nemesis {
                 publisher().publish(diag);
                 throw semantic_error();
             }
+            // method of behaviour called through a pointer, which may be bound statically once all implementors are known
+            else if (object_type->category() == ast::type::category::behaviour_type && expr.expression()->annotation().type->category() == ast::type::category::pointer_type) {
+                dispatches_.push_back(&expr);
+            }
         }
         else {
             switch (expr.expression()->annotation().type->category()) {
@@ -6263,6 +6726,8 @@ namespace nemesis {
             expr.invalid(true);
             throw semantic_error();
         }
+        // bounds of index are checked once all loops are known
+        indexings_.push_back(&expr);
 
         ast::pointer<ast::type> base;
 
@@ -6318,6 +6783,10 @@ namespace nemesis {
                 throw semantic_error();
             }
             else {
+                // slicing an array makes a view of the variable
+                if (expr.expression()->annotation().type->category() == ast::type::category::array_type) {
+                    if (auto var = expr.expression()->lvalue()) var->annotation().addressed = true;
+                }
                 expr.annotation().type = types::slice(base);
             }
         }
@@ -6435,7 +6904,7 @@ namespace nemesis {
                     unsigned similars = 0;
                     
                     for (auto pair : initialized) {
-                        if (utils::levenshtein_distance(name, pair.first) < 2) {
+                        if (utils::levenshtein_within(name, pair.first, 1)) {
                             explanation << " \\ • " << pair.first;
                             ++similars;
                         }
@@ -6646,7 +7115,10 @@ namespace nemesis {
                     expr.annotation().type = types::unknown();
                     error(expr, diagnostic::format("You cannot take the address of a temporary object of type `$`, idiot!", rtype->string()), "", "expected lvalue");
                 }
-                else expr.annotation().type = types::pointer(rtype);
+                else {
+                    if (auto var = expr.expression()->lvalue()) var->annotation().addressed = true;
+                    expr.annotation().type = types::pointer(rtype);
+                }
                 break;
             case token::kind::star:
                 if (rtype->category() != ast::type::category::pointer_type) {
@@ -7471,6 +7943,11 @@ namespace nemesis {
 
                 break;
             case token::kind::as_kw:
+                // slices and chars are views of the converted variable
+                if (righttype->category() == ast::type::category::slice_type || righttype->category() == ast::type::category::chars_type) {
+                    if (auto var = expr.left()->lvalue()) var->annotation().addressed = true;
+                }
+
                 if (auto variant = std::dynamic_pointer_cast<ast::variant_type>(lefttype)) {
                     if (variant->contains(righttype)) warning(expr, diagnostic::format("Explicit conversion from `$` to `$` may crash at run-time!", lefttype->string(), righttype->string()));
                     else error(expr, diagnostic::format("Variant `$` does not include `$` among its types so conversion is not possible, idiot!", lefttype->string(), righttype->string()));
@@ -8526,7 +9003,7 @@ namespace nemesis {
                     unsigned similars = 0;
                     
                     for (auto pair : structure_type->fields()) {
-                        if (utils::levenshtein_distance(name, pair.name) < 2) {
+                        if (utils::levenshtein_within(name, pair.name, 1)) {
                             explanation << " \\ • " << pair.name;
                             ++similars;
                         }
@@ -8699,6 +9176,10 @@ namespace nemesis {
             if (result.condition) {
                 std::dynamic_pointer_cast<ast::pattern_expression>(branch.pattern())->compiled() = result.condition;
             }
+            // test on the whole value is associated to pattern to build decision tree
+            if (auto pattern = std::dynamic_pointer_cast<ast::pattern_expression>(branch.pattern())) {
+                pattern->test() = result.test;
+            }
 
             branch.body()->accept(*this);
             end_scope();
@@ -8756,7 +9237,7 @@ namespace nemesis {
 
         // temporary control expression must be instantiated and bound to a variable
         auto value = ast::create<ast::when_expression>(expr.range(), expr.condition(), expr.branches(), expr.else_body());
-        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(("__temp" + std::to_string(rand())).data()).build()).build(), nullptr, value);
+        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(temporary().data()).build()).build(), nullptr, value);
         binding->annotation().type = expr.annotation().type;
         binding->annotation().scope = scope_->enclosing();
         // later insertion before use
@@ -8840,7 +9321,7 @@ namespace nemesis {
 
         // temporary control expression must be instantiated and bound to a variable
         auto value = ast::create<ast::when_pattern_expression>(expr.range(), expr.condition(), expr.pattern(), expr.body(), expr.else_body());
-        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(("__temp" + std::to_string(rand())).data()).build()).build(), nullptr, value);
+        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(temporary().data()).build()).build(), nullptr, value);
         binding->annotation().type = expr.annotation().type;
         binding->annotation().scope = scope_->enclosing();
         // later insertion before use
@@ -8888,7 +9369,7 @@ namespace nemesis {
                 auto body = std::static_pointer_cast<ast::block_expression>(expr.body());
                 // first of all creates a temporary variable whose value is converted variant
                 // like 'val __tempx = original as T'
-                auto tempname = "__temp" + std::to_string(std::rand());
+                auto tempname = temporary();
                 auto temp = ast::create<ast::var_declaration>(decl->range(), std::vector<token>(), token(), nullptr, nullptr);
                 temp->name() = token::builder().artificial(true).location(temp->name().location()).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(tempname.data(), tempname.size()).build()).build();
                 temp->type_expression() = nullptr;
@@ -8963,7 +9444,7 @@ namespace nemesis {
 
         // temporary control expression must be instantiated and bound to a variable
         auto value = ast::create<ast::when_cast_expression>(expr.range(), expr.condition(), expr.type_expression(), expr.body(), expr.else_body());
-        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(("__temp" + std::to_string(rand())).data()).build()).build(), nullptr, value);
+        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(temporary().data()).build()).build(), nullptr, value);
         binding->annotation().type = expr.annotation().type;
         binding->annotation().scope = scope_->enclosing();
         // later insertion before use
@@ -8980,6 +9461,11 @@ namespace nemesis {
         // iteration variable
         expr.variable()->accept(*this);
         expr.condition()->accept(*this);
+        // values taken by iteration variable over a range, which may prove safety of indices inside body
+        if (auto var = std::dynamic_pointer_cast<ast::var_declaration>(expr.variable())) {
+            if (!var->is_mutable() && std::dynamic_pointer_cast<ast::range_expression>(expr.condition())) loop_ranges_.emplace(var.get(), range_of(*expr.condition()));
+        }
+        if (!expr.contracts().empty()) contracted_loops_.push_back(&expr);
         // explicit type annotation for iteration variable
         if (auto array_type = std::dynamic_pointer_cast<ast::array_type>(expr.condition()->annotation().type)) expr.variable()->annotation().type = array_type->base();
         else if (auto slice_type = std::dynamic_pointer_cast<ast::slice_type>(expr.condition()->annotation().type)) expr.variable()->annotation().type = slice_type->base();
@@ -9057,7 +9543,7 @@ namespace nemesis {
 
         // temporary control expression must be instantiated and bound to a variable
         auto value = ast::create<ast::for_range_expression>(expr.range(), expr.variable(), expr.condition(), expr.body(), expr.else_body(), expr.contracts());
-        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(("__temp" + std::to_string(rand())).data()).build()).build(), nullptr, value);
+        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(temporary().data()).build()).build(), nullptr, value);
         binding->annotation().type = expr.annotation().type;
         binding->annotation().scope = scope_->enclosing();
         // later insertion before use
@@ -9070,6 +9556,8 @@ namespace nemesis {
     {
         auto outer = scope_;
 
+        if (!expr.contracts().empty()) contracted_loops_.push_back(&expr);
+
         if (expr.condition()) {
             expr.condition()->accept(*this);
 
@@ -9133,7 +9621,7 @@ namespace nemesis {
 
         // temporary control expression must be instantiated and bound to a variable
         auto value = ast::create<ast::for_loop_expression>(expr.range(), expr.condition(), expr.body(), expr.else_body(), expr.contracts());
-        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(("__temp" + std::to_string(rand())).data()).build()).build(), nullptr, value);
+        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(temporary().data()).build()).build(), nullptr, value);
         binding->annotation().type = expr.annotation().type;
         binding->annotation().scope = scope_->enclosing();
         // later insertion before use
@@ -9190,7 +9678,7 @@ namespace nemesis {
 
         // temporary control expression must be instantiated and bound to a variable
         auto value = ast::create<ast::if_expression>(expr.range(), expr.condition(), expr.body(), expr.else_body());
-        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(("__temp" + std::to_string(rand())).data()).build()).build(), nullptr, value);
+        auto binding = ast::create<ast::var_declaration>(expr.range(), std::vector<token>(), token::builder().artificial(true).kind(token::kind::identifier).lexeme(utf8::span::builder().concat(temporary().data()).build()).build(), nullptr, value);
         binding->annotation().type = expr.annotation().type;
         binding->annotation().scope = scope_->enclosing();
         // later insertion before use
@@ -9252,6 +9740,11 @@ namespace nemesis {
                 else if (auto implicit = implicit_cast(stmt.left()->annotation().type, stmt.right())) {
                     stmt.right() = implicit;
                 }
+                // as for declarations, slices of read-only arrays can't be written
+                if (!stmt.invalid() && lefttype->category() == ast::type::category::slice_type && readonly_view(*stmt.right())) {
+                    stmt.invalid(true);
+                    error(stmt.right()->range(), "You can't assign a view of constant or immutable values to a mutable slice, sh*thead! \\ This way one could violate mutability, don't you think?", "", "expected mutable slice");
+                }
 
                 break;
             case token::kind::plus_equal:
@@ -9544,8 +10037,10 @@ namespace nemesis {
     {
         stmt.annotation().scope = scope_->enclosing();
         stmt.annotation().visited = true;
-
-        stmt.expression()->accept(*this);
+        // variables used by deferred expression live until exit from scope
+        ++deferred_;
+        try { stmt.expression()->accept(*this); } catch (...) { --deferred_; throw; }
+        --deferred_;
 
         stmt.annotation().resolved = true;
 
@@ -9783,7 +10278,7 @@ namespace nemesis {
         if (decl.is_variadic()) decl.annotation().type = types::slice(decl.type_expression()->annotation().type);
         else decl.annotation().type = decl.type_expression()->annotation().type;
         // mutability bit
-        decl.annotation().type->mutability = std::dynamic_pointer_cast<ast::type_expression>(decl.type_expression())->is_mutable();
+        decl.annotation().type->mark_mutable(std::dynamic_pointer_cast<ast::type_expression>(decl.type_expression())->is_mutable());
     }
 
     void checker::visit(const ast::var_declaration& decl)
@@ -9838,7 +10333,7 @@ namespace nemesis {
             decl.annotation().type = decl.type_expression()->annotation().type;
         }
 
-        if (decl.annotation().type) decl.annotation().type->mutability = decl.is_mutable();
+        if (decl.annotation().type) decl.annotation().type->mark_mutable(decl.is_mutable());
 
         // test that immutability is preserved
         if (decl.value()) test_immutable_assignment(decl, *decl.value());
@@ -9884,7 +10379,7 @@ namespace nemesis {
         }
 
         decl.annotation().resolved = true;
-        if (decl.annotation().type) decl.annotation().type->mutability = decl.is_mutable();
+        if (decl.annotation().type) decl.annotation().type->mark_mutable(decl.is_mutable());
         else decl.annotation().type = types::unknown();
         // recorded as global
         if (auto workspace = dynamic_cast<const ast::workspace*>(scope_->enclosing())) const_cast<ast::workspace*>(workspace)->globals.push_back(&decl);
@@ -10043,7 +10538,7 @@ namespace nemesis {
 
                     auto vardecl = ast::create<ast::var_declaration>(decl.range(), std::vector<token>(), identifier, ast::pointer<ast::expression>(), value);
                     vardecl->annotation().type = value->annotation().type;
-                    if (vardecl->annotation().type) vardecl->annotation().type->mutability = decl.is_mutable();
+                    if (vardecl->annotation().type) vardecl->annotation().type->mark_mutable(decl.is_mutable());
                     // test that immutability is preserved
                     if (decl.value()) test_immutable_assignment(*vardecl, *decl.value());
                     // this is done for smart pointers management
@@ -10458,6 +10953,35 @@ namespace nemesis {
         decl.annotation().scope = workspace;
     }
 
+    void checker::visit(const ast::bench_declaration& decl) 
+    {
+        decl.annotation().visited = true;
+        // current workspace
+        auto workspace = this->workspace();
+        // check if benchmark name is unique within workspace context
+        auto other = std::find_if(workspace->benchmarks.begin(), workspace->benchmarks.end(), [&] (const ast::bench_declaration* bench) { return bench->name().lexeme() == decl.name().lexeme(); });
+        if (other != workspace->benchmarks.end()) {
+            auto diag = diagnostic::builder()
+                        .location(decl.name().location())
+                        .severity(diagnostic::severity::error)
+                        .message(diagnostic::format("You have already declared a benchmark named `$`, idiot!", decl.name().lexeme()))
+                        .highlight(decl.name().range(), "conflicting")
+                        .note((*other)->name().range(), "Here's the homonymous declaration, you f*cker!")
+                        .build();
+            
+            publisher().publish(diag);
+        }
+        else {
+            // traverse body
+            decl.body()->accept(*this);
+            // add benchmark to list of benchmarks of this workspace
+            workspace->benchmarks.push_back(&decl);
+        }
+        // resolved fully
+        decl.annotation().resolved = true;
+        decl.annotation().scope = workspace;
+    }
+
     void checker::visit(const ast::function_declaration& decl) 
     {
         std::unordered_map<std::string, token> names;
@@ -12321,7 +12845,7 @@ namespace nemesis {
         // i) variables
         // ii) constants
         // iii) functions
-        // iv) tests 
+        // iv) tests and benchmarks
         else {
             auto saved = scope_;
             for (ast::pointer<ast::statement> stmt : decl.statements()) {
@@ -12329,6 +12853,7 @@ namespace nemesis {
                 auto prev = statement_;
                 statement_ = stmt.get();
                 if (std::dynamic_pointer_cast<ast::test_declaration>(stmt) || 
+                    std::dynamic_pointer_cast<ast::bench_declaration>(stmt) || 
                     std::dynamic_pointer_cast<ast::function_declaration>(stmt) ||
                     std::dynamic_pointer_cast<ast::var_declaration>(stmt) ||
                     std::dynamic_pointer_cast<ast::var_tupled_declaration>(stmt)) try {
@@ -12347,7 +12872,23 @@ namespace nemesis {
         }
     }
 
+    class dependencies checker::dependencies() const
+    {
+        class dependencies result;
+
+        for (auto& file : references_) {
+            for (auto& referenced : file.second) result.depend(file.first.string(), referenced.string());
+        }
+
+        return result;
+    }
+
     void checker::check() try {
+        // each declaration found by name lookup makes current file depend on file of that declaration,
+        // instantiations are included as they are resolved while checking the call site
+        observer_ = [this](const ast::declaration* decl) {
+            if (file_ && decl->range().filename.size() > 0) references_[file_->name()].insert(decl->range().filename);
+        };
         // pass zero
         pass_ = pass::zero;
         // each source file is associated to a workspace, and each workspace (which are namespaces)
@@ -12530,7 +13071,7 @@ namespace nemesis {
             // remove all variables from scope
             std::set<std::string> vars_to_remove;
             for (auto pair : scope_->values()) if (dynamic_cast<const ast::var_declaration*>(pair.second) || dynamic_cast<const ast::var_tupled_declaration*>(pair.second)) vars_to_remove.insert(pair.first);
-            for (auto var : vars_to_remove) scope_->values().erase(var);
+            for (auto var : vars_to_remove) scope_->remove_value(var);
         }
         // fourth and last pass, used to fully check remaining statements, which are
         // i) variables
@@ -12551,8 +13092,18 @@ namespace nemesis {
                 pair.second->ast()->accept(*this);
             }   
         }
+        // lookups from later stages are not recorded
+        observer_ = nullptr;
+        // all function bodies have been checked, so uses of local variables are complete
+        find_last_uses();
+        // all extensions have been checked, so implementors of each behaviour are complete
+        devirtualize();
+        // all loops have been checked, so ranges of iteration variables are complete
+        find_safe_indices();
+        // all loops have been checked, so conditions of their contracts are resolved
+        hoist_contracts();
     }
-    catch (abort_error&) {}
+    catch (abort_error&) { observer_ = nullptr; }
 
     void substitutions::substitute() { root_->accept(*this); }
 
@@ -12833,6 +13384,8 @@ namespace nemesis {
     void substitutions::visit(const ast::generic_type_parameter_declaration& decl) {}
     
     void substitutions::visit(const ast::test_declaration& decl) { decl.body()->accept(*this); }
+
+    void substitutions::visit(const ast::bench_declaration& decl) { decl.body()->accept(*this); }
     
     void substitutions::visit(const ast::function_declaration& decl)
     {
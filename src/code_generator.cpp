@@ -1,7 +1,10 @@
 #include <algorithm>
 #include <fstream>
+#include <functional>
+#include <limits>
 #include <stack>
 #include <regex>
+#include <unordered_set>
 
 #include "nemesis/codegen/code_generator.hpp"
 #include "nemesis/analysis/environment.hpp"
@@ -13,13 +16,31 @@ namespace nemesis {
         std::string result;
 
         for (auto c : name) {
-            if (c == '"') result += '\\';
+            if (c == '"' || c == '\\') result += '\\';
             result += c;
         }
 
         return result;
     }
 
+    // compiled condition of a variant alternative starts with the test of its tag, then its subpatterns are tested
+    bool _tag_test(const ast::expression* condition)
+    {
+        auto binary = dynamic_cast<const ast::binary_expression*>(condition);
+        if (!binary) return false;
+        switch (binary->binary_operator().kind()) {
+        case token::kind::equal_equal:
+            if (auto member = std::dynamic_pointer_cast<ast::member_expression>(binary->left())) {
+                if (auto field = std::dynamic_pointer_cast<ast::identifier_expression>(member->member())) return field->identifier().lexeme().string() == "__tag";
+            }
+            return false;
+        case token::kind::line_line:
+            return _tag_test(binary->left().get()) || _tag_test(binary->right().get());
+        default:
+            return false;
+        }
+    }
+
     code_generator::code_generator(checker& checker) : checker_(checker), pass_(pass::declare) {}
 
     code_generator::~code_generator() {}
@@ -27,27 +48,27 @@ namespace nemesis {
     std::list<compilation::target> code_generator::generate()
     {
         // check that if we are compiling an app, there exists an entry point
-        if (!checker_.compilation().test() && checker_.compilation().current().kind == compilation::package::kind::app && !checker_.entry_point()) {
+        if (!checker_.compilation().test() && !checker_.compilation().bench() && checker_.compilation().current().kind == compilation::package::kind::app && !checker_.entry_point()) {
             checker_.publisher().publish(diagnostic::builder().severity(diagnostic::severity::error).message(diagnostic::format("You cannot compile this `$` app without providing `start` function, idiot. Write your own entry point!", checker_.compilation().current().name)).build());
             return {};
         }
+        // unity mode generates the whole program as a single compilation unit
+        if (unity_) return { emit_unity() };
         // cpp target files
         std::list<compilation::target> targets;
-        // public header will contains all public declarations and headers from `cpp` directories
-        filestream exported("__exported.h");
-        // adds all `src` header files (.h, .hpp)
-        for (auto package : checker_.compilation().packages()) {
-            // include headers from `src` directory
-            for (auto cpp : package.second.cpp_sources) {
-                // if extension is '.h' or '.hpp' then file is included
+        // each workspace has its own header with its public declarations, which includes headers of
+        // imported workspaces, so that each compilation unit only parses declarations it can reach
+        for (auto workspace : checker_.compilation().workspaces()) {
+            filestream exported(workspace.first + ".h");
+            exported.stream() << "#pragma once\n";
+            // include headers from `cpp` directory of its package, if extension is '.h' or '.hpp'
+            for (auto cpp : checker_.compilation().package(workspace.second->package).cpp_sources) {
                 if (cpp->has_type(source_file::filetype::header)) exported.stream() << "#include \"" << cpp->name() << "\"\n";
             }
-        }
-        // all exported declarations are added to a standard header file
-        for (auto workspace : checker_.compilation().workspaces()) {
+            // include headers of imported workspaces
+            for (auto imported : workspace.second->imports) exported.stream() << "#include \"" << imported.first << ".h\"\n";
             exported.stream() << "/* Forward declarations from workspace '" << workspace.first << "' */\n";
             // if package associated to current workspace is builtin, then workspace is not compiled
-            //std::cout << workspace.first << " " << std::flush << workspace.second->package << '\n';
             if (!checker_.compilation().package(workspace.second->package).builtin) {
                 // sets current library
                 workspace_ = workspace.second;
@@ -58,19 +79,19 @@ namespace nemesis {
                 }
                 // forward function declarations
                 for (auto fndecl : workspace.second->functions) {
-                    if (fndecl->generic() || (checker_.compilation().test() && fndecl == checker_.entry_point())) continue;
+                    if (fndecl->generic() || ((checker_.compilation().test() || checker_.compilation().bench()) && fndecl == checker_.entry_point())) continue;
                     exported.stream() << prototype(fndecl) << ";\n";
                 }
                 // forward lambda type declarations
-                for (auto lambda : workspace.second->lambdas) exported.stream() << "struct __lambda" << lambda.second << ";\n";
+                for (auto lambda : lambdas(*workspace.second)) exported.stream() << "struct " << closure(lambda) << ";\n";
                 // forward test declaration
                 if (checker_.compilation().test()) for (auto test : workspace.second->tests) exported.stream() << prototype(test) << ";\n";
+                // forward benchmark declaration
+                if (checker_.compilation().bench()) for (auto bench : workspace.second->benchmarks) exported.stream() << prototype(bench) << ";\n";
             }
+            // adds header file of workspace to targets
+            targets.push_back({ exported.path(), exported.stream().str(), true });
         }
-        // adds exported header file to targets
-        targets.push_front({ "__exported.h", exported.stream().str(), true });
-
-        //std::cout << "--- __exported.h ---\n" << exported.stream().str() << '\n';
 
         // for each workspace it generates a new C++ file to compile if workspace's package is not set as builtin
         for (auto workspace : checker_.compilation().workspaces()) {
@@ -82,8 +103,8 @@ namespace nemesis {
             std::string target = workspace.first + ".cpp";
             // constructs a new file stream
             output_ = filestream(target);
-            // include public header
-            output_.stream() << "#include \"__exported.h\"\n";
+            // include header of workspace
+            output_.stream() << "#include \"" << workspace.first << ".h\"\n";
             // emits all type declarations with method declarations inside each file
             output_.stream() << "/* Type definitions */\n";
             pass_ = pass::declare;
@@ -91,6 +112,16 @@ namespace nemesis {
                 if (auto typedecl = dynamic_cast<const ast::type_declaration*>(type->declaration())) typedecl->accept(*this);
                 else emit_anonymous_type(type);
             }
+            // static tables of constants are inserted here once all their uses are known
+            auto tables_position = static_cast<std::size_t>(output_.stream().tellp());
+            tables_.clear();
+            tables_definitions_.str("");
+            locations_.clear();
+            frames_.clear();
+            temporaries_ = 0;
+            closures_.clear();
+            // specializations of functions taking closures are declared before any definition which may call them
+            for (auto fndecl : workspace.second->functions) if (specialized(fndecl)) output_.stream() << specialization(fndecl) << ";\n";
             // emits all methods definitions
             output_.stream() << "/* Methods definitions */\n";
             pass_ = pass::define;
@@ -99,14 +130,14 @@ namespace nemesis {
                 else emit_anonymous_type(type);
             }
             // lambda type definitions
-            for (auto lambda : workspace.second->lambdas) emit_lambda_type(lambda.first);
+            for (auto lambda : lambdas(*workspace.second)) emit_lambda_type(lambda);
             // global variables definitions
             output_.stream() << "/* Variable and constants definitions */\n";
             for (auto valuedecl : workspace.second->globals) valuedecl->accept(*this);
             // function definitions
             output_.stream() << "/* Function definitions */\n";
             for (auto fndecl : workspace.second->functions) {
-                if (fndecl->generic() || (checker_.compilation().test() && fndecl == checker_.entry_point())) continue;
+                if (fndecl->generic() || ((checker_.compilation().test() || checker_.compilation().bench()) && fndecl == checker_.entry_point())) continue;
                 fndecl->accept(*this);
             }
             // tests definitions
@@ -114,8 +145,15 @@ namespace nemesis {
                 output_.stream() << "/* Tests definitions */\n";
                 for (auto testdecl : workspace.second->tests) testdecl->accept(*this);
             }
+            // benchmarks definitions
+            if (checker_.compilation().bench()) {
+                output_.stream() << "/* Benchmarks definitions */\n";
+                for (auto benchdecl : workspace.second->benchmarks) benchdecl->accept(*this);
+            }
+            // table of traced functions at the end of the file, once they are all defined
+            output_.stream() << emit_frames();
             // adds new cpp file to targets list
-            targets.push_back({ target, output_.stream().str() });
+            targets.push_back({ target, emit_tables(tables_position) });
 
             //std::cout << "---" << workspace.first << ".cpp---\n" << output_.stream().str() << '\n';
         }
@@ -126,15 +164,43 @@ namespace nemesis {
             // we are not inside any library or app currently
             workspace_ = nullptr;
             // test target name
-            std::string target = "test" + std::to_string(std::rand()) + ".cpp";
+            std::string target = "__tests.cpp";
             // constructs a new file stream
             output_ = filestream(target);
-            // include public header
-            output_.stream() << "#include \"__exported.h\"\n";
+            // include headers of all workspaces
+            for (auto workspace : checker_.compilation().workspaces()) output_.stream() << "#include \"" << workspace.first << ".h\"\n";
+            auto tables_position = static_cast<std::size_t>(output_.stream().tellp());
+            tables_.clear();
+            tables_definitions_.str("");
+            locations_.clear();
+            frames_.clear();
+            temporaries_ = 0;
             // emit all tests
             emit_tests();
             // appends new file for testing
-            targets.push_back({ target, output_.stream().str() });
+            targets.push_back({ target, emit_tables(tables_position) });
+        }
+        // benchmark mode, generates a new executable which measures benchmarks
+        if (checker_.compilation().bench()) {
+            pass_ = pass::define;
+            // we are not inside any library or app currently
+            workspace_ = nullptr;
+            // benchmark target name
+            std::string target = "__benchmarks.cpp";
+            // constructs a new file stream
+            output_ = filestream(target);
+            // include headers of all workspaces
+            for (auto workspace : checker_.compilation().workspaces()) output_.stream() << "#include \"" << workspace.first << ".h\"\n";
+            auto tables_position = static_cast<std::size_t>(output_.stream().tellp());
+            tables_.clear();
+            tables_definitions_.str("");
+            locations_.clear();
+            frames_.clear();
+            temporaries_ = 0;
+            // emit harness of all benchmarks
+            emit_benchmarks();
+            // appends new file for benchmarking
+            targets.push_back({ target, emit_tables(tables_position) });
         }
         // yields cpp targets list
         return targets;
@@ -171,15 +237,42 @@ namespace nemesis {
             { "c128", "std::complex<double>" },
             { "c256", "std::complex<long double>" }
         };
+        // tags of variants are ordinals of their types, stored in the smallest sufficient unsigned integer
+        static std::string tag_type(std::size_t count)
+        {
+            if (count <= 0x100) return "std::uint8_t";
+            else if (count <= 0x10000) return "std::uint16_t";
+            else return "std::uint32_t";
+        }
     }
 
     void code_generator::trace(bool flag) { trace_ = flag; }
 
     bool code_generator::trace() const { return trace_; }
 
+    void code_generator::profile(bool flag) { profile_ = flag; }
+
+    bool code_generator::profile() const { return profile_; }
+
+    void code_generator::unity(bool flag) { unity_ = flag; }
+
+    bool code_generator::unity() const { return unity_; }
+
     std::string code_generator::emit(ast::pointer<ast::type> type) const
     {
-        auto it = impl::cpp_builtins.find(type->string());
+        // C++ spelling is memoized on the type itself after first emission
+        if (!type->mangled().empty()) return type->mangled();
+
+        auto result = mangle(type);
+
+        type->mangled(result);
+
+        return result;
+    }
+
+    std::string code_generator::mangle(ast::pointer<ast::type> type) const
+    {
+        auto it = impl::cpp_builtins.find(type->canonical());
 
         if (it != impl::cpp_builtins.end()) return it->second;
 
@@ -224,9 +317,9 @@ namespace nemesis {
                 if (types::compatible(types::unit(), fun_type->result())) result << "void";
                 else result << emit(fun_type->result());
 
-                for (unsigned i = 0; i < fun_type->formals().size(); ++i) result << ", " << emit(fun_type->formals().at(i));
+                for (unsigned i = 0; i < fun_type->formals().size(); ++i) result << ", " << emit_formal(fun_type->formals().at(i));
 
-                result << ">&";
+                result << ">";
 
                 return result.str();
             }
@@ -238,7 +331,7 @@ namespace nemesis {
 
             for (unsigned i = 0; i < fun_type->formals().size(); ++i) {
                 if (i > 0) result << ", ";
-                result << emit(fun_type->formals().at(i));
+                result << emit_formal(fun_type->formals().at(i));
             }
 
             result << ")";
@@ -253,7 +346,7 @@ namespace nemesis {
             return result.str();
         }
         // anonymous structure/variant is instantiated
-        else if (type->category() == ast::type::category::structure_type || type->category() == ast::type::category::variant_type) return "__T" + std::to_string(std::hash<std::string>()(type->string()));
+        else if (type->category() == ast::type::category::structure_type || type->category() == ast::type::category::variant_type) return "__T" + std::to_string(type->hash());
 
         auto result = type->string();
 
@@ -264,7 +357,7 @@ namespace nemesis {
 
     std::string code_generator::emit(ast::pointer<ast::type> type, std::string variable) const
     {
-        auto it = impl::cpp_builtins.find(type->string());
+        auto it = impl::cpp_builtins.find(type->canonical());
 
         if (it != impl::cpp_builtins.end()) return it->second + " " + variable;
 
@@ -310,9 +403,9 @@ namespace nemesis {
                 if (types::compatible(types::unit(), fun_type->result())) result << "void";
                 else result << emit(fun_type->result());
 
-                for (unsigned i = 0; i < fun_type->formals().size(); ++i) result << ", " << emit(fun_type->formals().at(i));
+                for (unsigned i = 0; i < fun_type->formals().size(); ++i) result << ", " << emit_formal(fun_type->formals().at(i));
 
-                result << ">& " << variable;
+                result << "> " << variable;
 
                 return result.str();
             }
@@ -324,7 +417,7 @@ namespace nemesis {
 
             for (unsigned i = 0; i < fun_type->formals().size(); ++i) {
                 if (i > 0) result << ", ";
-                result << emit(fun_type->formals().at(i));
+                result << emit_formal(fun_type->formals().at(i));
             }
 
             result << ")";
@@ -339,7 +432,7 @@ namespace nemesis {
             return result.str();
         }
         // anonymous structure/variant is instantiated
-        else if (type->category() == ast::type::category::structure_type || type->category() == ast::type::category::variant_type) return "__T" + std::to_string(std::hash<std::string>()(type->string())) + " " + variable;
+        else if (type->category() == ast::type::category::structure_type || type->category() == ast::type::category::variant_type) return "__T" + std::to_string(type->hash()) + " " + variable;
 
         auto result = type->string();
 
@@ -406,11 +499,157 @@ namespace nemesis {
                     os << "}";
                     return os.str();
                 }
+            case nemesis::ast::type::category::structure_type:
+            {
+                // fields are stored in declaration order, like aggregate initialization
+                std::ostringstream os;
+                os << emit(value.type) << "{";
+                for (size_t i = 0; i < value.seq.size(); ++i) os << (i > 0 ? ", " : "") << emit(value.seq.at(i));
+                os << "}";
+                return os.str();
+            }
             default:
                 throw std::invalid_argument("code_generator::emit: invalid constant value type " + value.type->string());
         }
     }
 
+    namespace impl {
+        // minimum weight of a tuple, record or string constant to be hoisted into a static table
+        constexpr std::size_t table_weight = 4;
+        // weight of a constant value, which estimates the cost of its construction
+        std::size_t weight(const constval& value)
+        {
+            switch (value.type->category()) {
+                case ast::type::category::string_type:
+                    return 1 + value.s.size() / 8;
+                case ast::type::category::tuple_type:
+                case ast::type::category::array_type:
+                case ast::type::category::structure_type:
+                {
+                    std::size_t result = 0;
+                    for (auto& element : value.seq) result += weight(element);
+                    return result;
+                }
+                default:
+                    return 1;
+            }
+        }
+
+        bool has_array(const constval& value)
+        {
+            if (value.type->category() == ast::type::category::array_type) return true;
+            return std::any_of(value.seq.begin(), value.seq.end(), has_array);
+        }
+        // array literals can only initialize variables, so constant arrays and aggregates containing them are always hoisted
+        bool hoistable(const constval& value)
+        {
+            switch (value.type->category()) {
+                case ast::type::category::array_type:
+                    return !value.seq.empty();
+                case ast::type::category::string_type:
+                case ast::type::category::tuple_type:
+                case ast::type::category::structure_type:
+                    return has_array(value) || weight(value) >= table_weight;
+                default:
+                    return false;
+            }
+        }
+    }
+
+    std::string code_generator::table(constval value)
+    {
+        auto& bucket = tables_[value.hash()];
+        auto type = emit(value.type);
+        // equal constants of the same type share the same table
+        for (auto& entry : bucket) {
+            if (emit(entry.first.type) == type && entry.first == value) return entry.second;
+        }
+
+        std::string initializer;
+        // records holding arrays are built by their constructor from nested tables, as arrays are not copied by braces inside them
+        if (value.type->category() == ast::type::category::structure_type && impl::has_array(value) && dynamic_cast<const ast::record_declaration*>(value.type->declaration())) {
+            initializer = type + "(";
+            for (std::size_t i = 0; i < value.seq.size(); ++i) initializer += (i > 0 ? ", " : "") + (impl::has_array(value.seq.at(i)) ? table(value.seq.at(i)) : emit(value.seq.at(i)));
+            initializer += ")";
+        }
+        else {
+            initializer = emit(value);
+        }
+
+        // name is chosen after nested tables, which may share the same bucket
+        std::string name = "__table" + std::to_string(value.hash()) + "_" + std::to_string(bucket.size());
+        tables_definitions_ << "static const " << emit(value.type, name) << " = " << initializer << ";\n";
+        bucket.emplace_back(value, name);
+
+        return name;
+    }
+
+    std::string code_generator::location(const source_location& location)
+    {
+        auto key = std::make_tuple(location.filename.string(), location.line, location.column);
+        auto index = locations_.emplace(key, locations_.size()).first->second;
+        return "__locations[" + std::to_string(index) + "]";
+    }
+
+    std::string code_generator::location(const source_range& range)
+    {
+        return location(source_location(range.bline, range.bcolumn, range.filename));
+    }
+
+    std::string code_generator::temporary(const std::string& prefix)
+    {
+        return prefix + std::to_string(temporaries_++);
+    }
+
+    std::string code_generator::emit_tables(std::size_t position)
+    {
+        auto result = output_.stream().str();
+        std::string tables;
+        // locations are listed by their index
+        if (!locations_.empty()) {
+            std::vector<const std::tuple<std::string, unsigned, unsigned>*> sites(locations_.size());
+            for (auto& entry : locations_) sites.at(entry.second) = &entry.first;
+            tables += "/* Locations of run-time checks */\nstatic const __location __locations[] = {\n";
+            for (auto site : sites) tables += "    { \"" + _encode_name(std::get<0>(*site)) + "\", " + std::to_string(std::get<1>(*site)) + ", " + std::to_string(std::get<2>(*site)) + " },\n";
+            tables += "};\n";
+        }
+        if (!tables_.empty()) tables += "/* Constant tables */\n" + tables_definitions_.str();
+        result.insert(position, tables);
+        return result;
+    }
+
+    void code_generator::frame(const std::string& function, const std::string& name, const source_location& location)
+    {
+        if (!trace_ && !profile_) return;
+        frames_.emplace(function, "{ (const void*) &" + function + ", \"" + _encode_name(location.filename.string()) + "\", \"" + _encode_name(name) + "\", " + std::to_string(location.line) + ", " + std::to_string(location.column) + " }");
+        // call is recorded on the chain of its thread together with the location of its statement being executed
+        if (!trace_) return;
+        output_.line() << "__call __site((const void*) &" << function << ");\n";
+        site_ = true;
+    }
+
+    void code_generator::emit_site(const source_range& range)
+    {
+        if (site_) output_.line() << "__site.location = &" << location(range) << ";\n";
+    }
+
+    std::string code_generator::emit_frames() const
+    {
+        if (frames_.empty()) return {};
+        std::string result = "/* Traced functions */\nstatic const __frame __frames[] = {\n";
+        for (auto& frame : frames_) result += "    " + frame.second + ",\n";
+        result += "};\nstatic const __frames_registration __frames_registered(__frames, " + std::to_string(frames_.size()) + ");\n";
+        // sampler lives as long as the program inside the file of the entry point, after its table is registered
+        if (profile_ && frames_.count("main")) result += "static const __profiler __profiling;\n";
+        return result;
+    }
+
+    void code_generator::emit_constant(constval value)
+    {
+        if (impl::hoistable(value)) output_.stream() << table(value);
+        else output_.stream() << emit(value);
+    }
+
     void code_generator::emit_anonymous_type(ast::pointer<ast::type> type)
     {
         struct guard guard(output_);
@@ -443,10 +682,14 @@ namespace nemesis {
             if (pass_ == pass::declare) {
                 output_.line() << "struct " << emit(type) << " {\n";
 
-                {
+                if (niche(type)) {
                     struct guard inner(output_);
-                    // tag field is used to identify current type
-                    output_.line() << "std::size_t __tag;\n";
+                    emit_niche_members(type);
+                }
+                else {
+                    struct guard inner(output_);
+                    // tag field is used to identify current type by its ordinal
+                    output_.line() << impl::tag_type(variant_type->types().size()) << " __tag;\n";
                     // for each subtype there exists a field whose name is the hash of type name inside an anonymous union (no duplicate types!!)
                     output_.line() << "union {\n";
                     
@@ -454,44 +697,52 @@ namespace nemesis {
                         struct guard inner(output_);
                         // each field name is the hash of its type (unique within a variant)
                         for (auto subtype : variant_type->types()) {
-                            output_.line() << emit(subtype, "_" + std::to_string(std::hash<std::string>()(subtype->string()))) << ";\n";
+                            output_.line() << emit(subtype, "_" + std::to_string(subtype->hash())) << ";\n";
                         }
                     }
                     
                     output_.line() << "};\n";
-                    // constructor, copy-constructor and destructor are defined for non-trivial members of the union
-                    output_.line() << emit(type) << "();";
-                    output_.line() << emit(type) << "(const " << emit(type) << "& other);\n";
-                    output_.line() << "~" << emit(type) << "();\n";
+                    // constructor, copy-constructor and destructor are defined for non-trivial members of the union,
+                    // while a variant of trivially copyable types is trivially copyable itself
+                    output_.line() << emit(type) << "();\n";
+                    if (!trivial(type)) {
+                        output_.line() << emit(type) << "(const " << emit(type) << "& other);\n";
+                        output_.line() << "~" << emit(type) << "();\n";
+                    }
                 }
 
                 output_.line() << "};\n";
                 // create designated initializers for each variant type
                 for (auto subtype : variant_type->types()) {
-                    auto hash = std::to_string(std::hash<std::string>()(subtype->string()));
+                    auto hash = std::to_string(subtype->hash());
                     // first emits constructors for variant using each of its types
                     output_.line() << emit(type) << " " << emit(type) << "_init_" << hash << "(" << emit(subtype, "init") << ");\n";
                 }    
             }
+            else if (niche(type)) {
+                emit_niche_helpers(type);
+            }
             else {
                 // constructor, copy-constructor and destructor are defined for non-trivial members of the union
                 output_.line() << emit(type) << "::" << emit(type) << "() {}\n";
-                output_.line() << emit(type) << "::" << emit(type) << "(const " << emit(type) << "& other) : __tag(other.__tag) {\n";
-                {
-                    struct guard inner(output_);
-                    output_.line() << "switch (other.__tag) {\n";
-                    for (auto subtype : std::static_pointer_cast<ast::variant_type>(type)->types()) {
-                        auto hash = std::to_string(std::hash<std::string>()(subtype->string()));
-                        output_.line() << "case " << hash << "ull: _" << hash << " = other._" << hash << "; break;\n";
+                if (!trivial(type)) {
+                    output_.line() << emit(type) << "::" << emit(type) << "(const " << emit(type) << "& other) : __tag(other.__tag) {\n";
+                    {
+                        struct guard inner(output_);
+                        output_.line() << "switch (other.__tag) {\n";
+                        for (auto subtype : std::static_pointer_cast<ast::variant_type>(type)->types()) {
+                            auto hash = std::to_string(subtype->hash());
+                            output_.line() << "case " << variant_type->tag(subtype) << ": _" << hash << " = other._" << hash << "; break;\n";
+                        }
+                        output_.line() << "default: break;\n";
+                        output_.line() << "}\n";
                     }
-                    output_.line() << "default: break;\n";
                     output_.line() << "}\n";
+                    output_.line() << emit(type) << "::~" << emit(type) << "() {}\n";
                 }
-                output_.line() << "}\n";
-                output_.line() << emit(type) << "::~" << emit(type) << "() {}\n";
                 // create designated initializers for each variant type
                 for (auto subtype : variant_type->types()) {
-                    auto hash = std::to_string(std::hash<std::string>()(subtype->string()));
+                    auto hash = std::to_string(subtype->hash());
                     
                     // first emits constructors for variant using each of its types
                     output_.line() << emit(type) << " " << emit(type) << "_init_" << hash << "(" << emit(subtype, "init") << ") {\n";
@@ -499,7 +750,7 @@ namespace nemesis {
                     {
                         struct guard inner(output_);
                         output_.line() << emit(type, "result") << ";\n";
-                        output_.line() << "result.__tag = " << hash << "ull;\n";
+                        output_.line() << "result.__tag = " << variant_type->tag(subtype) << ";\n";
                         output_.line() << "result._" << hash << " = init;\n";
                         output_.line() << "return result;\n";
                     }
@@ -507,11 +758,11 @@ namespace nemesis {
                     output_.line() << "}\n";
 
                     // then emits explicit conversions to each of its types
-                    output_.line() << emit(subtype) << " " << emit(type) << "_as_" << hash << "(" << emit(type, "self") << ", const char* file, int line, int column) {\n";
+                    output_.line() << emit(subtype) << " " << emit(type) << "_as_" << hash << "(" << emit(type, "self") << ", const __location& location) {\n";
                     
                     {
                         struct guard inner(output_);
-                        output_.line() << "if (self.__tag != " << hash << "ull) __crash(\"damn, you cannot explictly convert variant since it has a different run-time type!\", file, line, column);\n";
+                        output_.line() << "if (__builtin_expect(self.__tag != " << variant_type->tag(subtype) << ", 0)) __crash(\"damn, you cannot explictly convert variant since it has a different run-time type!\", location);\n";
                         output_.line() << "return self._" << hash << "; \n";
                     }
 
@@ -522,9 +773,379 @@ namespace nemesis {
         else throw std::invalid_argument("code_generator::emit_anonymous_type(): invalid type " + type->string());
     }
 
+    bool code_generator::trivial(ast::pointer<ast::type> type) const
+    {
+        switch (type->category()) {
+        case ast::type::category::integer_type:
+        case ast::type::category::rational_type:
+        case ast::type::category::float_type:
+        case ast::type::category::complex_type:
+        case ast::type::category::bool_type:
+        case ast::type::category::char_type:
+        case ast::type::category::chars_type:
+        case ast::type::category::pointer_type:
+        case ast::type::category::slice_type:
+            return true;
+        case ast::type::category::range_type:
+            return trivial(std::static_pointer_cast<ast::range_type>(type)->base());
+        case ast::type::category::array_type:
+            return trivial(std::static_pointer_cast<ast::array_type>(type)->base());
+        // records have no copy routines, so they are trivially copyable as long as their fields are
+        case ast::type::category::structure_type:
+            for (auto field : std::static_pointer_cast<ast::structure_type>(type)->fields()) if (!trivial(field.type)) return false;
+            return true;
+        // variants whose alternatives are all trivially copyable are emitted without copy routines
+        case ast::type::category::variant_type:
+            for (auto subtype : std::static_pointer_cast<ast::variant_type>(type)->types()) if (!trivial(subtype)) return false;
+            return true;
+        // tuples are emitted as std::tuple, which has its own copy assignment
+        default:
+            return false;
+        }
+    }
+
+    bool code_generator::by_reference(ast::pointer<ast::type> type) const
+    {
+        // scalar values fit in a register
+        auto scalar = [](ast::pointer<ast::type> type) {
+            switch (type->category()) {
+            case ast::type::category::integer_type:
+            case ast::type::category::float_type:
+            case ast::type::category::bool_type:
+            case ast::type::category::char_type:
+            case ast::type::category::pointer_type:
+                return true;
+            // like `none`
+            case ast::type::category::structure_type:
+                return std::static_pointer_cast<ast::structure_type>(type)->fields().empty();
+            default:
+                return false;
+            }
+        };
+
+        switch (type->category()) {
+        case ast::type::category::string_type:
+        case ast::type::category::tuple_type:
+            return true;
+        // trivially copyable records of at most two scalars are passed by value in registers
+        case ast::type::category::structure_type:
+        {
+            auto fields = std::static_pointer_cast<ast::structure_type>(type)->fields();
+            if (!trivial(type) || fields.size() > 2) return true;
+            for (auto field : fields) if (!scalar(field.type)) return true;
+            return false;
+        }
+        // as well as trivially copyable variants of scalars
+        case ast::type::category::variant_type:
+            if (!trivial(type)) return true;
+            for (auto subtype : std::static_pointer_cast<ast::variant_type>(type)->types()) if (!scalar(subtype)) return true;
+            return false;
+        default:
+            return false;
+        }
+    }
+
+    std::string code_generator::emit_formal(ast::pointer<ast::type> type) const
+    {
+        // same as parameters, immutable arrays are read-only, while the array decays to pointer to its first element
+        if (auto array = std::dynamic_pointer_cast<ast::array_type>(type)) return (type->mutability ? "" : "const ") + emit(array->base(), "(*)");
+        if (by_reference(type)) return "const " + emit(type) + "&";
+        return emit(type);
+    }
+
+    std::string code_generator::emit_parameter(const ast::parameter_declaration* parameter) const
+    {
+        auto type = parameter->annotation().type;
+        // immutable arrays are read-only, so they can be passed from static tables of constants
+        if (type->category() == ast::type::category::array_type) return (parameter->is_mutable() ? "" : "const ") + emit(type, parameter->name().lexeme().string());
+        // value is expensive to copy, so it is passed by constant reference
+        if (by_reference(type)) return "const " + emit(type) + "& " + argument(parameter);
+
+        return emit(type, parameter->name().lexeme().string());
+    }
+
+    std::string code_generator::argument(const ast::parameter_declaration* parameter) const
+    {
+        // a mutable parameter passed by reference is bound to a hidden name and copied on entry
+        if (parameter->is_mutable() && by_reference(parameter->annotation().type)) return "__param_" + parameter->name().lexeme().string();
+        return parameter->name().lexeme().string();
+    }
+
+    void code_generator::emit_mutable_parameters(const ast::pointers<ast::declaration>& parameters)
+    {
+        for (auto decl : parameters) {
+            auto parameter = std::static_pointer_cast<ast::parameter_declaration>(decl);
+            if (argument(parameter.get()) != parameter->name().lexeme().string()) output_.line() << emit(parameter->annotation().type, parameter->name().lexeme().string()) << " = " << argument(parameter.get()) << ";\n";
+        }
+    }
+
+    bool code_generator::movable(ast::pointer<ast::type> type) const
+    {
+        switch (type->category()) {
+        case ast::type::category::string_type:
+        case ast::type::category::tuple_type:
+        case ast::type::category::structure_type:
+        case ast::type::category::variant_type:
+            return !trivial(type);
+        default:
+            return false;
+        }
+    }
+
+    void code_generator::emit_consumed(const ast::expression& expr)
+    {
+        auto inner = &expr;
+        // conversions, like construction of variants, consume their operand as well
+        while (true) {
+            if (auto conversion = dynamic_cast<const ast::implicit_conversion_expression*>(inner)) inner = conversion->expression().get();
+            else if (auto parenthesis = dynamic_cast<const ast::parenthesis_expression*>(inner)) inner = parenthesis->expression().get();
+            else break;
+        }
+
+        auto identifier = dynamic_cast<const ast::identifier_expression*>(inner);
+
+        if (identifier && checker_.last_use(*identifier) && movable(identifier->annotation().type)) {
+            auto saved = moved_;
+            moved_ = identifier;
+            expr.accept(*this);
+            moved_ = saved;
+        }
+        else expr.accept(*this);
+    }
+
+    bool code_generator::aliased(const ast::expression& expr) const
+    {
+        auto inner = &expr;
+        // storage reached through pointers or slices may be written by anyone holding them
+        while (true) {
+            if (auto conversion = dynamic_cast<const ast::implicit_conversion_expression*>(inner)) inner = conversion->expression().get();
+            else if (auto parenthesis = dynamic_cast<const ast::parenthesis_expression*>(inner)) inner = parenthesis->expression().get();
+            else if (auto member = dynamic_cast<const ast::member_expression*>(inner)) {
+                if (member->expression()->annotation().type->category() == ast::type::category::pointer_type) return true;
+                inner = member->expression().get();
+            }
+            else if (auto index = dynamic_cast<const ast::array_index_expression*>(inner)) {
+                if (index->expression()->annotation().type->category() != ast::type::category::array_type) return true;
+                inner = index->expression().get();
+            }
+            else if (auto index = dynamic_cast<const ast::tuple_index_expression*>(inner)) {
+                if (index->expression()->annotation().type->category() == ast::type::category::pointer_type) return true;
+                inner = index->expression().get();
+            }
+            else if (auto unary = dynamic_cast<const ast::unary_expression*>(inner)) return unary->unary_operator().kind() == token::kind::star;
+            else break;
+        }
+        // temporaries are owned by the call
+        auto identifier = dynamic_cast<const ast::identifier_expression*>(inner);
+        if (!identifier || !identifier->annotation().referencing) return false;
+        // a variable is only changed by another name if it's pointed, captured by closures or global
+        if (auto parameter = dynamic_cast<const ast::parameter_declaration*>(identifier->annotation().referencing)) return parameter->annotation().addressed;
+        if (auto var = dynamic_cast<const ast::var_declaration*>(identifier->annotation().referencing)) {
+            bool global = var->is_static() || !dynamic_cast<const ast::block_expression*>(var->annotation().scope);
+            return var->annotation().addressed || checker_.escaping(var) || (global && var->is_mutable());
+        }
+
+        return false;
+    }
+
+    bool code_generator::readonly(const ast::expression& expr) const
+    {
+        auto inner = &expr;
+        // storage reached through pointers or slices may be written by anyone holding them
+        while (true) {
+            if (auto conversion = dynamic_cast<const ast::implicit_conversion_expression*>(inner)) inner = conversion->expression().get();
+            else if (auto parenthesis = dynamic_cast<const ast::parenthesis_expression*>(inner)) inner = parenthesis->expression().get();
+            else if (auto member = dynamic_cast<const ast::member_expression*>(inner)) {
+                if (member->expression()->annotation().type->category() == ast::type::category::pointer_type) return false;
+                inner = member->expression().get();
+            }
+            else if (auto index = dynamic_cast<const ast::array_index_expression*>(inner)) {
+                if (index->expression()->annotation().type->category() != ast::type::category::array_type) return false;
+                inner = index->expression().get();
+            }
+            else if (auto index = dynamic_cast<const ast::tuple_index_expression*>(inner)) {
+                if (index->expression()->annotation().type->category() == ast::type::category::pointer_type) return false;
+                inner = index->expression().get();
+            }
+            else if (auto unary = dynamic_cast<const ast::unary_expression*>(inner)) return unary->unary_operator().kind() != token::kind::star;
+            else break;
+        }
+        // slices are views of other storage, while immutable variables and temporaries are never written
+        if (inner->annotation().type->category() == ast::type::category::slice_type) return false;
+        if (dynamic_cast<const ast::identifier_expression*>(inner)) return inner->immutable() != nullptr;
+        return true;
+    }
+
+    void code_generator::emit_argument(const ast::expression& expr, ast::pointer<ast::type> formal)
+    {
+        // argument bound to a constant reference is copied when it may change during the call through another name
+        if (by_reference(formal) && aliased(expr)) {
+            output_.stream() << emit(formal) << "(";
+            expr.accept(*this);
+            output_.stream() << ")";
+        }
+        else emit_consumed(expr);
+    }
+
+    const ast::declaration* code_generator::devirtualized(const ast::member_expression& expr) const
+    {
+        auto target = checker_.devirtualized(expr);
+        if (!target || !workspace_) return nullptr;
+        // implementation is called directly only if its prototype is visible inside current file
+        auto self = target->kind() == ast::kind::function_declaration ? static_cast<const ast::function_declaration*>(target)->parameters().front() : static_cast<const ast::property_declaration*>(target)->parameters().front();
+        auto implementor = std::static_pointer_cast<ast::pointer_type>(self->annotation().type)->base();
+        if (std::none_of(workspace_->types.begin(), workspace_->types.end(), [&](ast::pointer<ast::type> type) { return type->declaration() == implementor->declaration(); })) return nullptr;
+
+        return target;
+    }
+
+    void code_generator::emit_devirtualized_object(const ast::member_expression& expr)
+    {
+        auto target = checker_.devirtualized(expr);
+        auto self = target->kind() == ast::kind::function_declaration ? static_cast<const ast::function_declaration*>(target)->parameters().front() : static_cast<const ast::property_declaration*>(target)->parameters().front();
+        auto implementor = std::static_pointer_cast<ast::pointer_type>(self->annotation().type)->base();
+        auto behaviour = std::static_pointer_cast<ast::pointer_type>(expr.expression()->annotation().type)->base();
+        // base object of behavioural type is moved back to the beginning of the implementor object, as virtual dispatcher does
+        output_.stream() << "(" << emit(self->annotation().type) << ") ((char*) ";
+        expr.expression()->accept(*this);
+        output_.stream() << " - offsetof(" << emit(implementor) << ", __vptr_" << emit(behaviour) << "))";
+    }
+
+    ast::pointer<ast::type> code_generator::niche(ast::pointer<ast::type> type) const
+    {
+        auto variant = std::dynamic_pointer_cast<ast::variant_type>(type);
+        // vpointers need a constructor, so variants implementing behaviours keep their tag
+        if (!variant || variant->types().size() != 2 || types::implementors().count(type)) return nullptr;
+
+        auto none = checker_.scopes().at(checker_.compilation().workspaces().at("core").get())->type("none")->annotation().type;
+        ast::pointer<ast::type> payload = nullptr;
+
+        if (types::compatible(variant->types().front(), none)) payload = variant->types().back();
+        else if (types::compatible(variant->types().back(), none)) payload = variant->types().front();
+        else return nullptr;
+
+        switch (payload->category()) {
+        // pointers are never null, codepoints never exceed 0x10ffff and booleans are either 0 or 1
+        case ast::type::category::pointer_type:
+        case ast::type::category::char_type:
+        case ast::type::category::bool_type:
+            return payload;
+        default:
+            return nullptr;
+        }
+    }
+
+    std::string code_generator::tag(ast::pointer<ast::type> type) const
+    {
+        return niche(type) ? "__tag()" : "__tag";
+    }
+
+    void code_generator::emit_niche_members(ast::pointer<ast::type> type)
+    {
+        auto variant = std::static_pointer_cast<ast::variant_type>(type);
+        auto payload = niche(type);
+        auto none = variant->types().at(1 - variant->tag(payload));
+        auto field = "_" + std::to_string(payload->hash());
+        // `none` is stored as an invalid value of payload, so that no tag field is needed
+        output_.line() << "union {\n";
+        {
+            struct guard inner(output_);
+            output_.line() << emit(payload, field) << ";\n";
+            output_.line() << emit(none, "_" + std::to_string(none->hash())) << ";\n";
+            if (payload->category() == ast::type::category::bool_type) output_.line() << "std::uint8_t __niche;\n";
+        }
+        output_.line() << "};\n";
+        // tag is computed from payload
+        output_.line() << "std::uint8_t __tag() const { return ";
+        switch (payload->category()) {
+        case ast::type::category::pointer_type:
+            output_.stream() << field << " == nullptr";
+            break;
+        case ast::type::category::char_type:
+            output_.stream() << field << ".codepoint == 0x110000";
+            break;
+        default:
+            output_.stream() << "__niche == 2";
+            break;
+        }
+        output_.stream() << " ? " << variant->tag(none) << " : " << variant->tag(payload) << "; }\n";
+    }
+
+    void code_generator::emit_niche_helpers(ast::pointer<ast::type> type)
+    {
+        auto variant = std::static_pointer_cast<ast::variant_type>(type);
+        auto payload = niche(type);
+
+        for (auto subtype : variant->types()) {
+            auto hash = std::to_string(subtype->hash());
+            // emits constructor for each of its types
+            output_.line() << emit(type) << " " << emit(type) << "_init_" << hash << "(" << emit(subtype, "init") << ") {\n";
+            
+            {
+                struct guard inner(output_);
+                output_.line() << emit(type, "result") << ";\n";
+                if (subtype != payload) {
+                    switch (payload->category()) {
+                    case ast::type::category::pointer_type:
+                        output_.line() << "result._" << payload->hash() << " = nullptr;\n";
+                        break;
+                    case ast::type::category::char_type:
+                        output_.line() << "result._" << payload->hash() << ".codepoint = 0x110000;\n";
+                        break;
+                    default:
+                        output_.line() << "result.__niche = 2;\n";
+                        break;
+                    }
+                }
+                else output_.line() << "result._" << hash << " = init;\n";
+                output_.line() << "return result;\n";
+            }
+
+            output_.line() << "}\n";
+            // then emits explicit conversions to each of its types
+            output_.line() << emit(subtype) << " " << emit(type) << "_as_" << hash << "(" << emit(type, "self") << ", const __location& location) {\n";
+            
+            {
+                struct guard inner(output_);
+                output_.line() << "if (__builtin_expect(self.__tag() != " << variant->tag(subtype) << ", 0)) __crash(\"damn, you cannot explictly convert variant since it has a different run-time type!\", location);\n";
+                output_.line() << "return self._" << hash << "; \n";
+            }
+
+            output_.line() << "}\n";
+        }
+    }
+
+    enum compilation::package::contracts code_generator::contracts_level() const
+    {
+        // tests are always fully checked
+        if (!workspace_) return compilation::package::contracts::full;
+        return checker_.compilation().package(workspace_->package).contracts;
+    }
+
+    void code_generator::emit_hoisted_contracts(const ast::pointers<ast::statement>& contracts)
+    {
+        if (contracts_level() != compilation::package::contracts::full) return;
+        // conditions which don't change among iterations are evaluated once, while each iteration only tests the result
+        for (auto contract : contracts) {
+            auto stmt = std::static_pointer_cast<ast::contract_statement>(contract);
+            if (!checker_.hoisted(*stmt)) continue;
+            auto name = temporary("__k");
+            output_.line() << "bool " << name << " = ";
+            stmt->condition()->accept(*this);
+            output_.stream() << ";\n";
+            hoisted_[stmt.get()] = name;
+        }
+    }
+
     void code_generator::emit_in_contracts(const ast::node& current)
     {
+        auto level = contracts_level();
+        
+        if (level == compilation::package::contracts::off) return;
+
         if (auto outer = checker_.scopes().at(&current)->outscope(environment::kind::loop)) {
+            // contracts of loops are only tested in full mode
+            if (level != compilation::package::contracts::full) return;
             // first, before return statement, we must test invariant and ensure contracts, if any
             if (auto loop = dynamic_cast<const ast::for_loop_expression*>(outer)) {
                 for (auto contract : loop->contracts()) if (!std::static_pointer_cast<ast::contract_statement>(contract)->is_ensure()) contract->accept(*this);
@@ -534,17 +1155,22 @@ namespace nemesis {
             }
         }
         else if (auto outer = checker_.scopes().at(&current)->outscope(environment::kind::function)) {
-            if (auto function = dynamic_cast<const ast::function_declaration*>(outer)) {
-                for (auto contract : function->contracts()) if (!std::static_pointer_cast<ast::contract_statement>(contract)->is_ensure()) contract->accept(*this);
-            }
-            else if (auto function = dynamic_cast<const ast::property_declaration*>(outer)) {
-                for (auto contract : function->contracts()) if (!std::static_pointer_cast<ast::contract_statement>(contract)->is_ensure()) contract->accept(*this);
+            // in entry mode only preconditions are tested
+            ast::pointers<ast::statement> contracts;
+            if (auto function = dynamic_cast<const ast::function_declaration*>(outer)) contracts = function->contracts();
+            else if (auto function = dynamic_cast<const ast::property_declaration*>(outer)) contracts = function->contracts();
+            for (auto contract : contracts) {
+                auto stmt = std::static_pointer_cast<ast::contract_statement>(contract);
+                if (level == compilation::package::contracts::full ? !stmt->is_ensure() : stmt->is_require()) contract->accept(*this);
             }
         }
     }
     
     void code_generator::emit_out_contracts(const ast::node& current)
     {
+        // postconditions and invariants are only tested in full mode
+        if (contracts_level() != compilation::package::contracts::full) return;
+
         if (auto outer = checker_.scopes().at(&current)->outscope(environment::kind::loop)) {
             if (auto loop = dynamic_cast<const ast::for_loop_expression*>(outer)) {
                 for (auto contract : loop->contracts()) if (!std::static_pointer_cast<ast::contract_statement>(contract)->is_require()) contract->accept(*this);
@@ -563,43 +1189,57 @@ namespace nemesis {
         }
     }
 
+    std::vector<const ast::function_expression*> code_generator::lambdas(const ast::workspace& workspace) const
+    {
+        // lambdas are keyed by address, so they are sorted by their id to be emitted in the same order at each compilation
+        std::vector<const ast::function_expression*> result(workspace.lambdas.size());
+        for (auto lambda : workspace.lambdas) result.at(lambda.second) = lambda.first;
+        return result;
+    }
+
+    std::string code_generator::closure(const ast::function_expression* lambda) const
+    {
+        // closure types are named after their workspace as ids are only unique inside it
+        return workspace_->name + "_lambda" + std::to_string(workspace_->lambdas.at(lambda));
+    }
+
     void code_generator::emit_lambda_type(const ast::function_expression* lambda)
     {
         struct guard guard(output_);
+        // closure may be emitted while its enclosing function is, whose call record is set aside meanwhile
+        bool site = site_;
+        site_ = false;
         auto fntype = std::dynamic_pointer_cast<ast::function_type>(lambda->annotation().type);
-        std::size_t id = workspace_->lambdas.at(lambda);
-
-        output_.line() << "struct __lambda" << id << " : __lambda<";
+        auto name = closure(lambda);
+        // closure type is not polymorphic, its call operator is reached through a plain function pointer instead of a virtual table
+        std::ostringstream signature;
 
-        if (types::compatible(types::unit(), fntype->result())) output_.stream() << "void";
-        else output_.stream() << emit(fntype->result());
+        if (types::compatible(types::unit(), fntype->result())) signature << "void";
+        else signature << emit(fntype->result());
 
-        for (auto formal : fntype->formals()) output_.stream() << ", " << emit(formal);
+        for (auto formal : fntype->formals()) signature << ", " << emit_formal(formal);
 
-        output_.stream() << "> {\n";
+        output_.line() << "struct " << name << " {\n";
 
         {
             struct guard inner(output_);
-            // since lambdas are allocated on heap memory, we need to release them, so a static array of pointers is maintaned
-            output_.line() << "static std::vector<std::unique_ptr<__lambda" << id << ">> __lambdas;\n";
+            // escaping closures are allocated on heap memory, so we need to release them, so a static array of pointers is maintaned
+            if (!lambda->captured().empty()) output_.line() << "static std::vector<std::unique_ptr<" << name << ">> __lambdas;\n";
+            // closure without captured variables is shared by all its uses
+            else output_.line() << "static " << name << " __instance;\n";
             // captured variables as references
             for (auto captured : lambda->captured()) output_.line() << emit(captured->annotation().type) << "& " << captured->name().lexeme() << ";\n";
             // constructor with captured variables
-            output_.line() << "__lambda" << id << "(";
+            output_.line() << name << "(";
             unsigned index = 0;
             for (auto captured : lambda->captured()) {
                 if (index++ > 0) output_.stream() << ", ";
                 output_.stream() << emit(captured->annotation().type) << "& " << captured->name().lexeme();
             }
-            output_.stream() << ") : __lambda<";
-            if (types::compatible(types::unit(), fntype->result())) output_.stream() << "void";
-            else output_.stream() << emit(fntype->result());
-            for (auto formal : fntype->formals()) output_.stream() << ", " << emit(formal);
-            output_.stream() << ">()";
-            for (auto captured : lambda->captured()) output_.stream() << ", " << captured->name().lexeme() << "(" << captured->name().lexeme() << ")";
+            output_.stream() << ")";
+            index = 0;
+            for (auto captured : lambda->captured()) output_.stream() << (index++ > 0 ? ", " : " : ") << captured->name().lexeme() << "(" << captured->name().lexeme() << ")";
             output_.stream() << " {}\n";
-            // destructor
-            output_.line() << "~__lambda" << id << "() {}\n";
             // call function with operator ()
             if (types::compatible(types::unit(), fntype->result())) output_.line() << "void";
             else output_.line() << emit(fntype->result());
@@ -610,14 +1250,20 @@ namespace nemesis {
                 param->accept(*this);
             }
             output_.stream() << ") {\n";
-            // stack activation record for stacktrace
-            output_.stream() << "#if __DEVELOPMENT__\n";
-            output_.line() << "__stack_activation_record __record(\"" << lambda->range().filename << "\", \"" << _encode_name(lambda->annotation().type->string()) << "\", " << lambda->range().bline << ", " << lambda->range().bcolumn << ");\n";
-            output_.stream() << "#endif\n";
+            {
+                struct guard inner(output_);
+                // closure is called through its invoker, which is the function seen on the stack
+                frame("__invoke<" + name + ", " + signature.str() + ">", lambda->annotation().type->string(), source_location(lambda->range().bline, lambda->range().bcolumn, lambda->range().filename));
+            }
+            temporaries_ = 0;
+            emit_mutable_parameters(lambda->parameters());
             lambda->body()->accept(*this);
             output_.line() << "}\n";
-            // static constructor for returning reference
-            output_.line() << "static __lambda& __new(";
+            site_ = false;
+            // reference to this closure as a function value
+            output_.line() << "__lambda<" << signature.str() << "> __ref() { return { this, &__invoke<" << name << ", " << signature.str() << "> }; }\n";
+            // static constructor for escaping closures
+            output_.line() << "static __lambda<" << signature.str() << "> __new(";
             index = 0;
             for (auto captured : lambda->captured()) {
                 if (index++ > 0) output_.stream() << ", ";
@@ -626,26 +1272,117 @@ namespace nemesis {
             output_.stream() << ") {\n";
             {
                 struct guard inner(output_);
-                index = 0;
-                output_.line() << "__lambdas.emplace_back(std::make_unique<__lambda" << id << ">(";
-                for (auto captured : lambda->captured()) {
-                    if (index++ > 0) output_.stream() << ", ";
-                    output_.stream() << captured->name().lexeme();
+
+                if (lambda->captured().empty()) output_.line() << "return __instance.__ref();\n";
+                else {
+                    index = 0;
+                    output_.line() << "__lambdas.emplace_back(std::make_unique<" << name << ">(";
+                    for (auto captured : lambda->captured()) {
+                        if (index++ > 0) output_.stream() << ", ";
+                        output_.stream() << captured->name().lexeme();
+                    }
+                    output_.stream() << "));\n";
+                    output_.line() << "return __lambdas.back()->__ref();\n";
                 }
-                output_.stream() << "));\n";
-                output_.line() << "return *__lambdas.back();\n";
             }
             output_.line() << "}\n";
         }
 
         output_.line() << "};\n";
-        // instantiate (heap) lambdas vector
-        output_.line() << "std::vector<std::unique_ptr<__lambda" << id << ">> __lambda" << id << "::__lambdas;\n";
+        // instantiate (heap) lambdas vector or shared closure
+        if (!lambda->captured().empty()) output_.line() << "std::vector<std::unique_ptr<" << name << ">> " << name << "::__lambdas;\n";
+        else output_.line() << name << " " << name << "::__instance;\n";
+        closures_.insert(lambda);
+        site_ = site;
+    }
+
+    bool code_generator::closure_parameter(const ast::parameter_declaration* parameter) const
+    {
+        auto fntype = std::dynamic_pointer_cast<ast::function_type>(parameter->annotation().type);
+        return fntype && fntype->is_lambda() && checker_.invoked_only(parameter);
+    }
+
+    bool code_generator::specialized(const ast::function_declaration* decl) const
+    {
+        // tables of traced functions need a single definition of each function, whose address is taken
+        if (!decl || trace_ || profile_ || !workspace_) return false;
+        if (decl->generic() || !decl->body() || decl == checker_.entry_point() || checker_.intrinsic(decl)) return false;
+        // methods are left as they are
+        if (dynamic_cast<const ast::type_declaration*>(checker_.scopes().at(decl)->outscope(environment::kind::declaration))) return false;
+        // specialization is only visible inside the output file of its function
+        if (!unity_ && std::find(workspace_->functions.begin(), workspace_->functions.end(), decl) == workspace_->functions.end()) return false;
+
+        return std::any_of(decl->parameters().begin(), decl->parameters().end(), [this](ast::pointer<ast::declaration> parameter) { return closure_parameter(static_cast<const ast::parameter_declaration*>(parameter.get())); });
+    }
+
+    std::string code_generator::specialization(const ast::function_declaration* decl) const
+    {
+        auto fntype = std::static_pointer_cast<ast::function_type>(decl->annotation().type);
+        std::ostringstream result, parameters;
+        unsigned count = 0;
+
+        for (std::size_t i = 0; i < decl->parameters().size(); ++i) {
+            auto parameter = static_cast<const ast::parameter_declaration*>(decl->parameters().at(i).get());
+            if (i > 0) parameters << ", ";
+            if (!closure_parameter(parameter)) parameters << emit_parameter(parameter);
+            else {
+                result << (count++ > 0 ? ", " : "template<") << "typename __F" << i;
+                parameters << "__F" << i << " " << parameter->name().lexeme();
+            }
+        }
+
+        result << "> ";
+
+        if (types::compatible(types::unit(), fntype->result())) result << "void ";
+        else result << emit(fntype->result()) << " ";
+
+        result << "__specialized" << fullname(decl) << "(" << parameters.str() << ")";
+
+        return result.str();
+    }
+
+    bool code_generator::emit_specialized_call(const ast::call_expression& expr)
+    {
+        auto function = dynamic_cast<const ast::function_declaration*>(expr.callee()->annotation().referencing);
+        
+        if (!std::dynamic_pointer_cast<ast::identifier_expression>(expr.callee()) || !specialized(function) || function->parameters().size() != expr.arguments().size()) return false;
+        // closures written as arguments whose types are already defined are passed by their own type, any other argument as usual
+        std::vector<const ast::function_expression*> literals(expr.arguments().size(), nullptr);
+
+        for (std::size_t i = 0; i < expr.arguments().size(); ++i) {
+            auto lambda = std::dynamic_pointer_cast<ast::function_expression>(expr.arguments().at(i));
+            if (lambda && closures_.count(lambda.get()) && closure_parameter(static_cast<const ast::parameter_declaration*>(function->parameters().at(i).get()))) literals.at(i) = lambda.get();
+        }
+
+        if (std::all_of(literals.begin(), literals.end(), [](const ast::function_expression* lambda) { return lambda == nullptr; })) return false;
+
+        auto fntype = std::static_pointer_cast<ast::function_type>(function->annotation().type);
+        output_.stream() << "__specialized" << fullname(function) << "(";
+
+        for (std::size_t i = 0; i < expr.arguments().size(); ++i) {
+            if (i > 0) output_.stream() << ", ";
+            if (!literals.at(i)) emit_argument(*expr.arguments().at(i), fntype->formals().at(i));
+            else if (literals.at(i)->captured().empty()) output_.stream() << closure(literals.at(i)) << "::__instance";
+            // captured variables are references, so closure lives on the stack of the caller for the whole call
+            else {
+                unsigned index = 0;
+                output_.stream() << closure(literals.at(i)) << "(";
+                for (auto captured : literals.at(i)->captured()) {
+                    if (index++ > 0) output_.stream() << ", ";
+                    output_.stream() << captured->name().lexeme();
+                }
+                output_.stream() << ")";
+            }
+        }
+
+        output_.stream() << ")";
+
+        return true;
     }
 
     void code_generator::emit_tests()
     {
-        output_.line() << "int main() {\n";
+        output_.line() << "int main(int __argc, char **__argv) {\n";
         {
             struct guard inner(output_);
             // signal handlers
@@ -655,24 +1392,178 @@ namespace nemesis {
             output_.line() << "std::signal(SIGFPE, __signal_handler);\n";
             output_.line() << "std::signal(SIGKILL, __signal_handler);\n";
             output_.line() << "std::signal(SIGSEGV, __signal_handler);\n";
-            // emits count of total tests and count of passed tests
-            output_.line() << "std::size_t __total = 0, __passed = 0;\n";
-            // for each workspace, it emits its tests
+            // table of all tests in the order of declaration, so that the driver can list them and run each by its index
+            std::size_t count = 0;
+            output_.line() << "static const __test __tests[] = {\n";
             for (auto workspace : checker_.compilation().workspaces()) {
                 // sets current library
                 workspace_ = workspace.second;
-                // for each test, it calls associated function and test if it has success or not
                 for (auto test : workspace.second->tests) {
-                    // increment number of total tests
-                    output_.line() << "++__total;\n";
-                    output_.line() << "__passed += " << fullname(test) << "();\n";
+                    struct guard inner(output_);
+                    output_.line() << "{ \"" << _encode_name(test->name().lexeme().string()) << "\", \"" << _encode_name(test->range().filename.string()) << "\", " << test->range().bline << ", &" << fullname(test) << " },\n";
+                    ++count;
+                }
+            }
+            output_.line() << "};\n";
+            output_.line() << "return __run_tests(__tests, " << count << ", __argc, __argv);\n";
+        }
+        output_.line() << "}\n";
+    }
+    
+    void code_generator::emit_benchmarks()
+    {
+        output_.line() << "int main(int __argc, char **__argv) {\n";
+        {
+            struct guard inner(output_);
+            // signal handlers
+            output_.line() << "std::signal(SIGABRT, __signal_handler);\n";
+            output_.line() << "std::signal(SIGQUIT, __signal_handler);\n";
+            output_.line() << "std::signal(SIGINT, __signal_handler);\n";
+            output_.line() << "std::signal(SIGFPE, __signal_handler);\n";
+            output_.line() << "std::signal(SIGKILL, __signal_handler);\n";
+            output_.line() << "std::signal(SIGSEGV, __signal_handler);\n";
+            // table of all benchmarks in the order of declaration, which are measured by the runtime
+            std::size_t count = 0;
+            output_.line() << "static const __benchmark __benchmarks[] = {\n";
+            for (auto workspace : checker_.compilation().workspaces()) {
+                // sets current library
+                workspace_ = workspace.second;
+                for (auto bench : workspace.second->benchmarks) {
+                    struct guard inner(output_);
+                    output_.line() << "{ \"" << _encode_name(bench->name().lexeme().string()) << "\", \"" << _encode_name(bench->range().filename.string()) << "\", " << bench->range().bline << ", " << bench->range().bcolumn << ", &" << fullname(bench) << " },\n";
+                    ++count;
                 }
             }
-            // reports of passed tests
-            output_.line() << "if (__total > 0) { std::printf(\"• you passed %lu out of %lu tests! %s\\n\", __passed, __total, __passed < (float) __total / 2 ? \"You could have done better, try again, pal. 😑\" : \"Not bad! 💪\"); }\n";
-            output_.line() << "return !(__total == __passed);\n";
+            output_.line() << "};\n";
+            output_.line() << "return __run_benchmarks(__benchmarks, " << count << ", __argc, __argv);\n";
+        }
+        output_.line() << "}\n";
+    }
+
+    std::vector<ast::pointer<ast::workspace>> code_generator::dependency_order() const
+    {
+        std::vector<ast::pointer<ast::workspace>> result;
+        std::unordered_set<const ast::workspace*> visited;
+        // post order traversal of imports, which are free of cycles after analysis, so each workspace follows those it imports
+        std::function<void(ast::pointer<ast::workspace>)> traverse = [&] (ast::pointer<ast::workspace> workspace) {
+            if (!visited.insert(workspace.get()).second) return;
+            for (auto imported : workspace->imports) traverse(checker_.compilation().workspaces().at(imported.first));
+            result.push_back(workspace);
+        };
+
+        for (auto workspace : checker_.compilation().workspaces()) traverse(workspace.second);
+
+        return result;
+    }
+
+    compilation::target code_generator::emit_unity()
+    {
+        // workspaces which are compiled, along with their types and functions, where those shared among workspaces are only kept once
+        struct unit {
+            ast::pointer<ast::workspace> workspace;
+            ast::pointers<ast::type> types;
+            std::vector<const ast::function_declaration*> functions;
+        };
+        std::vector<unit> units;
+        std::unordered_set<std::string> emitted;
+        // entry point is emitted last, outside of the anonymous namespace
+        ast::pointer<ast::workspace> entry = nullptr;
+
+        for (auto workspace : dependency_order()) {
+            if (checker_.compilation().package(workspace->package).builtin) continue;
+            workspace_ = workspace;
+            unit current { workspace, {}, {} };
+            for (auto type : workspace->types) if (emitted.insert(emit(type)).second) current.types.push_back(type);
+            for (auto fndecl : workspace->functions) {
+                if (fndecl->generic()) continue;
+                else if (fndecl == checker_.entry_point()) entry = workspace;
+                else if (emitted.insert(fullname(fndecl)).second) current.functions.push_back(fndecl);
+            }
+            units.push_back(current);
+        }
+        // constructs a new file stream
+        output_ = filestream("__unity.cpp");
+        // include headers from `cpp` directories of all packages, if extension is '.h' or '.hpp'
+        for (auto package : checker_.compilation().packages()) {
+            for (auto cpp : package.second.cpp_sources) {
+                if (cpp->has_type(source_file::filetype::header)) output_.stream() << "#include \"" << cpp->name() << "\"\n";
+            }
         }
-        output_.line() << "}\n";
+        // all definitions but the entry point have internal linkage, so the optimizer may inline or drop them knowing all their uses
+        output_.stream() << "namespace {\n";
+        output_.stream() << "/* Forward declarations */\n";
+        for (auto current : units) {
+            workspace_ = current.workspace;
+            for (auto type : current.types) {
+                if (auto typedecl = dynamic_cast<const ast::type_declaration*>(type->declaration())) output_.stream() << prototype(typedecl) << ";\n";
+                else output_.stream() << "struct " << emit(type) << ";\n";
+            }
+            for (auto fndecl : current.functions) output_.stream() << prototype(fndecl) << ";\n";
+            for (auto lambda : lambdas(*current.workspace)) output_.stream() << "struct " << closure(lambda) << ";\n";
+            if (checker_.compilation().test()) for (auto test : current.workspace->tests) output_.stream() << prototype(test) << ";\n";
+            if (checker_.compilation().bench()) for (auto bench : current.workspace->benchmarks) output_.stream() << prototype(bench) << ";\n";
+        }
+        // types are defined in order of dependency among workspaces
+        output_.stream() << "/* Type definitions */\n";
+        pass_ = pass::declare;
+        for (auto current : units) {
+            workspace_ = current.workspace;
+            for (auto type : current.types) {
+                if (auto typedecl = dynamic_cast<const ast::type_declaration*>(type->declaration())) typedecl->accept(*this);
+                else emit_anonymous_type(type);
+            }
+        }
+        // static tables of constants are inserted here once all their uses are known
+        auto tables_position = static_cast<std::size_t>(output_.stream().tellp());
+        tables_.clear();
+        tables_definitions_.str("");
+        locations_.clear();
+        frames_.clear();
+        closures_.clear();
+        temporaries_ = 0;
+        // specializations of functions taking closures are declared before any definition which may call them
+        for (auto current : units) {
+            workspace_ = current.workspace;
+            for (auto fndecl : current.functions) if (specialized(fndecl)) output_.stream() << specialization(fndecl) << ";\n";
+        }
+        // emits all methods definitions
+        output_.stream() << "/* Methods definitions */\n";
+        pass_ = pass::define;
+        for (auto current : units) {
+            workspace_ = current.workspace;
+            for (auto type : current.types) {
+                if (auto typedecl = dynamic_cast<const ast::type_declaration*>(type->declaration())) typedecl->accept(*this);
+                else emit_anonymous_type(type);
+            }
+            for (auto lambda : lambdas(*current.workspace)) emit_lambda_type(lambda);
+        }
+        // global variables definitions
+        output_.stream() << "/* Variable and constants definitions */\n";
+        for (auto current : units) {
+            workspace_ = current.workspace;
+            for (auto valuedecl : current.workspace->globals) valuedecl->accept(*this);
+        }
+        // function definitions
+        output_.stream() << "/* Function definitions */\n";
+        for (auto current : units) {
+            workspace_ = current.workspace;
+            for (auto fndecl : current.functions) fndecl->accept(*this);
+            if (checker_.compilation().test()) for (auto testdecl : current.workspace->tests) testdecl->accept(*this);
+            if (checker_.compilation().bench()) for (auto benchdecl : current.workspace->benchmarks) benchdecl->accept(*this);
+        }
+        output_.stream() << "}\n";
+        // entry point of the program, tests or benchmarks
+        workspace_ = nullptr;
+        if (checker_.compilation().test()) emit_tests();
+        else if (checker_.compilation().bench()) emit_benchmarks();
+        else if (entry) {
+            workspace_ = entry;
+            checker_.entry_point()->accept(*this);
+        }
+        // table of traced functions at the end of the file, once they are all defined
+        output_.stream() << emit_frames();
+
+        return { output_.path(), emit_tables(tables_position) };
     }
     
     std::string code_generator::fullname(const ast::declaration *decl) const
@@ -703,6 +1594,9 @@ namespace nemesis {
                 case ast::kind::test_declaration:
                     levels.push(static_cast<const ast::test_declaration*>(decl)->name().lexeme().string());
                     break;
+                case ast::kind::bench_declaration:
+                    levels.push(static_cast<const ast::bench_declaration*>(decl)->name().lexeme().string());
+                    break;
                 case ast::kind::concept_declaration:
                     levels.push(static_cast<const ast::concept_declaration*>(decl)->name().lexeme().string());
                     break;
@@ -780,7 +1674,7 @@ namespace nemesis {
 
         for (std::size_t i = 0; i < decl->parameters().size(); ++i) {
             if (i > 0) result << ", ";
-            result << emit(decl->parameters().at(i)->annotation().type, std::static_pointer_cast<ast::parameter_declaration>(decl->parameters().at(i))->name().lexeme().string());
+            result << emit_parameter(static_cast<const ast::parameter_declaration*>(decl->parameters().at(i).get()));
         }
 
         result << ")";
@@ -799,7 +1693,7 @@ namespace nemesis {
         if (types::compatible(types::unit(), fntype->result())) result << "void ";
         else result << emit(fntype->result()) << " ";
 
-        result << fullname(decl) << "(" << emit(decl->parameters().front()->annotation().type, std::static_pointer_cast<ast::parameter_declaration>(decl->parameters().front())->name().lexeme().string()) << ")";
+        result << fullname(decl) << "(" << emit_parameter(static_cast<const ast::parameter_declaration*>(decl->parameters().front().get())) << ")";
 
         return result.str();
     }
@@ -859,7 +1753,7 @@ namespace nemesis {
                 // behaviour name
                 auto bname = fullname(&decl);
                 // now emits generic downcast function which will check the dynamic type
-                output_.line() << "template<typename DynType> DynType* __dyncast_" << bname << "(" << bname << "* base, std::size_t dyntype, const char* file, unsigned line, unsigned col);\n";
+                output_.line() << "template<typename DynType> DynType* __dyncast_" << bname << "(" << bname << "* base, std::size_t dyntype, const __location& location);\n";
             }
         }
         else {
@@ -871,7 +1765,7 @@ namespace nemesis {
                     // first argument is object whose real address is computed by using the offset in its virtual table associated to current behaviour
                     output_.stream() << "(" << emit(function->parameters().front()->annotation().type) << ") ((char*) " << self << " - " << self << "->__vptr_" << fullname(&decl) << "->__offset)";
                     for (unsigned i = 1; i < function->parameters().size(); ++i) {
-                        output_.stream() << ", " << std::static_pointer_cast<ast::parameter_declaration>(function->parameters().at(i))->name().lexeme();
+                        output_.stream() << ", " << argument(static_cast<const ast::parameter_declaration*>(function->parameters().at(i).get()));
                     }
                     output_.stream() << "); }\n";
                 }
@@ -881,7 +1775,7 @@ namespace nemesis {
                     // first argument is object whose real address is computed by using the offset in its virtual table associated to current behaviour
                     output_.stream() << "(" << emit(function->parameters().front()->annotation().type) << ") ((char*) " << self << " - " << self << "->__vptr_" << fullname(&decl) << "->__offset)";
                     for (unsigned i = 1; i < function->parameters().size(); ++i) {
-                        output_.stream() << ", " << std::static_pointer_cast<ast::parameter_declaration>(function->parameters().at(i))->name().lexeme();
+                        output_.stream() << ", " << argument(static_cast<const ast::parameter_declaration*>(function->parameters().at(i).get()));
                     }
                     output_.stream() << "); }\n";
                 }
@@ -892,11 +1786,11 @@ namespace nemesis {
                 // behaviour name
                 auto bname = fullname(&decl);
                 // now emits generic downcast function which will check the dynamic type
-                output_.line() << "template<typename DynType> DynType* __dyncast_" << bname << "(" << bname << "* base, std::size_t dyntype, const char* file, unsigned line, unsigned col) {\n";
+                output_.line() << "template<typename DynType> DynType* __dyncast_" << bname << "(" << bname << "* base, std::size_t dyntype, const __location& location) {\n";
                 {
                     struct guard inner(output_);
                     // if dynamic type does not match, then error
-                    output_.line() << "if (dyntype != base->__vptr_" << bname << "->__dyntype) __crash(\"downcast failed because cast type does not match real type of " << bname << ", c*nt.\", file, line, col);\n";
+                    output_.line() << "if (__builtin_expect(dyntype != base->__vptr_" << bname << "->__dyntype, 0)) __crash(\"downcast failed because cast type does not match real type of " << bname << ", c*nt.\", location);\n";
                     // return downcasted type
                     output_.line() << "return (DynType*) ((char*) base - base->__vptr_" << bname << "->__offset);\n";
                 }
@@ -933,7 +1827,7 @@ namespace nemesis {
                     // default constructor
                     output_.line() << emit(decl.annotation().type) << "() = default;\n";
                     // value constructor
-                    output_.line() << emit(decl.annotation().type) << "(" << emit(range_type->base(), "value") << ", const char* file, int line, int column);\n";
+                    output_.line() << emit(decl.annotation().type) << "(" << emit(range_type->base(), "value") << ", const __location& location);\n";
                 }
                 output_.line() << "};\n";
             }
@@ -959,7 +1853,7 @@ namespace nemesis {
                     auto bname = fullname(behaviour->declaration());
                     output_.line() << "static __vtable_" << bname << " __vtable_" << fullname(behaviour->declaration()) << "_for_" << emit(decl.annotation().type) << " = { ";
                     // set dynamic type of this vptr inside structure
-                    output_.stream() << std::hash<std::string>()(decl.annotation().type->string()) << "ull, ";
+                    output_.stream() << decl.annotation().type->hash() << "ull, ";
                     // set offset of this vptr inside structure
                     output_.stream() << "offsetof(" << emit(decl.annotation().type) << ", __vptr_" << bname << ")";
                     // fill vtable with function pointers
@@ -976,7 +1870,7 @@ namespace nemesis {
             {
                 struct guard inner(output_);
                 unsigned ifield = 0;
-                output_.line() << emit(decl.annotation().type) << "::" << emit(decl.annotation().type) << "(" << emit(range_type->base(), "value") << ", const char* file, int line, int column) : ";
+                output_.line() << emit(decl.annotation().type) << "::" << emit(decl.annotation().type) << "(" << emit(range_type->base(), "value") << ", const __location& location) : ";
                 ifield = 0;
                 // initialize vpointers
                 if (types::implementors().count(decl.annotation().type)) {
@@ -996,14 +1890,14 @@ namespace nemesis {
                 {
                     struct guard inner(output_);
                     auto range = std::dynamic_pointer_cast<ast::range_expression>(decl.constraint());
-                    output_.line() << "__assert(";
+                    output_.line() << "if (__builtin_expect(!(";
                     if (range->start()) output_.stream() << "value >= " << emit(range->start()->annotation().value);
                     if (range->end()) {
                         if (range->start()) output_.stream() << " && ";
                         if (range->is_inclusive()) output_.stream() << "value <= " << emit(range->end()->annotation().value);
                         else output_.stream() << "value < " << emit(range->end()->annotation().value);
                     }
-                    output_.stream() << ", __format(\"range value ? is out of bounds for type " << decl.annotation().type->string() << "!\", value), file, line, column);\n";
+                    output_.stream() << "), 0)) __fail(&location, \"range value ? is out of bounds for type " << decl.annotation().type->string() << "!\", value);\n";
                 }
                 output_.line() << "#endif\n";
                 output_.line() << "}\n";
@@ -1041,6 +1935,8 @@ namespace nemesis {
                     output_.line() << emit(decl.annotation().type) << "(";
                     for (auto field : decl.fields()) {
                         if (ifield > 0) output_.stream() << ", "; 
+                        // array fields are copied, so they may be initialized from read-only tables
+                        if (field->annotation().type->category() == ast::type::category::array_type) output_.stream() << "const ";
                         output_.stream() << emit(field->annotation().type, fullname(field.get()));
                         ++ifield;
                     }
@@ -1072,7 +1968,7 @@ namespace nemesis {
                     auto bname = fullname(behaviour->declaration());
                     output_.line() << "static __vtable_" << bname << " __vtable_" << fullname(behaviour->declaration()) << "_for_" << emit(decl.annotation().type) << " = { ";
                     // set dynamic type of this vptr inside structure
-                    output_.stream() << std::hash<std::string>()(decl.annotation().type->string()) << "ull, ";
+                    output_.stream() << decl.annotation().type->hash() << "ull, ";
                     // set offset of this vptr inside structure
                     output_.stream() << "offsetof(" << emit(decl.annotation().type) << ", __vptr_" << bname << ")";
                     // fill vtable with function pointers
@@ -1092,6 +1988,7 @@ namespace nemesis {
                 output_.line() << emit(decl.annotation().type) << "::" << emit(decl.annotation().type) << "(";
                 for (auto field : decl.fields()) {
                     if (ifield > 0) output_.stream() << ", "; 
+                    if (field->annotation().type->category() == ast::type::category::array_type) output_.stream() << "const ";
                     output_.stream() << emit(field->annotation().type, fullname(field.get()));
                     ++ifield;
                 }
@@ -1151,7 +2048,11 @@ namespace nemesis {
 
                 output_.line() << prototype(&decl) << " {\n";
 
-                {
+                if (niche(decl.annotation().type)) {
+                    struct guard inner(output_);
+                    emit_niche_members(decl.annotation().type);
+                }
+                else {
                     struct guard inner(output_);
                     // first emits vpointers if any
                     if (types::implementors().count(decl.annotation().type)) {
@@ -1160,8 +2061,8 @@ namespace nemesis {
                             output_.line() << "__vtable_" << bname << "* __vptr_" << bname << ";\n";
                         }
                     }
-                    // tag field is used to identify current type
-                    output_.line() << "std::size_t __tag;\n";
+                    // tag field is used to identify current type by its ordinal
+                    output_.line() << impl::tag_type(std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->types().size()) << " __tag;\n";
                     // for each subtype there exists a field whose name is the hash of type name inside an anonymous union (no duplicate types!!)
                     output_.line() << "union {\n";
                     
@@ -1169,7 +2070,7 @@ namespace nemesis {
                         struct guard inner(output_);
                         // each field name is the hash of its type (unique within a variant)
                         for (auto type : std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->types()) {
-                            output_.line() << emit(type, "_" + std::to_string(std::hash<std::string>()(type->string()))) << ";\n";
+                            output_.line() << emit(type, "_" + std::to_string(type->hash())) << ";\n";
                         }
                     }
                     
@@ -1178,12 +2079,15 @@ namespace nemesis {
                     // definitions of routine functions for non-trivial members of the union
                     // constructor
                     output_.line() << emit(decl.annotation().type) << "();\n";
-                    // copy constructor
-                    output_.line() << emit(decl.annotation().type) << "(const " << emit(decl.annotation().type) << "& other);\n";
-                    // copy assignment
-                    output_.line() << "void operator=(const " << emit(decl.annotation().type) << "& other);\n";
-                    // destructor
-                    output_.line() << "~" << emit(decl.annotation().type) << "();\n";
+                    // a variant of trivially copyable types is copied bitwise, so no routine is defined
+                    if (!trivial(decl.annotation().type)) {
+                        // copy constructor
+                        output_.line() << emit(decl.annotation().type) << "(const " << emit(decl.annotation().type) << "& other);\n";
+                        // copy assignment
+                        output_.line() << "void operator=(const " << emit(decl.annotation().type) << "& other);\n";
+                        // destructor
+                        output_.line() << "~" << emit(decl.annotation().type) << "();\n";
+                    }
                 }
 
                 output_.line() << "};\n";
@@ -1192,11 +2096,11 @@ namespace nemesis {
             // emit designated initializers' prototypes for each variant type
             for (auto type : std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->types()) {
                 struct guard inner(output_);
-                auto hash = std::to_string(std::hash<std::string>()(type->string()));
+                auto hash = std::to_string(type->hash());
                 // emits constructor for each of its types
                 output_.line() << emit(decl.annotation().type) << " " << emit(decl.annotation().type) << "_init_" << hash << "(" << emit(type, "init") << ");\n";
                 // then emits explicit conversions to each of its types
-                output_.line() << emit(type) << " " << emit(decl.annotation().type) << "_as_" << hash << "(" << emit(decl.annotation().type, "self") << ", const char* file, int line, int column);\n";
+                output_.line() << emit(type) << " " << emit(decl.annotation().type) << "_as_" << hash << "(" << emit(decl.annotation().type, "self") << ", const __location& location);\n";
             }
 
             if (checker_.scopes().count(&decl)) {
@@ -1206,36 +2110,46 @@ namespace nemesis {
                 }
             }
         }
+        else if (niche(decl.annotation().type)) {
+            if (checker_.scopes().count(&decl)) {
+                for (auto constant : checker_.scopes().at(&decl)->values()) constant.second->accept(*this);
+                for (auto function : checker_.scopes().at(&decl)->functions()) function.second->accept(*this);
+            }
+            
+            emit_niche_helpers(decl.annotation().type);
+        }
         else {
-            // copy constructor
-            output_.line() << emit(decl.annotation().type) << "::" << emit(decl.annotation().type) << "(const " << emit(decl.annotation().type) << "& other) : __tag(other.__tag) {\n";
-            {
-                struct guard inner(output_);
-                output_.line() << "switch (other.__tag) {\n";
-                for (auto subtype : std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->types()) {
-                    auto hash = std::to_string(std::hash<std::string>()(subtype->string()));
-                    output_.line() << "case " << hash << "ull: new(&_" << hash << ") " << emit(subtype) << "(other._" << hash << "); break;\n"; 
+            if (!trivial(decl.annotation().type)) {
+                // copy constructor
+                output_.line() << emit(decl.annotation().type) << "::" << emit(decl.annotation().type) << "(const " << emit(decl.annotation().type) << "& other) : __tag(other.__tag) {\n";
+                {
+                    struct guard inner(output_);
+                    output_.line() << "switch (other.__tag) {\n";
+                    for (auto subtype : std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->types()) {
+                        auto hash = std::to_string(subtype->hash());
+                        output_.line() << "case " << std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->tag(subtype) << ": new(&_" << hash << ") " << emit(subtype) << "(other._" << hash << "); break;\n";
+                    }
+                    output_.line() << "default: break;\n";
+                    output_.line() << "}\n";
                 }
-                output_.line() << "default: break;\n";
                 output_.line() << "}\n";
-            }
-            output_.line() << "}\n";
-            // copy assignment
-            output_.line() << "void " << emit(decl.annotation().type) << "::operator=(const " << emit(decl.annotation().type) << "& other) {\n";
-            {
-                struct guard inner(output_);
-                output_.line() << "__tag = other.__tag;\n";
-                output_.line() << "switch (other.__tag) {\n";
-                for (auto subtype : std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->types()) {
-                    auto hash = std::to_string(std::hash<std::string>()(subtype->string()));
-                    output_.line() << "case " << hash << "ull: new(&_" << hash << ") " << emit(subtype) << "(other._" << hash << "); break;\n";
+                // copy assignment
+                output_.line() << "void " << emit(decl.annotation().type) << "::operator=(const " << emit(decl.annotation().type) << "& other) {\n";
+                {
+                    struct guard inner(output_);
+                    output_.line() << "__tag = other.__tag;\n";
+                    output_.line() << "switch (other.__tag) {\n";
+                    for (auto subtype : std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->types()) {
+                        auto hash = std::to_string(subtype->hash());
+                        output_.line() << "case " << std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->tag(subtype) << ": new(&_" << hash << ") " << emit(subtype) << "(other._" << hash << "); break;\n";
+                    }
+                    output_.line() << "default: break;\n";
+                    output_.line() << "}\n";
                 }
-                output_.line() << "default: break;\n";
                 output_.line() << "}\n";
+                // destructor
+                output_.line() << emit(decl.annotation().type) << "::~" << emit(decl.annotation().type) << "() {}\n";
             }
-            output_.line() << "}\n";
-            // destructor
-            output_.line() << emit(decl.annotation().type) << "::~" << emit(decl.annotation().type) << "() {}\n";
 
             if (checker_.scopes().count(&decl)) {
                 for (auto constant : checker_.scopes().at(&decl)->values()) constant.second->accept(*this);
@@ -1250,7 +2164,7 @@ namespace nemesis {
                     auto bname = fullname(behaviour->declaration());
                     output_.line() << "static __vtable_" << bname << " __vtable_" << fullname(behaviour->declaration()) << "_for_" << emit(decl.annotation().type) << " = { ";
                     // set dynamic type of this vptr inside structure
-                    output_.stream() << std::hash<std::string>()(decl.annotation().type->string()) << "ull, ";
+                    output_.stream() << decl.annotation().type->hash() << "ull, ";
                     // set offset of this vptr inside structure
                     output_.stream() << "offsetof(" << emit(decl.annotation().type) << ", __vptr_" << bname << ")";
                     // fill vtable with function pointers
@@ -1281,7 +2195,7 @@ namespace nemesis {
             // create designated initializers for each variant type
             for (auto type : std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->types()) {
                 struct guard inner(output_);
-                auto hash = std::to_string(std::hash<std::string>()(type->string()));
+                auto hash = std::to_string(type->hash());
                 
                 // emits constructor for each of its types
                 output_.line() << emit(decl.annotation().type) << " " << emit(decl.annotation().type) << "_init_" << hash << "(" << emit(type, "init") << ") {\n";
@@ -1289,7 +2203,7 @@ namespace nemesis {
                 {
                     struct guard inner(output_);
                     output_.line() << emit(decl.annotation().type, "result") << ";\n";
-                    output_.line() << "result.__tag = " << hash << "ull;\n";
+                    output_.line() << "result.__tag = " << std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->tag(type) << ";\n";
                     output_.line() << "new(&result._" << hash << ") " << emit(type) << "(init);\n";
                     output_.line() << "return result;\n";
                 }
@@ -1297,11 +2211,11 @@ namespace nemesis {
                 output_.line() << "}\n";
 
                 // then emits explicit conversions to each of its types
-                output_.line() << emit(type) << " " << emit(decl.annotation().type) << "_as_" << hash << "(" << emit(decl.annotation().type, "self") << ", const char* file, int line, int column) {\n";
+                output_.line() << emit(type) << " " << emit(decl.annotation().type) << "_as_" << hash << "(" << emit(decl.annotation().type, "self") << ", const __location& location) {\n";
                 
                 {
                     struct guard inner(output_);
-                    output_.line() << "if (self.__tag != " << hash << "ull) __crash(\"damn, you cannot explictly convert variant since it has a different run-time type!\", file, line, column);\n";
+                    output_.line() << "if (__builtin_expect(self.__tag != " << std::static_pointer_cast<ast::variant_type>(decl.annotation().type)->tag(type) << ", 0)) __crash(\"damn, you cannot explictly convert variant since it has a different run-time type!\", location);\n";
                     output_.line() << "return self._" << hash << "; \n";
                 }
 
@@ -1323,9 +2237,21 @@ namespace nemesis {
 
     void code_generator::visit(const ast::var_declaration& decl)
     {
-        output_.stream() << "#if __DEVELOPMENT__\n";
-        if (decl.annotation().scope->kind() != ast::kind::workspace) output_.line() << "__record.location(" << decl.range().bline << ", " << decl.range().bcolumn << ");\n";
-        output_.stream() << "#endif\n";
+
+        // closure which is only called through a local variable lives inside the same block instead of heap memory
+        if (auto lambda = std::dynamic_pointer_cast<ast::function_expression>(decl.value())) {
+            if (!lambda->captured().empty() && checker_.invoked_only(&decl)) {
+                unsigned index = 0;
+                output_.line() << closure(lambda.get()) << " __closure_" << fullname(&decl) << "(";
+                for (auto captured : lambda->captured()) {
+                    if (index++ > 0) output_.stream() << ", ";
+                    output_.stream() << captured->name().lexeme();
+                }
+                output_.stream() << ");\n";
+                output_.line() << emit(decl.annotation().type, fullname(&decl)) << " = __closure_" << fullname(&decl) << ".__ref();\n";
+                return;
+            }
+        }
 
         output_.line() << emit(decl.annotation().type, fullname(&decl));
 
@@ -1345,7 +2271,9 @@ namespace nemesis {
                     break;
                 default:
                     output_.stream() << " = "; 
-                    decl.value()->accept(*this);
+                    // a constant array initializes a variable by its literal, without any table
+                    if (decl.value()->annotation().value.type && decl.value()->annotation().value.type->category() == ast::type::category::array_type) output_.stream() << emit(decl.value()->annotation().value);
+                    else emit_consumed(*decl.value());
                     output_.stream() << ";\n";
             }
         }
@@ -1367,27 +2295,31 @@ namespace nemesis {
 
     void code_generator::visit(const ast::parameter_declaration& decl)
     {
-        output_.stream() << emit(decl.annotation().type, decl.name().lexeme().string());
+        output_.stream() << emit_parameter(&decl);
     }
 
     void code_generator::visit(const ast::function_declaration& decl)
     {
         // exit if function is generic (so it must not be generated) or if it's main entry point and test mode is set
-        if (decl.generic() || (&decl == checker_.entry_point() && checker_.compilation().test())) return;
+        if (decl.generic() || (&decl == checker_.entry_point() && (checker_.compilation().test() || checker_.compilation().bench()))) return;
 
         guard guard(output_);
         auto fntype = std::static_pointer_cast<ast::function_type>(decl.annotation().type);
+        // body of a function taking closures is a template on their types, which the function itself forwards to
+        bool specialized = this->specialized(&decl);
 
-        output_.line() << prototype(&decl);
+        output_.line() << (specialized ? specialization(&decl) : prototype(&decl));
 
         if (decl.body()) {
             output_.stream() << " {\n";
+            // temporaries are numbered from zero inside each function
+            temporaries_ = 0;
             {
                 struct guard inner(output_);
-                // stack activation record for stacktrace
-                output_.stream() << "#if __DEVELOPMENT__\n";
-                output_.line() << "__stack_activation_record __record(\"" << decl.name().location().filename << "\", \"" << _encode_name(decl.name().lexeme().string()) << "\", " << decl.name().location().line << ", " << decl.name().location().column << ");\n";
-                output_.stream() << "#endif\n";
+                // function is listed in the table of traced functions
+                frame(fullname(&decl), decl.name().lexeme().string(), decl.name().location());
+                // copies of mutable parameters
+                emit_mutable_parameters(decl.parameters());
                 // contracts
                 emit_in_contracts(decl);
             }
@@ -1444,8 +2376,15 @@ namespace nemesis {
             }
 
             output_.line() << "}\n";
+            site_ = false;
         }
         else output_.stream() << ";\n";
+
+        if (specialized) {
+            output_.line() << prototype(&decl) << " { return __specialized" << fullname(&decl) << "(";
+            for (std::size_t i = 0; i < decl.parameters().size(); ++i) output_.stream() << (i > 0 ? ", " : "") << argument(static_cast<const ast::parameter_declaration*>(decl.parameters().at(i).get()));
+            output_.stream() << "); }\n";
+        }
     }
 
     void code_generator::visit(const ast::property_declaration& decl)
@@ -1457,12 +2396,14 @@ namespace nemesis {
 
         if (decl.body()) {
             output_.stream() << " {\n";
+            // temporaries are numbered from zero inside each function
+            temporaries_ = 0;
             {
                 struct guard inner(output_);
-                // stack activation record for stacktrace
-                output_.stream() << "#if __DEVELOPMENT__\n";
-                output_.line() << "__stack_activation_record __record(\"" << decl.name().location().filename << "\", \"" << _encode_name(decl.name().lexeme().string()) << "\", " << decl.name().location().line << ", " << decl.name().location().column << ");\n";
-                output_.stream() << "#endif\n";
+                // function is listed in the table of traced functions
+                frame(fullname(&decl), decl.name().lexeme().string(), decl.name().location());
+                // copies of mutable parameters
+                emit_mutable_parameters(decl.parameters());
                 // contracts
                 emit_in_contracts(decl);
             }
@@ -1503,37 +2444,61 @@ namespace nemesis {
             }
 
             output_.line() << "}\n";
+            site_ = false;
         }
         else output_.stream() << ";\n";
     }
 
     std::string code_generator::prototype(const ast::test_declaration* decl) const { return "int " + fullname(decl) + "()"; }
 
+    std::string code_generator::prototype(const ast::bench_declaration* decl) const { return "void " + fullname(decl) + "(std::uint64_t __iterations)"; }
+
     void code_generator::visit(const ast::test_declaration& decl)
     {
         output_.line() << prototype(&decl) << " try {\n";
         {
             struct guard inner(output_);
-            // stack activation record for stacktrace
-            output_.stream() << "#if __DEVELOPMENT__\n";
-            output_.line() << "__stack_activation_record __record(\"" << decl.range().filename << "\", \"" << _encode_name(decl.name().lexeme().string()) << "\", " << decl.range().bline << ", " << decl.range().bcolumn << ");\n";
-            output_.stream() << "#endif\n";
-            auto start = "_t" + std::to_string(std::rand()), end = "_t" + std::to_string(std::rand());
+            // test is listed in the table of traced functions
+            frame(fullname(&decl), decl.name().lexeme().string(), source_location(decl.range().bline, decl.range().bcolumn, decl.range().filename));
+            temporaries_ = 0;
+            auto start = temporary("_t"), end = temporary("_t");
             output_.line() << "std::printf(\"• running test '" << decl.name().lexeme() << "'...\\n\");\n";
             output_.line() << "std::chrono::steady_clock::time_point " << start << " = std::chrono::steady_clock::now();\n";
             decl.body()->accept(*this);
             output_.stream() << "std::chrono::steady_clock::time_point " << end << " = std::chrono::steady_clock::now();\n";
             output_.line() << "std::printf(\"• success for '" << decl.name().lexeme() << "', pal! It took %lu µs\\n\", std::chrono::duration_cast<std::chrono::microseconds>(" << end << " - " << start << ").count());\n";
             output_.line() << "return 1;\n";
+            site_ = false;
         }
         output_.line() << "}\n";
         output_.line() << "catch (...) { std::printf(\"• failure for '" << decl.name().lexeme() << "', f*ck...\\n\"); return 0; }\n";
     }
 
+    void code_generator::visit(const ast::bench_declaration& decl)
+    {
+        output_.line() << prototype(&decl) << " {\n";
+        {
+            struct guard inner(output_);
+            // benchmark is listed in the table of traced functions
+            frame(fullname(&decl), decl.name().lexeme().string(), source_location(decl.range().bline, decl.range().bcolumn, decl.range().filename));
+            temporaries_ = 0;
+            // body is repeated as many times as the harness asks, so that each measure spans many iterations
+            output_.line() << "for (std::uint64_t __iteration = 0; __iteration < __iterations; ++__iteration) {\n";
+            // value of body is discarded instead of being assigned to the result of an enclosing function
+            std::stack<std::string> saved;
+            std::swap(saved, result_vars);
+            decl.body()->accept(*this);
+            std::swap(saved, result_vars);
+            output_.line() << "}\n";
+            site_ = false;
+        }
+        output_.line() << "}\n";
+    }
+
     bool code_generator::emit_if_constant(const ast::expression& expr)
     {
         if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type) {
-            output_.stream() << emit(expr.annotation().value);
+            emit_constant(expr.annotation().value);
             return true;
         }
 
@@ -1556,11 +2521,20 @@ namespace nemesis {
     
     void code_generator::visit(const ast::variant_type_expression& expr) { output_.stream() << emit(expr.annotation().type); }
 
-    void code_generator::visit(const ast::literal_expression& expr) { output_.stream() << emit(expr.annotation().value); }
+    void code_generator::visit(const ast::literal_expression& expr) { emit_constant(expr.annotation().value); }
 
     void code_generator::visit(const ast::unary_expression& expr)
     {
         if (emit_if_constant(expr)) return;
+        // immutable parameters passed by constant reference are pointed by pointers to immutable, which are not const in C++
+        if (auto parameter = dynamic_cast<const ast::parameter_declaration*>(expr.expression()->lvalue())) {
+            if (expr.unary_operator().kind() == token::kind::amp && !parameter->is_mutable() && by_reference(parameter->annotation().type)) {
+                output_.stream() << "const_cast<" << emit(expr.annotation().type) << ">(&";
+                expr.expression()->accept(*this);
+                output_.stream() << ")";
+                return;
+            }
+        }
 
         output_.stream() << "(";
 
@@ -1674,9 +2648,9 @@ namespace nemesis {
                 if (auto variant = std::dynamic_pointer_cast<ast::variant_type>(original)) {
                     if (!variant->contains(result)) throw std::invalid_argument("code_generator::visit(const ast::implicit_conversion_expression&): invalid variant conversion");
                     // explicit conversion call
-                    output_.stream() << emit(original) << "_as_" << std::hash<std::string>()(result->string()) << "(";
+                    output_.stream() << emit(original) << "_as_" << result->hash() << "(";
                     expr.left()->accept(*this);
-                    output_.stream() << ", \"" << expr.binary_operator().location().filename << "\", " << expr.binary_operator().location().line << ", " << expr.binary_operator().location().column << ")";
+                    output_.stream() << ", " << location(expr.binary_operator().location()) << ")";
                 }
                 // explicit upcasting
                 else if (result->category() == ast::type::category::pointer_type && std::static_pointer_cast<ast::pointer_type>(result)->base()->category() == ast::type::category::behaviour_type && original->category() == ast::type::category::pointer_type) {
@@ -1695,7 +2669,7 @@ namespace nemesis {
                     if (behaviour->implementor(implementor)) {
                         output_.stream() << "__dyncast_" << emit(behaviour) << "<" << emit(implementor) << ">(";
                         expr.left()->accept(*this);
-                        output_.stream() << ", " << std::hash<std::string>()(implementor->string()) << "ull, \"" << expr.binary_operator().location().filename << "\", " << expr.binary_operator().location().line << ", " << expr.binary_operator().location().column << ")";
+                        output_.stream() << ", " << implementor->hash() << "ull, " << location(expr.binary_operator().location()) << ")";
                     }
                 }
                 // range type to value
@@ -1708,7 +2682,7 @@ namespace nemesis {
                 else if (original->category() != ast::type::category::range_type && result->category() == ast::type::category::range_type) {
                     output_.stream() << emit(result) << "(";
                     expr.left()->accept(*this);
-                    output_.stream() << ", \"" << expr.range().filename << "\", " << expr.range().bline << ", " << expr.range().bcolumn << ")";
+                    output_.stream() << ", " << location(expr.range()) << ")";
                 }
                 // slice of bytes from string
                 else if ((original->category() == ast::type::category::chars_type || original->category() == ast::type::category::string_type) && types::compatible(types::slice(types::uint(8)), result)) {
@@ -1735,7 +2709,7 @@ namespace nemesis {
                         break;
                     case ast::type::category::variant_type:
                         // designated intializer for variant type
-                        output_.stream() << emit(result) << "_init_" << std::hash<std::string>()(original->string()) << "(";
+                        output_.stream() << emit(result) << "_init_" << original->hash() << "(";
                         expr.left()->accept(*this);
                         output_.stream() << ")";
                         break;
@@ -1829,7 +2803,7 @@ namespace nemesis {
         if (expr.annotation().referencing) {
             // emit constant
             if ((expr.annotation().referencing->kind() == ast::kind::const_declaration || expr.annotation().referencing->kind() == ast::kind::generic_const_parameter_declaration) && expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type) {
-                output_.stream() << emit(expr.annotation().value);
+                emit_constant(expr.annotation().value);
             }
             else if (auto cp = dynamic_cast<const ast::concept_declaration*>(expr.annotation().referencing)) {
                 if (expr.annotation().isconcept && expr.annotation().value.type->category() == ast::type::category::bool_type) output_.stream() << emit(expr.annotation().value);
@@ -1846,8 +2820,11 @@ namespace nemesis {
                 else if (non_generic_name == "core.deallocate") output_.stream() << "__deallocate";
                 else if (non_generic_name == "core.free") output_.stream() << "__free";
                 else if (non_generic_name == "core.sizeof") output_.stream() << "__sizeof<" << emit(expr.generics().front()->annotation().type) << ">";
+                else if (non_generic_name == "core.black_box") output_.stream() << "__black_box";
                 else output_.stream() << fullname(expr.annotation().referencing);
             }
+            // local variable at its last use is moved
+            else if (&expr == moved_) output_.stream() << "std::move(" << fullname(expr.annotation().referencing) << ")";
             else output_.stream() << fullname(expr.annotation().referencing);
         }
         else output_.stream() << expr.identifier().lexeme();
@@ -1861,7 +2838,7 @@ namespace nemesis {
         
         for (unsigned i = 0; i < expr.elements().size(); ++i) {
             if (i > 0) output_.stream() << ", ";
-            expr.elements().at(i)->accept(*this);
+            emit_consumed(*expr.elements().at(i));
         }
 
         output_.stream() << ")";
@@ -1932,8 +2909,18 @@ namespace nemesis {
         if (emit_if_constant(expr)) return;
 
         if (!expr.expression()->annotation().istype) {
+            // behaviour method whose implementation is statically known is called directly instead of through virtual table
+            if (auto target = devirtualized(expr)) {
+                output_.stream() << fullname(target);
+                // property is called at once
+                if (target->kind() == ast::kind::property_declaration) {
+                    output_.stream() << "(";
+                    emit_devirtualized_object(expr);
+                    output_.stream() << ")";
+                }
+            }
             // method (function) access
-            if (dynamic_cast<const ast::function_declaration*>(expr.member()->annotation().referencing)) expr.member()->accept(*this);
+            else if (dynamic_cast<const ast::function_declaration*>(expr.member()->annotation().referencing)) expr.member()->accept(*this);
             // method (property) call because it is a computed property
             else if (dynamic_cast<const ast::property_declaration*>(expr.member()->annotation().referencing)) {
                 expr.member()->accept(*this);
@@ -1952,6 +2939,10 @@ namespace nemesis {
                         if (expr.expression()->annotation().type->category() == ast::type::category::pointer_type) output_.stream() << "->";
                         else output_.stream() << ".";
                         expr.member()->accept(*this);
+                        // tag of niche variant is computed from its payload
+                        if (auto member = std::dynamic_pointer_cast<ast::identifier_expression>(expr.member())) {
+                            if (member->identifier().lexeme().string() == "__tag" && niche(expr.expression()->annotation().type)) output_.stream() << "()";
+                        }
                         break;
                     default:
                         output_.stream() << "__get_";
@@ -1976,6 +2967,17 @@ namespace nemesis {
     void code_generator::visit(const ast::call_expression& expr)
     {
         if (emit_if_constant(expr)) return;
+        // assert() is a test on the hot path, while its message is only built on the cold path when the test fails
+        if (expr.callee()->annotation().referencing && expr.arguments().size() == 2 && fullname(expr.callee()->annotation().referencing) == "__assert") {
+            output_.stream() << "(__builtin_expect(!(";
+            expr.arguments().front()->accept(*this);
+            output_.stream() << "), 0) ? __violation(";
+            emit_consumed(*expr.arguments().back());
+            output_.stream() << ", " << location(expr.range()) << ") : (void) 0)";
+            return;
+        }
+        // closures passed to a function are called directly by its specialization on their types
+        if (emit_specialized_call(expr)) return;
 
         expr.callee()->accept(*this);
 
@@ -1988,7 +2990,7 @@ namespace nemesis {
 
                 for (unsigned i = 0; i < expr.arguments().size(); ++i) {
                     if (i > 0) output_.stream() << ", ";
-                    expr.arguments().at(i)->accept(*this);
+                    emit_consumed(*expr.arguments().at(i));
                 }
 
                 output_.stream() << "}";
@@ -1998,7 +3000,7 @@ namespace nemesis {
 
                 for (unsigned i = 0; i < expr.arguments().size(); ++i) {
                     if (i > 0) output_.stream() << ", ";
-                    expr.arguments().at(i)->accept(*this);
+                    emit_consumed(*expr.arguments().at(i));
                 }
 
                 output_.stream() << "}";
@@ -2007,20 +3009,21 @@ namespace nemesis {
         // function or method call
         else {
             auto fntype = std::dynamic_pointer_cast<ast::function_type>(expr.callee()->annotation().type);
+            // builtin functions implemented in C++ never write arguments through other names
+            auto function = dynamic_cast<const ast::function_declaration*>(expr.callee()->annotation().referencing);
+            bool intrinsic = function && checker_.intrinsic(function);
             // ordinary function call
             if (fntype->formals().size() == expr.arguments().size()) {
                 output_.stream() << "(";
 
                 for (unsigned i = 0; i < expr.arguments().size(); ++i) {
                     if (i > 0) output_.stream() << ", ";
-                    expr.arguments().at(i)->accept(*this);
+                    if (intrinsic) emit_consumed(*expr.arguments().at(i));
+                    else emit_argument(*expr.arguments().at(i), fntype->formals().at(i));
                 }
                 
-                // with crash() or assert() call we implicitly pass file and line info to print the error
-                if (expr.callee()->annotation().referencing) {
-                    std::string full_name = fullname(expr.callee()->annotation().referencing);
-                    if (full_name == "__crash" || full_name == "__assert") output_.stream() << ", \"" << expr.range().filename.string() << "\", " << expr.range().bline << ", " << expr.range().bcolumn;
-                }
+                // with crash() call we implicitly pass the location of the call to print the error
+                if (expr.callee()->annotation().referencing && fullname(expr.callee()->annotation().referencing) == "__crash") output_.stream() << ", " << location(expr.range());
 
                 output_.stream() << ")";
             }
@@ -2029,11 +3032,13 @@ namespace nemesis {
                 if (fntype->formals().size() == expr.arguments().size() + 1) {
                     output_.stream() << "(";
                     // object is passed as first parameter
-                    member_expr->expression()->accept(*this);
+                    if (devirtualized(*member_expr)) emit_devirtualized_object(*member_expr);
+                    else emit_consumed(*member_expr->expression());
 
-                    for (auto arg : expr.arguments()) {
+                    for (unsigned i = 0; i < expr.arguments().size(); ++i) {
                         output_.stream() << ", ";
-                        arg->accept(*this);
+                        if (intrinsic) emit_consumed(*expr.arguments().at(i));
+                        else emit_argument(*expr.arguments().at(i), fntype->formals().at(i + 1));
                     }
                     
                     output_.stream() << ")";
@@ -2072,6 +3077,14 @@ namespace nemesis {
                     else output_.stream() << array_type->size() << "ull";
                     output_.stream() << ")";
                 }
+                // index is proven to be inside bounds
+                else if (checker_.safe_index(expr)) {
+                    output_.stream() << "(";
+                    expr.expression()->accept(*this);
+                    output_.stream() << ")[";
+                    expr.index()->accept(*this);
+                    output_.stream() << "]";
+                }
                 else {
                     output_.stream() << "__array_at<" << array_type->size() << "ull>(";
                     expr.expression()->accept(*this);
@@ -2097,6 +3110,13 @@ namespace nemesis {
                     }
                     output_.stream() << ")";
                 }
+                // index is proven to be inside bounds, so slice is accessed through its data without any check
+                else if (checker_.safe_index(expr)) {
+                    expr.expression()->accept(*this);
+                    output_.stream() << ".data()[";
+                    expr.index()->accept(*this);
+                    output_.stream() << "]";
+                }
                 else {
                     expr.expression()->accept(*this);
                     output_.stream() << "[";
@@ -2138,7 +3158,7 @@ namespace nemesis {
 
             for (unsigned i = 0; i < expr.initializers().size(); ++i) {
                 if (i > 0) output_.stream() << ", ";
-                expr.initializers().at(i).value()->accept(*this);
+                emit_consumed(*expr.initializers().at(i).value());
             }
 
             output_.stream() << "}";
@@ -2152,7 +3172,7 @@ namespace nemesis {
             for (auto field : structure->fields()) {
                 auto it = std::find_if(expr.initializers().begin(), expr.initializers().end(), [&] (ast::record_expression::initializer init) { return field.name == init.field().lexeme().string(); });
                 if (count++ > 0) output_.stream() << ", ";
-                it->value()->accept(*this);
+                emit_consumed(*it->value());
             }
 
             output_.stream() << "}";
@@ -2189,7 +3209,7 @@ namespace nemesis {
         if (auto variant = std::dynamic_pointer_cast<ast::variant_type>(original)) {
             if (!variant->contains(result)) throw std::invalid_argument("code_generator::visit(const ast::implicit_conversion_expression&): invalid variant conversion");
             expr.expression()->accept(*this);
-            output_.stream() << "._" << std::hash<std::string>()(result->string());
+            output_.stream() << "._" << result->hash();
         }
         // implicit upcasting
         else if (result->category() == ast::type::category::pointer_type && std::static_pointer_cast<ast::pointer_type>(result)->base()->category() == ast::type::category::behaviour_type && original->category() == ast::type::category::pointer_type) {
@@ -2208,7 +3228,7 @@ namespace nemesis {
             if (behaviour->implementor(implementor)) {
                output_.stream() << "__dyncast_" << emit(behaviour) << "<" << emit(implementor) << ">(";
                expr.expression()->accept(*this);
-               output_.stream() << ", " << std::hash<std::string>()(implementor->string()) << "ull, \"" << expr.range().filename << "\", " << expr.range().bline << ", " << expr.range().bcolumn << ")";
+               output_.stream() << ", " << implementor->hash() << "ull, " << location(expr.range()) << ")";
             }
         }
         // range type to value
@@ -2221,7 +3241,7 @@ namespace nemesis {
         else if (original->category() != ast::type::category::range_type && result->category() == ast::type::category::range_type) {
             output_.stream() << emit(result) << "(";
             expr.expression()->accept(*this);
-            output_.stream() << ", \"" << expr.range().filename << "\", " << expr.range().bline << ", " << expr.range().bcolumn << ")";
+            output_.stream() << ", " << location(expr.range()) << ")";
         }
         else switch (result->category()) {
             case ast::type::category::chars_type:
@@ -2247,7 +3267,7 @@ namespace nemesis {
                 break;
             case ast::type::category::variant_type:
                 // designated intializer for variant type
-                output_.stream() << emit(result) << "_init_" << std::hash<std::string>()(original->string()) << "(";
+                output_.stream() << emit(result) << "_init_" << original->hash() << "(";
                 expr.expression()->accept(*this);
                 output_.stream() << ")";
                 break;
@@ -2292,6 +3312,8 @@ namespace nemesis {
         for (auto stmt : expr.statements()) {
             // all nested type declaration are declared in global scope
             if (dynamic_cast<ast::type_declaration*>(stmt.get())) continue;
+            // location of statement is kept for stack traces
+            emit_site(stmt->range());
             // if expr node is set, then we declare it as variable '__result'
             if (stmt.get() == expr.exprnode() && stmt->kind() == ast::kind::expression_statement) {
                 auto value = static_cast<const ast::expression_statement*>(stmt.get())->expression();
@@ -2307,9 +3329,6 @@ namespace nemesis {
                     default:
                         // save results only if its type is not (), which is 'void' in C/C++
                         if (!result_vars.empty() && !types::compatible(types::unit(), value->annotation().type)) {
-                            output_.stream() << "#if __DEVELOPMENT__\n";
-                            output_.line() << "__record.location(" << stmt->range().bline << ", " << stmt->range().bcolumn << ");\n";
-                            output_.stream() << "#endif\n";
                             output_.line() << result_vars.top() << " = ";
                             value->accept(*this);
                             output_.stream() << ";\n";
@@ -2370,106 +3389,127 @@ namespace nemesis {
 
         // implicit iterator
         if (auto iterating_procedure = dynamic_cast<const ast::function_declaration*>(expr.annotation().implicit_procedure)) {
-            auto temp = "__i" + std::to_string(std::rand());
-            auto temp2 = "__t" + std::to_string(std::rand());
+            auto temp = temporary("__i");
+            auto temp2 = temporary("__t");
             auto iterator_name = emit(iterating_procedure->return_type_expression()->annotation().type);
+            // iteration ends when `next` returns the alternative `none`
+            auto iterator_procedure = checker_.is_iterator(std::static_pointer_cast<ast::function_type>(iterating_procedure->annotation().type)->result());
+            auto variant = std::static_pointer_cast<ast::variant_type>(std::static_pointer_cast<ast::function_type>(iterator_procedure->annotation().type)->result());
+            auto none = variant->tag(checker_.scopes().at(checker_.compilation().workspaces().at("core").get())->type("none")->annotation().type);
             output_.line() << "auto " << temp << " = " << fullname(iterating_procedure) << "(";
             expr.condition()->accept(*this);
             output_.stream() << ");\n";
             output_.line() << "auto " << temp2 << " = " << iterator_name << "_next(&" << temp << ");\n";
-            output_.line() << "for (; " << temp2 << ".__tag != " << std::hash<std::string>()(checker_.scopes().at(checker_.compilation().workspaces().at("core").get())->type("none")->annotation().type->string()) << "u; " << temp2 << " = " << iterator_name << "_next(&" << temp << ")) {\n";
+            output_.line() << "for (; " << temp2 << "." << tag(variant) << " != " << none << "; " << temp2 << " = " << iterator_name << "_next(&" << temp << ")) {\n";
             {
                 struct guard inner(output_);
-                output_.line() <<  emit(expr.variable()->annotation().type, std::dynamic_pointer_cast<ast::var_declaration>(expr.variable())->name().lexeme().string()) << " = " << temp2 << "._" << std::hash<std::string>()(expr.variable()->annotation().type->string()) << ";\n";
+                output_.line() <<  emit(expr.variable()->annotation().type, std::dynamic_pointer_cast<ast::var_declaration>(expr.variable())->name().lexeme().string()) << " = " << temp2 << "._" << expr.variable()->annotation().type->hash() << ";\n";
                 expr.body()->accept(*this);
             }
             output_.line() << "}\n";
             if (expr.else_body()) {
-                output_.line() << "if (" << temp2 << ".__tag == " << std::hash<std::string>()(checker_.scopes().at(checker_.compilation().workspaces().at("core").get())->type("none")->annotation().type->string()) << "u) {\n";
+                output_.line() << "if (" << temp2 << "." << tag(variant) << " == " << none << ") {\n";
                 expr.else_body()->accept(*this);
                 output_.line() << "}\n";
             }
             return;
         }
         
+        auto var = std::static_pointer_cast<ast::var_declaration>(expr.variable());
+        auto varname = var->name().lexeme().string();
+        // without else body the loop has a canonical shape, whose induction variable is local to the loop
+        bool canonical = !expr.else_body();
+
         switch (expr.condition()->annotation().type->category()) {
         case ast::type::category::range_type:
         {
             output_.line() << "{\n";
-            auto varname = std::dynamic_pointer_cast<ast::var_declaration>(expr.variable())->name().lexeme().string();
-            auto temp = "__i" + std::to_string(std::rand());
-            output_.line() << "auto " << temp << " = ";
-            expr.condition()->accept(*this);
-            output_.stream() << ".max();\n";
-            expr.variable()->accept(*this);
-            output_.stream() << " = ";
-            expr.condition()->accept(*this);
-            output_.stream() << ".min();\n";
-            output_.line() << "for (; " << varname;
-            if (std::dynamic_pointer_cast<ast::range_type>(expr.condition()->annotation().type)->is_open()) output_.stream() << "< ";
-            else output_.stream() << " <= ";
-            output_.stream() << temp << "; ++" << varname << ") {\n";
-            emit_in_contracts(expr);
-            expr.body()->accept(*this);
-            emit_out_contracts(expr);
-            output_.line() << "}\n";
-            if (expr.else_body()) {
-                output_.line() << "if (" << varname << " >= ";
+            {
+                struct guard outer(output_);
+                // bounds are evaluated once
+                auto range = temporary("__r");
+                auto temp = temporary("__i");
+                output_.line() << "auto " << range << " = ";
                 expr.condition()->accept(*this);
-                output_.stream() << ".max()) {\n";
-                expr.else_body()->accept(*this);
+                output_.stream() << ";\n";
+                output_.line() << "auto " << temp << " = " << range << ".max();\n";
+                emit_hoisted_contracts(expr.contracts());
+                if (canonical) output_.line() << "for (" << emit(var->annotation().type, varname) << " = " << range << ".min(); " << varname;
+                else {
+                    output_.line() << emit(var->annotation().type, varname) << " = " << range << ".min();\n";
+                    output_.line() << "for (; " << varname;
+                }
+                if (std::dynamic_pointer_cast<ast::range_type>(expr.condition()->annotation().type)->is_open()) output_.stream() << " < ";
+                else output_.stream() << " <= ";
+                output_.stream() << temp << "; ++" << varname << ") {\n";
+                emit_in_contracts(expr);
+                expr.body()->accept(*this);
+                emit_out_contracts(expr);
                 output_.line() << "}\n";
+                if (expr.else_body()) {
+                    output_.line() << "if (" << varname << " >= " << temp << ") {\n";
+                    expr.else_body()->accept(*this);
+                    output_.line() << "}\n";
+                }
             }
             output_.line() << "}\n";
             break;
 
         }
         case ast::type::category::array_type:
-        {
-            auto temp = "__i" + std::to_string(std::rand());
-            output_.line() << "std::size_t " << temp << " = 0;\n";
-            output_.line() << "for (; " << temp << " < " << std::static_pointer_cast<ast::array_type>(expr.condition()->annotation().type)->size() << "ull; ++" << temp << ") {\n";
-            {
-                struct guard inner(output_);
-                expr.variable()->accept(*this);
-                output_.stream() << " = ";
-                expr.condition()->accept(*this);
-                output_.stream() << "[" << temp << "];\n";
-            }
-            emit_in_contracts(expr);
-            expr.body()->accept(*this);
-            emit_out_contracts(expr);
-            output_.line() << "}\n";
-            if (expr.else_body()) {
-                output_.line() << "if (" << temp << " >= " << std::static_pointer_cast<ast::array_type>(expr.condition()->annotation().type)->size() << "ull) {\n";
-                expr.else_body()->accept(*this);
-                output_.line() << "}\n";
-            }
-            break;
-        }
         case ast::type::category::slice_type:
         {
-            auto temp = "__i" + std::to_string(std::rand());
-            output_.line() << "std::size_t " << temp << " = 0;\n";
-            output_.line() << "for (; " << temp << " < __get_size(";
-            expr.condition()->accept(*this);
-            output_.stream() << "); ++" << temp << ") {\n";
+            auto element = var->annotation().type;
+            auto collection = temporary("__c");
+            auto temp = temporary("__i");
+            auto size = temporary("__n");
+            // an immutable loop variable is bound to the element itself, unless its copy is cheaper, its address may outlive the iteration 
+            // or the collection may be written by the body
+            bool reference = !var->is_mutable() && !var->annotation().addressed && !checker_.escaping(var.get()) && (by_reference(element) || element->category() == ast::type::category::array_type) && readonly(*expr.condition());
+            
+            output_.line() << "{\n";
             {
-                struct guard inner(output_);
-                expr.variable()->accept(*this);
-                output_.stream() << " = ";
-                expr.condition()->accept(*this);
-                output_.stream() << "[" << temp << "];\n";
-            }
-            expr.body()->accept(*this);
-            output_.line() << "}\n";
-            if (expr.else_body()) {
-                output_.line() << "if (" << temp << " >= __get_size(";
-                expr.condition()->accept(*this);
-                output_.stream() << ")) {\n";
-                expr.else_body()->accept(*this);
+                struct guard outer(output_);
+                // collection is evaluated once, an array is bound by reference while a slice is copied as a view
+                if (expr.condition()->annotation().type->category() == ast::type::category::array_type) {
+                    output_.line() << "auto&& " << collection << " = ";
+                    expr.condition()->accept(*this);
+                    output_.stream() << ";\n";
+                    output_.line() << "constexpr std::size_t " << size << " = " << std::static_pointer_cast<ast::array_type>(expr.condition()->annotation().type)->size() << "ull;\n";
+                }
+                else {
+                    output_.line() << "auto " << collection << " = ";
+                    expr.condition()->accept(*this);
+                    output_.stream() << ";\n";
+                    output_.line() << "std::size_t " << size << " = " << collection << ".size();\n";
+                }
+                emit_hoisted_contracts(expr.contracts());
+                
+                if (canonical) output_.line() << "for (std::size_t " << temp << " = 0; " << temp << " < " << size << "; ++" << temp << ") {\n";
+                else {
+                    output_.line() << "std::size_t " << temp << " = 0;\n";
+                    output_.line() << "for (; " << temp << " < " << size << "; ++" << temp << ") {\n";
+                }
+                {
+                    struct guard inner(output_);
+                    // index is always inside bounds
+                    if (reference && element->category() == ast::type::category::array_type) output_.line() << "const " << emit(element, "(&" + varname + ")");
+                    else if (reference) output_.line() << "const " << emit(element) << "& " << varname;
+                    else output_.line() << emit(element, varname);
+                    if (expr.condition()->annotation().type->category() == ast::type::category::array_type) output_.stream() << " = " << collection << "[" << temp << "];\n";
+                    else output_.stream() << " = " << collection << ".data()[" << temp << "];\n";
+                }
+                emit_in_contracts(expr);
+                expr.body()->accept(*this);
+                emit_out_contracts(expr);
                 output_.line() << "}\n";
+                if (expr.else_body()) {
+                    output_.line() << "if (" << temp << " >= " << size << ") {\n";
+                    expr.else_body()->accept(*this);
+                    output_.line() << "}\n";
+                }
             }
+            output_.line() << "}\n";
             break;
         }
         default:
@@ -2486,8 +3526,10 @@ namespace nemesis {
             return;
         }
 
+        emit_hoisted_contracts(expr.contracts());
+
         if (expr.condition()) {
-            auto temp = "__c" + std::to_string(std::rand());
+            auto temp = temporary("__c");
             output_.line() << "bool " << temp << " = true;\n";
             output_.line() << "while ((" << temp << " = ";
             expr.condition()->accept(*this);
@@ -2522,7 +3564,7 @@ namespace nemesis {
 
         output_.stream() << "if (";
         expr.condition()->accept(*this);
-        output_.stream() << ".__tag == " << std::to_string(std::hash<std::string>()(expr.type_expression()->annotation().type->string())) << "ull) {\n";
+        output_.stream() << "." << tag(expr.condition()->annotation().type) << " == " << std::static_pointer_cast<ast::variant_type>(expr.condition()->annotation().type)->tag(expr.type_expression()->annotation().type) << ") {\n";
         expr.body()->accept(*this);
         output_.line() << "}\n";
         if (expr.else_body()) {
@@ -2554,6 +3596,318 @@ namespace nemesis {
         }
     }
 
+    std::string code_generator::exit_from(const ast::node* loop)
+    {
+        if (loop && !loop_exits_.empty() && loop_exits_.top().loop == loop) {
+            loop_exits_.top().taken = true;
+            return "goto " + loop_exits_.top().label;
+        }
+
+        return "break";
+    }
+
+    void code_generator::emit_subpatterns(const ast::expression* condition)
+    {
+        auto binary = dynamic_cast<const ast::binary_expression*>(condition);
+
+        if (binary && binary->binary_operator().kind() == token::kind::amp_amp) {
+            if (_tag_test(binary->left().get())) {
+                binary->right()->accept(*this);
+                return;
+            }
+            output_.stream() << "(";
+            emit_subpatterns(binary->left().get());
+            output_.stream() << ") && (";
+            binary->right()->accept(*this);
+            output_.stream() << ")";
+        }
+        else if (binary && binary->binary_operator().kind() == token::kind::line_line) {
+            output_.stream() << "(";
+            emit_subpatterns(binary->left().get());
+            output_.stream() << ") || (";
+            emit_subpatterns(binary->right().get());
+            output_.stream() << ")";
+        }
+        else condition->accept(*this);
+    }
+
+    bool code_generator::emit_decision_tree(const ast::when_expression& expr)
+    {
+        // leading branches whose patterns test the whole value against integer keys or variant tags are dispatched
+        // by a switch or by a binary search, while remaining branches are tested in order as a fallback chain
+        std::vector<const ast::pattern_test*> tests;
+
+        for (auto& branch : expr.branches()) {
+            auto pattern = std::dynamic_pointer_cast<ast::pattern_expression>(branch.pattern());
+            if (!pattern) break;
+            auto& test = pattern->test();
+            if (test.kind != ast::pattern_test::kind::values && test.kind != ast::pattern_test::kind::alternative) break;
+            if (!tests.empty() && tests.front()->kind != test.kind) break;
+            tests.push_back(&test);
+        }
+
+        if (tests.size() < 2) return false;
+
+        auto type = expr.condition()->annotation().type;
+        bool by_tag = tests.front()->kind == ast::pattern_test::kind::alternative;
+
+        if (by_tag && type->category() != ast::type::category::variant_type) return false;
+        else if (!by_tag) {
+            switch (type->category()) {
+            case ast::type::category::integer_type:
+                if (!impl::cpp_builtins.count(type->canonical())) return false;
+                break;
+            case ast::type::category::char_type:
+            case ast::type::category::bool_type:
+                break;
+            default:
+                return false;
+            }
+        }
+        // breaks from the loop enclosing the switch jump to its exit after the switch
+        const ast::node* loop = nullptr;
+        auto scope = checker_.scopes().find(expr.branches().front().body().get());
+        if (scope != checker_.scopes().end()) loop = scope->second->outscope(environment::kind::loop);
+        auto suffix = std::to_string(temporaries_++);
+        loop_exits_.push({ loop, "__break" + suffix, false });
+
+        bool has_fallback = tests.size() < expr.branches().size() || expr.else_body();
+        auto fallback = [&] () {
+            if (tests.size() == expr.branches().size()) {
+                expr.else_body()->accept(*this);
+                return;
+            }
+
+            guard inner(output_);
+
+            for (std::size_t i = tests.size(); i < expr.branches().size(); ++i) {
+                auto& branch = expr.branches().at(i);
+                auto condition = std::dynamic_pointer_cast<ast::pattern_expression>(branch.pattern())->compiled();
+                // arm without condition matches any value, so its body is emitted directly and next arms are never reached
+                if (!condition) {
+                    if (i > tests.size()) {
+                        output_.line() << "else {\n";
+                        branch.body()->accept(*this);
+                        output_.line() << "}\n";
+                    }
+                    else branch.body()->accept(*this);
+                    return;
+                }
+                output_.line() << (i > tests.size() ? "else if (" : "if (");
+                condition->accept(*this);
+                output_.stream() << ") {\n";
+                branch.body()->accept(*this);
+                output_.line() << "}\n";
+            }
+
+            if (expr.else_body()) {
+                output_.line() << "else {\n";
+                expr.else_body()->accept(*this);
+                output_.line() << "}\n";
+            }
+        };
+
+        if (by_tag) {
+            // arms are grouped by alternative preserving their order, since different tags exclude each other,
+            // then the remaining subpatterns of the alternative are tested by compiled conditions
+            std::vector<std::pair<ast::pointer<ast::type>, std::vector<std::size_t>>> alternatives;
+            
+            for (std::size_t i = 0; i < tests.size(); ++i) {
+                auto found = std::find_if(alternatives.begin(), alternatives.end(), [&] (const std::pair<ast::pointer<ast::type>, std::vector<std::size_t>>& alternative) { return alternative.first->hash() == tests.at(i)->alternative->hash(); });
+                if (found != alternatives.end()) found->second.push_back(i);
+                else alternatives.push_back({ tests.at(i)->alternative, { i } });
+            }
+
+            output_.stream() << "switch ((";
+            expr.condition()->accept(*this);
+            output_.stream() << ")." << tag(type) << ") {\n";
+
+            for (auto alternative : alternatives) {
+                output_.line() << "case " << std::static_pointer_cast<ast::variant_type>(type)->tag(alternative.first) << ": {\n";
+                {
+                    guard inner(output_);
+                    unsigned count = 0;
+                    bool exhaustive = false;
+                    for (auto i : alternative.second) {
+                        auto& branch = expr.branches().at(i);
+                        auto condition = std::dynamic_pointer_cast<ast::pattern_expression>(branch.pattern())->compiled();
+                        // tag is already selected by the switch, so an arm without subpatterns always matches and hides next ones
+                        if (!condition || _tag_test(condition.get())) {
+                            if (count > 0) {
+                                output_.line() << "else {\n";
+                                branch.body()->accept(*this);
+                                output_.line() << "}\n";
+                            }
+                            else branch.body()->accept(*this);
+                            exhaustive = true;
+                            break;
+                        }
+                        output_.line() << (count++ > 0 ? "else if (" : "if (");
+                        emit_subpatterns(condition.get());
+                        output_.stream() << ") {\n";
+                        branch.body()->accept(*this);
+                        output_.line() << "}\n";
+                    }
+                    if (has_fallback && !exhaustive) output_.line() << "else goto __otherwise" << suffix << ";\n";
+                }
+                output_.line() << "}\n";
+                output_.line() << "break;\n";
+            }
+
+            if (has_fallback) {
+                output_.line() << "default:\n";
+                output_.line() << "__otherwise" << suffix << ": {\n";
+                fallback();
+                output_.line() << "}\n";
+            }
+
+            output_.line() << "}\n";
+        }
+        else {
+            // values are split into disjoint pieces, each one owned by the first arm which matches it
+            struct piece { std::uint64_t low, high; std::size_t arm; };
+            std::vector<std::uint64_t> bounds;
+            std::vector<piece> pieces;
+
+            for (auto test : tests) {
+                for (auto interval : test->intervals) {
+                    bounds.push_back(interval.first);
+                    if (interval.second < std::numeric_limits<std::uint64_t>::max()) bounds.push_back(interval.second + 1);
+                }
+            }
+
+            std::sort(bounds.begin(), bounds.end());
+            bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+            for (std::size_t i = 0; i < bounds.size(); ++i) {
+                std::uint64_t low = bounds.at(i), high = i + 1 < bounds.size() ? bounds.at(i + 1) - 1 : std::numeric_limits<std::uint64_t>::max();
+                for (std::size_t arm = 0; arm < tests.size(); ++arm) {
+                    auto contained = std::any_of(tests.at(arm)->intervals.begin(), tests.at(arm)->intervals.end(), [&] (const std::pair<std::uint64_t, std::uint64_t>& interval) { return interval.first <= low && high <= interval.second; });
+                    if (!contained) continue;
+                    if (!pieces.empty() && pieces.back().arm == arm && pieces.back().high + 1 == low) pieces.back().high = high;
+                    else pieces.push_back({ low, high, arm });
+                    break;
+                }
+            }
+
+            bool is_signed = type->category() == ast::type::category::integer_type && std::static_pointer_cast<ast::integer_type>(type)->is_signed();
+            auto literal = [&] (std::uint64_t key) -> std::string {
+                if (type->category() == ast::type::category::bool_type) return key ? "true" : "false";
+                else if (type->category() == ast::type::category::char_type) return std::to_string(key);
+                else if (!is_signed) return std::to_string(key) + "u";
+                else if (key == 0) return "(" + std::to_string(std::numeric_limits<std::int64_t>::min() + 1) + " - 1)";
+                else return std::to_string(static_cast<std::int64_t>(key - (std::uint64_t(1) << 63)));
+            };
+            // few values are enumerated as case labels, otherwise the arm is found by binary search on pieces
+            std::uint64_t count = 0;
+            for (auto piece : pieces) if (count <= 256) count = piece.high - piece.low >= 256 ? 256 + 1 : count + piece.high - piece.low + 1;
+
+            auto cases = [&] () {
+                for (std::size_t arm = 0; arm < tests.size(); ++arm) {
+                    std::ostringstream labels;
+                    if (count <= 256) {
+                        for (auto piece : pieces) {
+                            if (piece.arm != arm) continue;
+                            for (auto key = piece.low; ; ++key) {
+                                labels << (labels.tellp() > 0 ? " " : "") << "case " << literal(key) << ":";
+                                if (key == piece.high) break;
+                            }
+                        }
+                    }
+                    else if (std::any_of(pieces.begin(), pieces.end(), [&] (const piece& piece) { return piece.arm == arm; })) {
+                        labels << "case " << arm << ":";
+                    }
+                    // arms shadowed by previous ones are never taken
+                    if (labels.tellp() <= 0) continue;
+                    output_.line() << labels.str() << " {\n";
+                    expr.branches().at(arm).body()->accept(*this);
+                    output_.line() << "}\n";
+                    output_.line() << "break;\n";
+                }
+
+                if (has_fallback) {
+                    output_.line() << "default: {\n";
+                    fallback();
+                    output_.line() << "}\n";
+                }
+
+                output_.line() << "}\n";
+            };
+
+            if (count <= 256) {
+                output_.stream() << "switch (";
+                if (type->category() == ast::type::category::char_type) output_.stream() << "(";
+                expr.condition()->accept(*this);
+                if (type->category() == ast::type::category::char_type) output_.stream() << ").codepoint";
+                output_.stream() << ") {\n";
+                cases();
+            }
+            else {
+                auto subject = "__when" + suffix;
+                auto arm = "__arm" + suffix;
+                output_.stream() << "{\n";
+                guard inner(output_);
+                output_.line() << "auto " << subject << " = ";
+                if (type->category() == ast::type::category::char_type) output_.stream() << "(";
+                expr.condition()->accept(*this);
+                if (type->category() == ast::type::category::char_type) output_.stream() << ").codepoint";
+                output_.stream() << ";\n";
+                output_.line() << "std::size_t " << arm << " = " << tests.size() << ";\n";
+                // bounds already tested by outer comparisons are not tested again by inner ones
+                std::function<void(std::size_t, std::size_t, std::uint64_t, std::uint64_t)> split = [&] (std::size_t first, std::size_t last, std::uint64_t low, std::uint64_t high) {
+                    if (last - first == 1) {
+                        auto piece = pieces.at(first);
+                        std::string condition;
+                        if (piece.low > low) condition = subject + " >= " + literal(piece.low);
+                        if (piece.high < high) condition += (condition.empty() ? "" : " && ") + subject + " <= " + literal(piece.high);
+                        if (condition.empty()) output_.line() << arm << " = " << piece.arm << ";\n";
+                        else output_.line() << "if (" << condition << ") " << arm << " = " << piece.arm << ";\n";
+                        return;
+                    }
+                    auto middle = first + (last - first) / 2;
+                    output_.line() << "if (" << subject << " < " << literal(pieces.at(middle).low) << ") {\n";
+                    {
+                        guard inner(output_);
+                        split(first, middle, low, pieces.at(middle).low - 1);
+                    }
+                    output_.line() << "}\n";
+                    output_.line() << "else {\n";
+                    {
+                        guard inner(output_);
+                        split(middle, last, pieces.at(middle).low, high);
+                    }
+                    output_.line() << "}\n";
+                };
+                // keys of the tested type are bounded by its size
+                std::uint64_t low = 0, high = std::numeric_limits<std::uint64_t>::max();
+                if (type->category() == ast::type::category::char_type) high = 0x10ffff;
+                else if (auto integer = std::dynamic_pointer_cast<ast::integer_type>(type); integer && integer->bits() < 64) {
+                    if (is_signed) low = (std::uint64_t(1) << 63) - (std::uint64_t(1) << (integer->bits() - 1)), high = (std::uint64_t(1) << 63) + ((std::uint64_t(1) << (integer->bits() - 1)) - 1);
+                    else high = (std::uint64_t(1) << integer->bits()) - 1;
+                }
+                split(0, pieces.size(), low, high);
+                output_.line() << "switch (" << arm << ") {\n";
+                cases();
+            }
+
+            if (count > 256) output_.line() << "}\n";
+        }
+        
+        auto exit = loop_exits_.top();
+        loop_exits_.pop();
+
+        if (exit.taken) {
+            output_.line() << "if (false) {\n";
+            {
+                guard inner(output_);
+                output_.line() << exit.label << ": " << exit_from(exit.loop) << ";\n";
+            }
+            output_.line() << "}\n";
+        }
+
+        return true;
+    }
+
     void code_generator::visit(const ast::when_expression& expr)
     {
         if (emit_if_constant(expr)) return;
@@ -2563,6 +3917,8 @@ namespace nemesis {
             return;
         }
         
+        if (emit_decision_tree(expr)) return;
+
         unsigned i = 0;
 
         for (auto branch : expr.branches()) {
@@ -2586,7 +3942,7 @@ namespace nemesis {
     void code_generator::visit(const ast::function_expression& expr)
     {
         unsigned index = 0;
-        output_.stream() << "__lambda" << workspace_->lambdas.at(&expr) << "::__new(";
+        output_.stream() << closure(&expr) << "::__new(";
         
         for (auto captured : expr.captured()) {
             if (index++ > 0) output_.stream() << ", ";
@@ -2598,10 +3954,6 @@ namespace nemesis {
 
     void code_generator::visit(const ast::expression_statement& stmt)
     {
-        // stack trace update of location
-        output_.stream() << "#if __DEVELOPMENT__\n";
-        output_.line() << "__record.location(" << stmt.range().bline << ", " << stmt.range().bcolumn << ");\n";
-        output_.stream() << "#endif\n";
 
         output_.line();
 
@@ -2632,15 +3984,11 @@ namespace nemesis {
 
     void code_generator::visit(const ast::assignment_statement& stmt)
     {
-        // stack trace update of location
-        output_.stream() << "#if __DEVELOPMENT__\n";
-        output_.line() << "__record.location(" << stmt.range().bline << ", " << stmt.range().bcolumn << ");\n";
-        output_.stream() << "#endif\n";
 
         output_.line();
-        // 1) first of all save assigned value inside temporary variable '__temp...', like 'val __temp... = rhs'
+        // 1) first of all save assigned value inside temporary variable '__v...', like 'val __v... = rhs'
         // this is done in order to compute complex values returned from control structures like if/for/when
-        std::string tempvar = "__temp" + std::to_string(std::rand());
+        std::string tempvar = temporary("__v");
 
         switch (stmt.right()->kind()) {
             case ast::kind::if_expression:
@@ -2657,7 +4005,7 @@ namespace nemesis {
                 break;
             default:
                 output_.stream() << emit(stmt.left()->annotation().type, tempvar) << " = "; 
-                stmt.right()->accept(*this);
+                emit_consumed(*stmt.right());
                 output_.stream() << ";\n";
         }
 
@@ -2667,7 +4015,9 @@ namespace nemesis {
         switch (stmt.assignment_operator().kind()) {
             case token::kind::equal:
                 stmt.left()->accept(*this);
-                output_.stream() << " = " << tempvar;
+                // temporary is not used anymore
+                if (movable(stmt.left()->annotation().type)) output_.stream() << " = std::move(" << tempvar << ")";
+                else output_.stream() << " = " << tempvar;
                 break;
             case token::kind::plus_equal:
                 stmt.left()->accept(*this);
@@ -2716,13 +4066,9 @@ namespace nemesis {
 
     void code_generator::visit(const ast::later_statement& stmt)
     {
-        // stack trace update of location
-        output_.stream() << "#if __DEVELOPMENT__\n";
-        output_.line() << "__record.location(" << stmt.range().bline << ", " << stmt.range().bcolumn << ");\n";
-        output_.stream() << "#endif\n";
 
         // create later block for deferred action
-        output_.line() << "__later _l" << std::rand() << "([&] () { ";
+        output_.line() << "__later " << temporary("_l") << "([&] () { ";
         stmt.expression()->accept(*this);
         output_.stream() << "; });\n";
     }
@@ -2731,10 +4077,6 @@ namespace nemesis {
     {
         // first, before return statement, we must test invariant and ensure contracts, if any
         emit_out_contracts(*stmt.annotation().scope);
-        // stack trace update of location
-        output_.stream() << "#if __DEVELOPMENT__\n";
-        output_.line() << "__record.location(" << stmt.range().bline << ", " << stmt.range().bcolumn << ");\n";
-        output_.stream() << "#endif\n";
 
         if (stmt.expression()) {
             if (types::compatible(types::unit(), stmt.expression()->annotation().type)) {
@@ -2748,7 +4090,7 @@ namespace nemesis {
                 case ast::kind::for_loop_expression:
                 case ast::kind::for_range_expression:
                 {
-                    std::string tempvar = "__temp" + std::to_string(std::rand());
+                    std::string tempvar = temporary("__v");
                     output_.line() << emit(stmt.expression()->annotation().type, tempvar) << ";\n";
                     result_vars.push(tempvar);
                     output_.line();
@@ -2757,9 +4099,14 @@ namespace nemesis {
                     output_.line() << "return " << tempvar;
                     break;
                 }
-                default:
+                case ast::kind::identifier_expression:
+                    // a returned local is already moved or elided by the target compiler
                     output_.line() << "return "; 
                     stmt.expression()->accept(*this);
+                    break;
+                default:
+                    output_.line() << "return "; 
+                    emit_consumed(*stmt.expression());
             }
         }
         else {
@@ -2777,14 +4124,12 @@ namespace nemesis {
     {
         // first, before return statement, we must test invariant and ensure contracts, if any
         emit_out_contracts(*stmt.annotation().scope);
-        // stack trace update of location
-        output_.stream() << "#if __DEVELOPMENT__\n";
-        output_.line() << "__record.location(" << stmt.range().bline << ", " << stmt.range().bcolumn << ");\n";
-        output_.stream() << "#endif\n";
+
+        auto exit = exit_from(checker_.scopes().at(stmt.annotation().scope)->outscope(environment::kind::loop));
 
         if (stmt.expression()) {
             if (types::compatible(types::unit(), stmt.expression()->annotation().type)) {
-                output_.line() << "break";
+                output_.line() << exit;
             }
             else switch (stmt.expression()->kind()) {
                 case ast::kind::if_expression:
@@ -2795,7 +4140,7 @@ namespace nemesis {
                 case ast::kind::for_range_expression:
                 {
                     stmt.expression()->accept(*this);
-                    output_.line() << "break";
+                    output_.line() << exit;
                     break;
                 }
                 default:
@@ -2804,11 +4149,11 @@ namespace nemesis {
                         stmt.expression()->accept(*this);
                         output_.stream() << ";\n";
                     }
-                    output_.line() << "break"; 
+                    output_.line() << exit; 
             }
         }
         else {
-            output_.line() << "break";
+            output_.line() << exit;
         }
 
         output_.stream() << ";\n";
@@ -2818,22 +4163,16 @@ namespace nemesis {
     {
         // first, before return statement, we must test invariant and ensure contracts, if any
         emit_out_contracts(*stmt.annotation().scope);
-        // stack trace update of location
-        output_.stream() << "#if __DEVELOPMENT__\n";
-        output_.line() << "__record.location(" << stmt.range().bline << ", " << stmt.range().bcolumn << ");\n";
-        output_.stream() << "#endif\n";
         output_.line() << "continue;\n";
     }
 
     void code_generator::visit(const ast::contract_statement& stmt)
     {
-        // stack trace update of location
-        output_.stream() << "#if __DEVELOPMENT__\n";
-        output_.line() << "__record.location(" << stmt.range().bline << ", " << stmt.range().bcolumn << ");\n";
-        output_.stream() << "#endif\n";
 
-        output_.line() << "__assert(";
-        stmt.condition()->accept(*this);
-        output_.stream() << ", \"contract failure, be more careful next time, dammit!\", \"" << stmt.range().filename << "\", " << stmt.range().bline << ", " << stmt.range().bcolumn << ");\n";
+        output_.line() << "if (__builtin_expect(!(";
+        // condition evaluated before the loop
+        if (hoisted_.count(&stmt)) output_.stream() << hoisted_.at(&stmt);
+        else stmt.condition()->accept(*this);
+        output_.stream() << "), 0)) __violation(\"contract failure, be more careful next time, dammit!\", " << location(stmt.range()) << ");\n";
     }
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <fstream>
+#include <list>
+#include <sstream>
+
+#include "nemesis/analysis/dependencies.hpp"
+
+namespace nemesis {
+    namespace impl {
+        std::uint64_t fnv1a(const char* data, std::size_t size)
+        {
+            std::uint64_t result = 0xcbf29ce484222325ull;
+
+            for (std::size_t i = 0; i < size; ++i) {
+                result ^= static_cast<unsigned char>(data[i]);
+                result *= 0x100000001b3ull;
+            }
+
+            return result;
+        }
+    }
+
+    void dependencies::depend(const std::string& from, const std::string& to)
+    {
+        if (from != to) edges_[from].insert(to);
+    }
+
+    void dependencies::hash(const std::string& file, utf8::span content)
+    {
+        digests_[file] = impl::fnv1a(content.cdata(), content.size());
+    }
+
+    std::set<std::string> dependencies::affected(const dependencies& previous) const
+    {
+        std::set<std::string> result;
+        // different configuration invalidates everything
+        if (configuration_ != previous.configuration_) {
+            for (auto& digest : digests_) result.insert(digest.first);
+            for (auto& digest : previous.digests_) result.insert(digest.first);
+            return result;
+        }
+        // changed or added files
+        for (auto& digest : digests_) {
+            auto old = previous.digests_.find(digest.first);
+            if (old == previous.digests_.end() || old->second != digest.second) result.insert(digest.first);
+        }
+        // removed files
+        for (auto& digest : previous.digests_) {
+            if (!digests_.count(digest.first)) result.insert(digest.first);
+        }
+        // reverse edges of previous graph, so that dependents of each file are found
+        std::map<std::string, std::set<std::string>> dependents;
+        for (auto& edge : previous.edges_) {
+            for (auto& to : edge.second) dependents[to].insert(edge.first);
+        }
+        // transitive closure from changed files
+        std::list<std::string> pending(result.begin(), result.end());
+
+        while (!pending.empty()) {
+            auto file = pending.front();
+            pending.pop_front();
+            auto found = dependents.find(file);
+            if (found == dependents.end()) continue;
+            for (auto& dependent : found->second) {
+                if (result.insert(dependent).second) pending.push_back(dependent);
+            }
+        }
+
+        return result;
+    }
+
+    void dependencies::merge(const dependencies& other)
+    {
+        for (auto& edge : other.edges_) edges_[edge.first].insert(edge.second.begin(), edge.second.end());
+    }
+
+    bool dependencies::load(const std::string& path)
+    {
+        std::ifstream stream(path);
+
+        if (!stream) return false;
+
+        edges_.clear();
+        digests_.clear();
+        configuration_.clear();
+        // each line is a tab separated record among
+        // i) configuration <key>
+        // ii) digest <hex> <file>
+        // iii) depend <from> <to>
+        for (std::string line; std::getline(stream, line);) {
+            std::istringstream record(line);
+            std::string kind, first, second;
+
+            std::getline(record, kind, '\t');
+            std::getline(record, first, '\t');
+            std::getline(record, second);
+
+            if (kind == "configuration") configuration_ = first;
+            else if (kind == "digest" && !second.empty()) try { digests_[second] = std::stoull(first, nullptr, 16); } catch (std::exception&) { return false; }
+            else if (kind == "depend" && !second.empty()) edges_[first].insert(second);
+            else return false;
+        }
+
+        return true;
+    }
+
+    bool dependencies::save(const std::string& path) const
+    {
+        std::ofstream stream(path);
+
+        if (!stream) return false;
+
+        stream << "configuration\t" << configuration_ << '\n';
+        for (auto& digest : digests_) stream << "digest\t" << std::hex << digest.second << std::dec << '\t' << digest.first << '\n';
+        for (auto& edge : edges_) for (auto& to : edge.second) stream << "depend\t" << edge.first << '\t' << to << '\n';
+
+        return static_cast<bool>(stream);
+    }
+}
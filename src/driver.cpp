@@ -4,10 +4,19 @@
  * This file is the entry point of the nemesis compiler which executes the driver
  * 
  */
+#include <algorithm>
+#include <chrono>
+#include <csignal>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 
 #include "nemesis/driver/driver.hpp"
@@ -88,11 +97,21 @@ namespace nemesis {
                                 "    remove <lib>:            uninstalls a dependency library from current workspace\n"
                                 "    build:                   builds current workspace as an app or library using information from lockfile\n"
                                 "    run [options]:           builds and runs current app if any\n"
-                                "    test:                    executes all library test in the same order in which they are declared"
+                                "    test:                    executes all library test in the same order in which they are declared\n"
+                                "    bench [filter]:          measures all benchmarks, or those whose name contains filter\n"
                                 "options:\n"
                                 "    -tokens:                 prints tokens generated by the tokenizer\n"
                                 "    -ast:                    prints abstract syntax tree generated by the parser and semantic analyzer\n"
                                 "    -trace:                  dumps stack trace if program crashes\n"
+                                "    -profile:                samples the program and writes folded stacks to profile.folded at exit\n"
+                                "    -unity:                  compiles the whole program as a single optimized unit, for release builds\n"
+                                "    -stats:                  prints internal counters of semantic analysis\n"
+                                "    -contracts=<level>:      tests contracts at level `off`, `entry` (preconditions only) or `full`, overriding manifests\n"
+                                "    -baseline=<file>:        compares benchmarks against results saved in file, failing on regressions\n"
+                                "    -save=<file>:            saves results of benchmarks into file as JSON\n"
+                                "    -j=<n>:                  runs n tests at the same time, by default as many as hardware threads\n"
+                                "    -timeout=<seconds>:      kills a test which runs longer than seconds, by default 60\n"
+                                "    -junit=<file>:           writes a JUnit report of tests into file\n"
                                 "    -args:                   specify runtime arguments for program to be run\n"
                                 "    -help:                   prints information about options";
 
@@ -110,6 +129,7 @@ namespace nemesis {
         else if (std::strcmp("clean", argv[1]) == 0) command_ = command::clean;
         else if (std::strcmp("run", argv[1]) == 0) command_ = command::run;
         else if (std::strcmp("test", argv[1]) == 0) command_ = command::test;
+        else if (std::strcmp("bench", argv[1]) == 0) command_ = command::bench;
         else {
             error("I've never heard of command `$` before, idiot.", argv[1]);
             exit_code_ = impl::exit::failure;
@@ -130,6 +150,53 @@ namespace nemesis {
             else if (std::strcmp("-trace", argv[i]) == 0) {
                 options_.set(options::kind::trace);
             }
+            else if (std::strcmp("-profile", argv[i]) == 0) {
+                options_.set(options::kind::profile);
+            }
+            else if (std::strcmp("-unity", argv[i]) == 0) {
+                options_.set(options::kind::unity);
+            }
+            else if (std::strcmp("-stats", argv[i]) == 0) {
+                options_.set(options::kind::stats);
+            }
+            else if (std::strncmp("-contracts=", argv[i], 11) == 0) {
+                // last level wins
+                options_.clear(options::kind::contracts_off);
+                options_.clear(options::kind::contracts_entry);
+                options_.clear(options::kind::contracts_full);
+                if (std::strcmp("off", argv[i] + 11) == 0) options_.set(options::kind::contracts_off);
+                else if (std::strcmp("entry", argv[i] + 11) == 0) options_.set(options::kind::contracts_entry);
+                else if (std::strcmp("full", argv[i] + 11) == 0) options_.set(options::kind::contracts_full);
+                else {
+                    error("contracts level `$` doesn't exist, choose among `off`, `entry` or `full`, idiot.", argv[i] + 11);
+                    exit_code_ = impl::exit::failure;
+                }
+            }
+            else if (std::strncmp("-baseline=", argv[i], 10) == 0) {
+                baseline_ = argv[i] + 10;
+            }
+            else if (std::strncmp("-save=", argv[i], 6) == 0) {
+                save_ = argv[i] + 6;
+            }
+            else if (std::strncmp("-j=", argv[i], 3) == 0) {
+                char* end = nullptr;
+                jobs_ = std::strtoul(argv[i] + 3, &end, 10);
+                if (jobs_ == 0 || *end != '\0') {
+                    error("number of jobs `$` is not a positive number, idiot.", argv[i] + 3);
+                    exit_code_ = impl::exit::failure;
+                }
+            }
+            else if (std::strncmp("-timeout=", argv[i], 9) == 0) {
+                char* end = nullptr;
+                timeout_ = std::strtoul(argv[i] + 9, &end, 10);
+                if (timeout_ == 0 || *end != '\0') {
+                    error("timeout `$` is not a positive number of seconds, idiot.", argv[i] + 9);
+                    exit_code_ = impl::exit::failure;
+                }
+            }
+            else if (std::strncmp("-junit=", argv[i], 7) == 0) {
+                junit_ = argv[i] + 7;
+            }
             else if (std::strcmp("-args", argv[i]) == 0) {
                 for (auto j = i + 1; j < argc; ++j) arguments_.push_back(argv[j]);
                 break;
@@ -168,6 +235,12 @@ namespace nemesis {
                     exit_code_ = impl::exit::failure;
                 }
                 break;
+            case command::bench:
+                if (count > 1) {
+                    error("this command expects at most `1` argument, you gave `$`, idiot.", count);
+                    exit_code_ = impl::exit::failure;
+                }
+                break;
             case command::run:
                 break;
         }
@@ -199,7 +272,7 @@ namespace nemesis {
         if (exit_code_ != impl::exit::success) message(usage);
         // command has been invoked correctly so it is executed
         else if (command_ == command::initialize) init();
-        else if (command_ == command::build || command_ == command::test) build();
+        else if (command_ == command::build || command_ == command::test || command_ == command::bench) build();
         else if (command_ == command::run) run_application();
         else if (command_ == command::clean) clean();
         else if (command_ == command::add) add();
@@ -386,6 +459,9 @@ namespace nemesis {
         std::filesystem::remove(pm::manager::lock_path, code);
         // remove executable if generated
         if (std::filesystem::exists(pm::manager::executable_path, code)) std::filesystem::remove(pm::manager::executable_path, code);
+        // remove information and objects of last build
+        std::filesystem::remove(pm::manager::build_cache_path, code);
+        std::filesystem::remove_all(pm::manager::objects_cache_path, code);
         // all correct
         exit_code_ = impl::exit::success;
     }
@@ -464,6 +540,41 @@ namespace nemesis {
 
     void driver::compile(class compilation& compilation)
     {
+        // error code for file system operations
+        std::error_code code;
+        // level of checking of contracts from command line overrides the one of manifests
+        if (options_.is(options::kind::contracts_off)) compilation.contracts(compilation::package::contracts::off);
+        else if (options_.is(options::kind::contracts_entry)) compilation.contracts(compilation::package::contracts::entry);
+        else if (options_.is(options::kind::contracts_full)) compilation.contracts(compilation::package::contracts::full);
+        // digests of all sources are compared against those of last successful build, where
+        // options and levels of contracts are part of the configuration as they change the generated code
+        class dependencies current, previous;
+        std::string configuration = std::to_string(static_cast<int>(command_)) + " " + std::to_string(options_.raw() & ~static_cast<unsigned>(options::kind::stats));
+        std::map<std::string, int> levels;
+        for (auto package : compilation.packages()) levels.emplace(package.first, static_cast<int>(package.second.contracts));
+        for (auto level : levels) configuration += " " + level.first + ":" + std::to_string(level.second);
+        current.configuration(configuration);
+        for (auto source : source_handler_.sources()) current.hash(source.second->name().string(), source.second->source());
+        for (auto source : source_handler_.cppsources()) current.hash(source.second->name().string(), source.second->source());
+        // files affected by changes are those changed and those which transitively depend on them
+        bool incremental = previous.load(pm::manager::build_cache_path);
+        std::set<std::string> affected;
+        if (incremental) {
+            affected = current.affected(previous);
+            // nothing to do if the application is already up to date, while tests are always executed
+            if (affected.empty() && 
+                (command_ == command::build || command_ == command::run) && 
+                compilation.current().kind == compilation::package::kind::app &&
+                !options_.is(options::kind::tokens) && !options_.is(options::kind::ast) && !options_.is(options::kind::stats) &&
+                std::filesystem::exists(compilation::executable_name, code)) {
+                message("nothing changed since last build, `$` is up to date", compilation::executable_name);
+                exit_code_ = impl::exit::success;
+                return;
+            }
+            else if (!affected.empty()) {
+                message("$ source files are affected by your changes since last build", affected.size());
+            }
+        }
         // for each source file
         // i) it extracts all its tokens
         // ii) builds its syntax tree
@@ -482,7 +593,13 @@ namespace nemesis {
         // semantic checking is performed on all packages, so from all source files are costructed workspaces
         // and definitions inside those are fully analyzed and annotated
         checker checker(compilation);
+        statistics::enable(options_.is(options::kind::stats));
         checker.check();
+        statistics::enable(false);
+        // counters of semantic analysis are printed if option '-stats' is specified
+        if (options_.is(options::kind::stats)) message(statistics::report());
+        // last build information is invalidated until this one succeeds
+        std::filesystem::remove(pm::manager::build_cache_path, code);
         // prints abstract syntax tree
         for (auto source : source_handler_.sources()) {
             source_file& file = *source.second;
@@ -499,15 +616,225 @@ namespace nemesis {
         }
         // no errors so far, we can proceed with code generation, which shouldn't give errors if cpp sources are correct
         code_generator codegen(checker);
-        // trace option will slow down resulting program
+        // trace option lists functions in static tables to resolve stack traces on crash
         codegen.trace(options_.is(options::kind::trace));
+        // profile option starts a sampler in the program, whose samples are resolved with the same tables
+        codegen.profile(options_.is(options::kind::profile));
+        compilation.profile(options_.is(options::kind::profile));
+        // unity option emits a single compilation unit, so that the optimizer sees the whole program
+        codegen.unity(options_.is(options::kind::unity));
+        compilation.unity(options_.is(options::kind::unity));
         // test mode will generate test main entry point instead of normal entry point
         compilation.test(command_ == command::test);
+        // benchmark mode will generate the harness of benchmarks as entry point, which receives filter and files of results
+        compilation.bench(command_ == command::bench);
+        if (command_ == command::bench) {
+            for (auto arg : arguments_) compilation.argument(arg);
+            if (!baseline_.empty()) compilation.argument("-baseline=" + baseline_);
+            if (!save_.empty()) compilation.argument("-save=" + save_);
+        }
         // generation is launched
         auto targets = codegen.generate();
+        // units of workspaces whose files are not affected by changes may be linked from objects of last build,
+        // unless C++ sources changed, as they are included by any unit
+        compilation.objects(pm::manager::objects_cache_path);
+        if (incremental && !options_.is(options::kind::unity) && std::none_of(source_handler_.cppsources().begin(), source_handler_.cppsources().end(), [&](auto source) { return affected.count(source.second->name().string()); })) {
+            for (auto& target : targets) {
+                auto workspace = compilation.workspaces().find(target.name.substr(0, target.name.size() - std::strlen(".cpp")));
+                if (target.header || workspace == compilation.workspaces().end()) continue;
+                target.reusable = std::none_of(workspace->second->sources.begin(), workspace->second->sources.end(), [&](auto source) { return affected.count(source.first); });
+            }
+        }
         // now compile all targets files and cpp source files to cpp files
         if (!targets.empty() && compilation.build(targets)) exit_code_ = impl::exit::success;
         else exit_code_ = impl::exit::failure;
+        // dependency graph recorded by analysis is saved for next build
+        if (exit_code_ == impl::exit::success) {
+            current.merge(checker.dependencies());
+            std::filesystem::create_directories(pm::manager::cache_path, code);
+            current.save(pm::manager::build_cache_path);
+        }
+        // test executable is run once built
+        if (exit_code_ == impl::exit::success && command_ == command::test) run_tests(compilation);
+    }
+
+    void driver::run_tests(const class compilation& compilation)
+    {
+        struct test {
+            std::string name;
+            std::string file;
+            std::string line;
+            pid_t pid = 0;
+            std::chrono::steady_clock::time_point start;
+            double seconds = 0;
+            int status = 0;
+            bool timeout = false;
+            std::string output;
+        };
+        // error code for file system operations
+        std::error_code code;
+        std::string executable = "./" + std::string(compilation::executable_name);
+        std::vector<test> tests;
+        // test executable lists its tests, one per line as name, file and line separated by tabs
+        if (auto list = popen((executable + " -list").data(), "r")) {
+            char buffer[4096];
+            while (std::fgets(buffer, sizeof(buffer), list)) {
+                std::istringstream line(buffer);
+                test current;
+                std::getline(line, current.name, '\t');
+                std::getline(line, current.file, '\t');
+                std::getline(line, current.line);
+                tests.push_back(current);
+            }
+            if (pclose(list) != 0) exit_code_ = impl::exit::failure;
+        }
+        else exit_code_ = impl::exit::failure;
+
+        if (exit_code_ == impl::exit::failure) {
+            error("I couldn't list tests from `$`, this is extremely weird, f*ck...", executable);
+            std::filesystem::remove(compilation::executable_name, code);
+            return;
+        }
+        // output of each test is redirected to its own file
+        auto logs = std::filesystem::temp_directory_path(code) / ("nemesis-tests-" + std::to_string(getpid()));
+        std::filesystem::create_directories(logs, code);
+
+        unsigned jobs = jobs_ > 0 ? jobs_ : std::max(1u, std::thread::hardware_concurrency());
+        std::size_t next = 0, running = 0, passed = 0;
+        auto begin = std::chrono::steady_clock::now();
+
+        auto finish = [&] (test& current, int status) {
+            current.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - current.start).count();
+            current.status = status;
+            current.pid = 0;
+            auto log = logs / std::to_string(&current - tests.data());
+            std::ifstream stream(log);
+            current.output.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+            std::filesystem::remove(log, code);
+            --running;
+
+            if (!current.timeout && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                ++passed;
+                message("success for '$', pal! It took $ ms", current.name, static_cast<long>(current.seconds * 1000));
+                return;
+            }
+
+            // output of a failed test already tells its failure, unless the test didn't make it to the end
+            if (!current.output.empty()) std::cout << current.output << std::flush;
+
+            if (current.timeout) message("failure for '$', it took more than $ s and I killed it, f*ck...", current.name, timeout_);
+            else if (WIFSIGNALED(status)) message("failure for '$', it was killed by signal $, f*ck...", current.name, WTERMSIG(status));
+            else if (current.output.empty()) message("failure for '$', f*ck...", current.name);
+        };
+
+        // an alarm interrupts the blocking wait when the earliest running test reaches its deadline, so no restart of the wait
+        struct sigaction alarm {}, previous {};
+        alarm.sa_handler = [] (int) {};
+        sigemptyset(&alarm.sa_mask);
+        sigaction(SIGALRM, &alarm, &previous);
+
+        while (next < tests.size() || running > 0) {
+            // spawns new tests as long as there are free workers
+            for (; next < tests.size() && running < jobs; ++next) {
+                auto log = logs / std::to_string(next);
+                tests[next].start = std::chrono::steady_clock::now();
+                tests[next].pid = fork();
+                if (tests[next].pid == 0) {
+                    int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                    if (fd >= 0) {
+                        dup2(fd, STDOUT_FILENO);
+                        dup2(fd, STDERR_FILENO);
+                        close(fd);
+                    }
+                    auto index = std::to_string(next);
+                    execl(executable.data(), executable.data(), "-run", index.data(), nullptr);
+                    _exit(127);
+                }
+                // a test which couldn't be spawned fails without ever occupying a worker
+                else if (tests[next].pid < 0) {
+                    tests[next].pid = 0;
+                    ++running;
+                    finish(tests[next], EXIT_FAILURE << 8);
+                }
+                else ++running;
+            }
+            // every test may have failed to spawn
+            if (running == 0) continue;
+            // tests which are running for too long are killed, they will be collected as finished
+            auto now = std::chrono::steady_clock::now();
+            auto deadline = std::chrono::steady_clock::time_point::max();
+            for (auto& current : tests) {
+                if (current.pid <= 0 || current.timeout) continue;
+                if (now >= current.start + std::chrono::seconds(timeout_)) {
+                    current.timeout = true;
+                    kill(current.pid, SIGKILL);
+                }
+                else deadline = std::min(deadline, current.start + std::chrono::seconds(timeout_));
+            }
+            // wait is bounded by the earliest deadline, while the alarm fires again in case it went off before the wait started
+            struct itimerval timer {};
+            if (deadline != std::chrono::steady_clock::time_point::max()) {
+                auto wait = std::max<long long>(1, std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count());
+                timer.it_value.tv_sec = wait / 1000000;
+                timer.it_value.tv_usec = wait % 1000000;
+                timer.it_interval.tv_usec = 10000;
+            }
+            setitimer(ITIMER_REAL, &timer, nullptr);
+            // collects a finished test, unless the wait was interrupted by a deadline
+            int status = 0;
+            pid_t pid = waitpid(-1, &status, 0);
+            timer = {};
+            setitimer(ITIMER_REAL, &timer, nullptr);
+            if (pid > 0) {
+                auto current = std::find_if(tests.begin(), tests.end(), [pid] (const test& test) { return test.pid == pid; });
+                if (current != tests.end()) finish(*current, status);
+            }
+        }
+
+        sigaction(SIGALRM, &previous, nullptr);
+
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::filesystem::remove_all(logs, code);
+        std::filesystem::remove(compilation::executable_name, code);
+
+        if (!tests.empty()) message("you passed $ out of $ tests in $ ms with $ workers! $", passed, tests.size(), static_cast<long>(seconds * 1000), jobs, passed < (float) tests.size() / 2 ? "You could have done better, try again, pal. 😑" : "Not bad! 💪");
+        // report in JUnit format for continuous integration
+        if (!junit_.empty()) {
+            auto escape = [] (const std::string& text) {
+                std::string result;
+                for (auto c : text) {
+                    switch (c) {
+                        case '&': result += "&amp;"; break;
+                        case '<': result += "&lt;"; break;
+                        case '>': result += "&gt;"; break;
+                        case '"': result += "&quot;"; break;
+                        default: result += c;
+                    }
+                }
+                return result;
+            };
+
+            std::ofstream report(junit_);
+            report << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+            report << "<testsuite name=\"" << escape(compilation.current().name) << "\" tests=\"" << tests.size() << "\" failures=\"" << tests.size() - passed << "\" time=\"" << seconds << "\">\n";
+            for (auto& current : tests) {
+                report << "    <testcase name=\"" << escape(current.name) << "\" classname=\"" << escape(current.file) << "\" file=\"" << escape(current.file) << "\" line=\"" << escape(current.line) << "\" time=\"" << current.seconds << "\"";
+                bool success = !current.timeout && WIFEXITED(current.status) && WEXITSTATUS(current.status) == 0;
+                if (success) {
+                    report << "/>\n";
+                    continue;
+                }
+                report << ">\n        <failure message=\"" << (current.timeout ? "timeout" : WIFSIGNALED(current.status) ? "signal " + std::to_string(WTERMSIG(current.status)) : "failure") << "\"/>\n";
+                report << "        <system-out>" << escape(current.output) << "</system-out>\n";
+                report << "    </testcase>\n";
+            }
+            report << "</testsuite>\n";
+
+            if (!report) error("I couldn't write JUnit report into `$`, idiot.", junit_);
+        }
+
+        exit_code_ = passed == tests.size() && (junit_.empty() || std::filesystem::exists(junit_, code)) ? impl::exit::success : impl::exit::failure;
     }
 }
 
@@ -2,6 +2,7 @@
 #include "nemesis/analysis/checker.hpp"
 #include "nemesis/analysis/type.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 std::ostream& operator<<(std::ostream& os, nemesis::constval val)
@@ -56,6 +57,13 @@ std::ostream& operator<<(std::ostream& os, nemesis::constval val)
                 for (size_t i = 1; i < val.seq.size(); ++i) os << ", " << val.seq.at(i);
                 return os << "]";
             }
+        case nemesis::ast::type::category::structure_type:
+        {
+            auto& fields = std::static_pointer_cast<nemesis::ast::structure_type>(val.type)->fields();
+            os << val.type->string() << " {";
+            for (size_t i = 0; i < val.seq.size() && i < fields.size(); ++i) os << (i > 0 ? ", " : " ") << fields.at(i).name << ": " << val.seq.at(i);
+            return os << " }";
+        }
         default:
             throw std::invalid_argument("constval::operator<<: invalid constant value type " + val.type->string());
     }
@@ -110,6 +118,14 @@ bool operator==(const nemesis::constval& l, const nemesis::constval& r)
                 }
                 return true;
             }
+            case nemesis::ast::type::category::structure_type:
+            {
+                if (!nemesis::types::compatible(l.type, r.type) || l.seq.size() != r.seq.size()) throw nemesis::evaluator::error();
+                for (size_t i = 0; i < l.seq.size(); ++i) {
+                    if (!(l.seq.at(i) == r.seq.at(i))) return false;
+                }
+                return true;
+            }
             default:
                 return false;
         }
@@ -131,7 +147,7 @@ namespace nemesis {
         };
 
         struct hash_vector {
-            size_t operator()(const std::vector<constval>& values) const {
+            size_t operator()(const constval::sequence& values) const {
                 if (values.empty()) return 0;
                 size_t hash = values.front().hash();
                 for (size_t i = 1; i < values.size(); ++i) {
@@ -175,6 +191,7 @@ namespace nemesis {
             }
             case nemesis::ast::type::category::tuple_type:
             case nemesis::ast::type::category::array_type:
+            case nemesis::ast::type::category::structure_type:
                 return impl::hash_vector()(this->seq);
             default:
                 throw std::invalid_argument("constval::hash(): invalid constant value type " + this->type->string());
@@ -257,6 +274,11 @@ namespace nemesis {
                     os << "]";
                 }
                 break;
+            case nemesis::ast::type::category::structure_type:
+                os << "record, " << this->type->string() << " {";
+                for (size_t i = 0; i < this->seq.size(); ++i) os << (i > 0 ? ", " : " ") << this->seq.at(i).description();
+                os << " }";
+                break;
             default:
                 throw std::invalid_argument("constval::operator<<: invalid constant value type " + this->type->string());
         }
@@ -330,6 +352,11 @@ namespace nemesis {
                     os << "]";
                 }
                 break;
+            case nemesis::ast::type::category::structure_type:
+                os << this->type->string() << " {";
+                for (size_t i = 0; i < this->seq.size(); ++i) os << (i > 0 ? ", " : " ") << this->seq.at(i).simple();
+                os << " }";
+                break;
             default:
                 throw std::invalid_argument("constval::simple: invalid constant value type " + this->type->string());
         }
@@ -494,6 +521,7 @@ namespace nemesis {
     constval evaluator::evaluate(ast::pointer<ast::expression> expr)
     {
         constval result;
+        statistics::evaluation timer;
 
         try {
             expr->accept(*this);
@@ -505,6 +533,9 @@ namespace nemesis {
         catch (evaluator::generic_evaluation& g) {
             throw;
         }
+        catch (evaluator::exhausted& e) {
+            exhaustion(*expr, e, "constant expression");
+        }
 
         return result;
     }
@@ -722,6 +753,299 @@ namespace nemesis {
         }
     }
 
+    void evaluator::step()
+    {
+        if (++steps_ > max_steps) throw evaluator::exhausted { evaluator::exhausted::budget::steps };
+    }
+
+    void evaluator::allocate(std::size_t elements)
+    {
+        memory_ += elements;
+        if (memory_ > max_memory) throw evaluator::exhausted { evaluator::exhausted::budget::memory };
+    }
+
+    void evaluator::exhaustion(const ast::expression& expr, exhausted signal, const std::string& subject)
+    {
+        switch (signal.reason) {
+            case evaluator::exhausted::budget::steps:
+                checker_.error(expr.range(), diagnostic::format("I gave up evaluating this $ at compile time after $ steps, idiot!", subject, max_steps), "Only terminating computations within the budget of compile time evaluation can be used inside constant expressions.", "too many steps");
+                break;
+            case evaluator::exhausted::budget::memory:
+                checker_.error(expr.range(), diagnostic::format("This $ allocates more than $ elements at compile time, idiot!", subject, max_memory), "Only computations within the budget of compile time evaluation can be used inside constant expressions.", "too much memory");
+                break;
+            case evaluator::exhausted::budget::depth:
+                checker_.error(expr.range(), diagnostic::format("This $ nests more than $ calls at compile time, idiot!", subject, max_depth), "Only computations within the budget of compile time evaluation can be used inside constant expressions.", "too deep");
+                break;
+        }
+    }
+
+    void evaluator::contracts(const ast::node& owner, const ast::pointers<ast::statement>& contracts, bool entry)
+    {
+        // contracts are checked as the code generator does, following the level of the owner's package
+        auto workspace = dynamic_cast<const ast::workspace*>(checker_.scopes().at(&owner)->outscope(environment::kind::workspace));
+        auto level = workspace ? checker_.compilation().package(workspace->package).contracts : compilation::package::contracts::full;
+        auto loop = owner.kind() == ast::kind::for_loop_expression || owner.kind() == ast::kind::for_range_expression;
+
+        if (level == compilation::package::contracts::off) return;
+        // postconditions, invariants and loop contracts are only tested in full mode
+        if ((!entry || loop) && level != compilation::package::contracts::full) return;
+
+        for (auto contract : contracts) {
+            auto stmt = std::static_pointer_cast<ast::contract_statement>(contract);
+            if (entry ? stmt->is_ensure() : stmt->is_require()) continue;
+            // in entry mode only preconditions are tested
+            if (entry && level != compilation::package::contracts::full && !stmt->is_require()) continue;
+            stmt->accept(*this);
+        }
+    }
+
+    bool evaluator::temporary(const ast::expression& expr)
+    {
+        auto binding = dynamic_cast<const ast::var_declaration*>(expr.annotation().referencing);
+        
+        if (!binding || frames_.empty()) return false;
+
+        auto local = frames_.back().locals.find(binding);
+        
+        if (local == frames_.back().locals.end()) return false;
+
+        push(local->second);
+        return true;
+    }
+
+    constval& evaluator::location(const ast::expression& expr)
+    {
+        switch (expr.kind()) {
+            case ast::kind::identifier_expression:
+            {
+                auto local = frames_.back().locals.find(expr.annotation().referencing);
+                if (local != frames_.back().locals.end()) return local->second;
+                break;
+            }
+            case ast::kind::parenthesis_expression:
+                return location(*static_cast<const ast::parenthesis_expression&>(expr).expression());
+            case ast::kind::array_index_expression:
+            {
+                auto& access = static_cast<const ast::array_index_expression&>(expr);
+                constval& array = location(*access.expression());
+                access.index()->accept(*this);
+                constval index = pop();
+                
+                if (array.type->category() != ast::type::category::array_type || index.type->category() != ast::type::category::integer_type) break;
+
+                if (index.u.value() >= array.seq.size()) {
+                    auto diag = diagnostic::builder()
+                                .location(expr.range().begin())
+                                .severity(diagnostic::severity::error)
+                                .small(true)
+                                .message(diagnostic::format("You trying to access element at index $ while array size is $, idiot!", index.u, array.seq.size()))
+                                .highlight(access.index()->range(), "out of range")
+                                .highlight(access.expression()->range(), diagnostic::highlighter::mode::light)
+                                .build();
+                    
+                    checker_.publisher().publish(diag);
+                    throw evaluator::error();
+                }
+
+                return array.seq.modify(index.u.value());
+            }
+            case ast::kind::tuple_index_expression:
+            {
+                auto& access = static_cast<const ast::tuple_index_expression&>(expr);
+                constval& tuple = location(*access.expression());
+                std::size_t index = impl::stoui(access.index().lexeme().string());
+
+                if (tuple.type->category() != ast::type::category::tuple_type || index >= tuple.seq.size()) break;
+
+                return tuple.seq.modify(index);
+            }
+            case ast::kind::member_expression:
+            {
+                auto& access = static_cast<const ast::member_expression&>(expr);
+                constval& record = location(*access.expression());
+                auto member = std::dynamic_pointer_cast<ast::identifier_expression>(access.member());
+
+                if (!member || record.type->category() != ast::type::category::structure_type) break;
+
+                auto name = member->identifier().lexeme().string();
+                auto& fields = std::static_pointer_cast<ast::structure_type>(record.type)->fields();
+                auto field = std::find_if(fields.begin(), fields.end(), [&] (const ast::structure_type::component& field) { return field.name == name; });
+                
+                if (field == fields.end() || record.seq.size() != fields.size()) break;
+
+                return record.seq.modify(field - fields.begin());
+            }
+            default:
+                break;
+        }
+
+        checker_.error(expr.range(), "You can only modify local variables inside functions evaluated at compile time, idiot!", impl::const_expr_explanation);
+        throw evaluator::error();
+    }
+
+    void evaluator::execute(const ast::statement& stmt)
+    {
+        step();
+
+        switch (stmt.kind()) {
+            // constants are already evaluated
+            case ast::kind::null_statement:
+            case ast::kind::const_declaration:
+            case ast::kind::const_tupled_declaration:
+                break;
+            case ast::kind::contract_statement:
+            case ast::kind::expression_statement:
+            case ast::kind::assignment_statement:
+            case ast::kind::return_statement:
+            case ast::kind::break_statement:
+            case ast::kind::continue_statement:
+            case ast::kind::var_declaration:
+                stmt.accept(*this);
+                break;
+            default:
+                checker_.error(stmt.range(), "You cannot use this statement inside a function evaluated at compile time, idiot!", impl::const_expr_explanation);
+                throw evaluator::error();
+        }
+    }
+
+    void evaluator::visit(const ast::expression_statement& stmt)
+    {
+        auto depth = stack_.size();
+        stmt.expression()->accept(*this);
+        while (stack_.size() > depth) stack_.pop();
+    }
+
+    void evaluator::visit(const ast::assignment_statement& stmt)
+    {
+        if (stmt.invalid()) throw evaluator::error();
+
+        constval value;
+
+        if (stmt.assignment_operator().kind() == token::kind::equal) {
+            stmt.right()->accept(*this);
+            value = pop();
+        }
+        // compound assignment is evaluated as the equivalent binary expression
+        else {
+            auto& compound = compounds_[&stmt];
+
+            if (!compound) {
+                enum token::kind binary;
+
+                switch (stmt.assignment_operator().kind()) {
+                    case token::kind::star_star_equal: binary = token::kind::star_star; break;
+                    case token::kind::star_equal: binary = token::kind::star; break;
+                    case token::kind::slash_equal: binary = token::kind::slash; break;
+                    case token::kind::percent_equal: binary = token::kind::percent; break;
+                    case token::kind::plus_equal: binary = token::kind::plus; break;
+                    case token::kind::minus_equal: binary = token::kind::minus; break;
+                    case token::kind::left_left_equal: binary = token::kind::less_less; break;
+                    case token::kind::right_right_equal: binary = token::kind::greater_greater; break;
+                    case token::kind::amp_equal: binary = token::kind::amp; break;
+                    case token::kind::line_equal: binary = token::kind::line; break;
+                    case token::kind::caret_equal: binary = token::kind::caret; break;
+                    default: throw evaluator::error();
+                }
+
+                auto op = token::builder().artificial(true).kind(binary).lexeme(stmt.assignment_operator().lexeme()).location(stmt.assignment_operator().location()).build();
+                compound = ast::create<ast::binary_expression>(stmt.range(), op, stmt.left(), stmt.right());
+                compound->annotation().type = stmt.left()->annotation().type;
+            }
+
+            compound->accept(*this);
+            value = pop();
+        }
+
+        location(*stmt.left()) = convert(value, stmt.left()->annotation().type);
+    }
+
+    void evaluator::visit(const ast::return_statement& stmt)
+    {
+        if (stmt.expression()) {
+            stmt.expression()->accept(*this);
+            signal_ = pop();
+        }
+        else {
+            signal_ = constval();
+            signal_.type = types::unit();
+        }
+
+        throw evaluator::returning();
+    }
+
+    void evaluator::visit(const ast::break_statement& stmt)
+    {
+        if (stmt.expression()) {
+            stmt.expression()->accept(*this);
+            signal_ = pop();
+        }
+        else {
+            signal_ = constval();
+            signal_.type = types::unit();
+        }
+
+        throw evaluator::breaking();
+    }
+
+    void evaluator::visit(const ast::continue_statement& stmt)
+    {
+        throw evaluator::continuing();
+    }
+
+    void evaluator::visit(const ast::contract_statement& stmt)
+    {
+        stmt.condition()->accept(*this);
+        // a violated contract would crash at run-time, so the constant expression is rejected
+        if (!pop().b) {
+            checker_.error(stmt.range(), "This contract is violated by evaluation at compile time, idiot!", "A function can be evaluated at compile time only if its contracts hold for the given arguments.", "contract violated");
+            throw evaluator::error();
+        }
+    }
+
+    void evaluator::visit(const ast::var_declaration& decl)
+    {
+        if (decl.invalid()) throw evaluator::error();
+        // static variables outlive a single call, so they are not allowed
+        if (decl.is_static()) {
+            checker_.error(decl.range(), "You cannot use static variables inside a function evaluated at compile time, idiot!", impl::const_expr_explanation);
+            throw evaluator::error();
+        }
+
+        if (!decl.value()) throw evaluator::error();
+
+        decl.value()->accept(*this);
+        frames_.back().locals[&decl] = convert(pop(), decl.annotation().type);
+    }
+
+    void evaluator::visit(const ast::block_expression& expr)
+    {
+        if (expr.invalid()) throw evaluator::error();
+
+        if (frames_.empty()) {
+            checker_.error(expr.range(), "You cannot use blocks in constant expression, idiot!", impl::const_expr_explanation); 
+            throw evaluator::error();
+        }
+
+        constval result;
+        result.type = types::unit();
+
+        for (auto stmt : expr.statements()) {
+            // value of block is given by its last expression
+            auto exprstmt = std::dynamic_pointer_cast<ast::expression_statement>(stmt);
+
+            if (exprstmt && stmt.get() == expr.exprnode()) {
+                step();
+                exprstmt->expression()->accept(*this);
+                result = pop();
+            }
+            else {
+                execute(*stmt);
+            }
+        }
+
+        push(result);
+    }
+
     void evaluator::visit(const ast::bit_field_type_expression& expr) 
     {
         if (!expr.size().valid) throw evaluator::error();
@@ -897,14 +1221,23 @@ namespace nemesis {
         // if expression was recognized as type name then we don't need to perform any computation
         if (expr.annotation().istype) return;
 
+        // inside a function evaluated at compile time, variables and parameters are read from its frame,
+        // while global variables are rejected as they may change at run-time
+        bool variable = !frames_.empty() && (dynamic_cast<const ast::var_declaration*>(expr.annotation().referencing) || dynamic_cast<const ast::var_tupled_declaration*>(expr.annotation().referencing));
+
+        if (variable) {
+            auto local = frames_.back().locals.find(expr.annotation().referencing);
+            if (local != frames_.back().locals.end()) return push(local->second);
+        }
         // if value was computed by a substitution then there is no need to compute the value as it is stored
-        if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type && expr.annotation().value.type->category() != ast::type::category::generic_type) {
+        else if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type && expr.annotation().value.type->category() != ast::type::category::generic_type) {
             push(expr.annotation().value);
             return;
         }
 
         constval result;
-        const ast::declaration* decl = checker_.resolve_variable({ expr.identifier() });
+        // names inside function bodies are resolved from their annotation, as current scope is the caller's one
+        const ast::declaration* decl = !frames_.empty() && expr.annotation().referencing ? expr.annotation().referencing : checker_.resolve_variable({ expr.identifier() });
 
         if (!decl) throw evaluator::error();
         // cannot compute value of generic constant parameter without substitution
@@ -968,18 +1301,21 @@ namespace nemesis {
         }
         else {
             ast::types types;
+            
+            allocate(expr.elements().size());
+            result.seq.reserve(expr.elements().size());
 
             for (auto element : expr.elements()) {
                 element->accept(*this);
                 constval val = pop();
-                result.seq.push_back(val);
                 types.push_back(val.type);
+                result.seq.push_back(std::move(val));
             }
 
             result.type = types::tuple(types);
         }
 
-        push(result);
+        push(std::move(result));
     }
     
     void evaluator::visit(const ast::array_expression& expr) 
@@ -993,19 +1329,20 @@ namespace nemesis {
             result.type = types::unknown();
         }
         else {
+            allocate(expr.elements().size());
+            result.seq.reserve(expr.elements().size());
             expr.elements().front()->accept(*this);
             constval val = pop();
             result.type = types::array(val.type, expr.elements().size());
-            result.seq.push_back(val);
+            result.seq.push_back(std::move(val));
 
             for (size_t i = 1; i < expr.elements().size(); ++i) {
                 expr.elements().at(i)->accept(*this);
-                constval val = pop();
-                result.seq.push_back(val);
+                result.seq.push_back(pop());
             }
         }
 
-        push(result);
+        push(std::move(result));
     }
 
     void evaluator::visit(const ast::array_sized_expression& expr) 
@@ -1019,10 +1356,12 @@ namespace nemesis {
         expr.size()->accept(*this);
         constval len = pop();
         
+        allocate(len.u.value());
+        result.seq.reserve(len.u.value());
         for (size_t i = 0; i < len.u.value(); ++i) result.seq.push_back(val);
         
         result.type = types::array(val.type, len.u.value());
-        push(result);
+        push(std::move(result));
     }
 
     void evaluator::visit(const ast::parenthesis_expression& expr) 
@@ -1209,6 +1548,14 @@ namespace nemesis {
                         result.type = types::unknown();
                     }
                     break;
+                case ast::type::category::structure_type:
+                {
+                    auto& fields = std::static_pointer_cast<ast::structure_type>(left.type)->fields();
+                    auto field = std::find_if(fields.begin(), fields.end(), [&] (const ast::structure_type::component& field) { return field.name == name; });
+                    if (field != fields.end() && left.seq.size() == fields.size()) result = left.seq.at(field - fields.begin());
+                    else result.type = types::unknown();
+                    break;
+                }
                 default:
                     result.type = types::unknown();
             }
@@ -1383,13 +1730,31 @@ namespace nemesis {
         if (expr.invalid()) throw evaluator::error();
 
         expr.expression()->accept(*this);
-        constval left = pop();
+        push(convert(pop(), expr.annotation().type));
+    }
+
+    constval evaluator::convert(constval left, ast::pointer<ast::type> type)
+    {
         constval result;
 
+        switch (left.type->category()) {
+            case ast::type::category::integer_type:
+            case ast::type::category::rational_type:
+            case ast::type::category::float_type:
+            case ast::type::category::complex_type:
+                break;
+            // other values are left untouched when types are the same
+            default:
+                if (types::compatible(left.type, type)) {
+                    left.type = type;
+                    return left;
+                }
+        }
+
         if (left.type->category() == ast::type::category::integer_type) {
             auto ltype = std::dynamic_pointer_cast<ast::integer_type>(left.type);
-            if (expr.annotation().type->category() == ast::type::category::integer_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(expr.annotation().type);
+            if (type->category() == ast::type::category::integer_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(type);
                 result.type = rtype;
                 if (rtype->is_signed()) {
                     if (ltype->is_signed()) result.i = left.i;
@@ -1402,22 +1767,22 @@ namespace nemesis {
                     result.u.size(rtype->bits());
                 }
             }
-            else if (expr.annotation().type->category() == ast::type::category::rational_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::rational_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::rational_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::rational_type>(type);
                 result.type = rtype;
                 if (ltype->is_signed()) result.r = constval::rational(left.i);
                 else result.r = constval::rational(left.u);
                 result.r.size(rtype->bits());
             }
-            else if (expr.annotation().type->category() == ast::type::category::float_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::float_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::float_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::float_type>(type);
                 result.type = rtype;
                 if (ltype->is_signed()) result.f = constval::real(left.i);
                 else result.f = constval::real(left.u);
                 result.f.size(rtype->bits());
             }
-            else if (expr.annotation().type->category() == ast::type::category::complex_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::complex_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::complex_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::complex_type>(type);
                 result.type = rtype;
                 if (ltype->is_signed()) result.c = constval::complex(left.i);
                 else result.c = constval::complex(left.u);
@@ -1429,26 +1794,26 @@ namespace nemesis {
         }
         else if (left.type->category() == ast::type::category::rational_type) {
             auto ltype = std::dynamic_pointer_cast<ast::rational_type>(left.type);
-            if (expr.annotation().type->category() == ast::type::category::integer_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(expr.annotation().type);
+            if (type->category() == ast::type::category::integer_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(type);
                 result.type = rtype;
                 if (rtype->is_signed()) { result.i.size(rtype->bits()); result.i.value(static_cast<int64_t>(left.r.real().value())); }
                 else { result.u.size(rtype->bits()); result.u.value(static_cast<uint64_t>(left.r.real().value())); }
             }
-            else if (expr.annotation().type->category() == ast::type::category::rational_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::rational_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::rational_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::rational_type>(type);
                 result.type = rtype;
                 result.r = left.r;
                 result.r.size(rtype->bits());
             }
-            else if (expr.annotation().type->category() == ast::type::category::float_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::float_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::float_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::float_type>(type);
                 result.type = rtype;
                 result.f = left.r.real();
                 result.f.size(rtype->bits());
             }
-            else if (expr.annotation().type->category() == ast::type::category::complex_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::complex_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::complex_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::complex_type>(type);
                 result.type = rtype;
                 result.c = constval::complex(left.r.real());
                 result.c.size(rtype->bits());
@@ -1459,26 +1824,26 @@ namespace nemesis {
         }
         else if (left.type->category() == ast::type::category::float_type) {
             auto ltype = std::dynamic_pointer_cast<ast::float_type>(left.type);
-            if (expr.annotation().type->category() == ast::type::category::integer_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(expr.annotation().type);
+            if (type->category() == ast::type::category::integer_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(type);
                 result.type = rtype;
                 result.i.value(static_cast<int64_t>(left.f.value()));
                 result.i.size(rtype->bits());
             }
-            else if (expr.annotation().type->category() == ast::type::category::rational_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::rational_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::rational_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::rational_type>(type);
                 result.type = rtype;
                 result.r = constval::rational(left.f);
                 result.r.size(rtype->bits());
             }
-            else if (expr.annotation().type->category() == ast::type::category::float_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::float_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::float_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::float_type>(type);
                 result.type = rtype;
                 result.f = left.f;
                 result.f.size(rtype->bits());
             }
-            else if (expr.annotation().type->category() == ast::type::category::complex_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::complex_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::complex_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::complex_type>(type);
                 result.type = rtype;
                 result.c = constval::complex(left.f);
                 result.c.size(rtype->bits());
@@ -1489,8 +1854,8 @@ namespace nemesis {
         }
         else if (left.type->category() == ast::type::category::complex_type) {
             auto ltype = std::dynamic_pointer_cast<ast::complex_type>(left.type);
-            if (expr.annotation().type->category() == ast::type::category::integer_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(expr.annotation().type);
+            if (type->category() == ast::type::category::integer_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(type);
                 result.type = rtype;
                 
                 if (rtype->is_signed()) {
@@ -1502,22 +1867,22 @@ namespace nemesis {
                     result.u.size(rtype->bits());
                 }
             }
-            else if (expr.annotation().type->category() == ast::type::category::rational_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::rational_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::rational_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::rational_type>(type);
                 result.type = rtype;
                 constval::integer numerator(rtype->bits() / 2);
                 numerator.value(static_cast<int64_t>(left.c.real().value()));
                 result.r = constval::rational(numerator);
                 result.r.size(rtype->bits());
             }
-            else if (expr.annotation().type->category() == ast::type::category::float_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::float_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::float_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::float_type>(type);
                 result.type = rtype;
                 result.f = left.c.real();
                 result.f.size(rtype->bits());
             }
-            else if (expr.annotation().type->category() == ast::type::category::complex_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::complex_type>(expr.annotation().type);
+            else if (type->category() == ast::type::category::complex_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::complex_type>(type);
                 result.type = rtype;
                 result.c = left.c;
                 result.c.size(rtype->bits());
@@ -1527,8 +1892,8 @@ namespace nemesis {
             }
         }
         else if (left.type->category() == ast::type::category::char_type) {
-            if (expr.annotation().type->category() == ast::type::category::integer_type) {
-                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(expr.annotation().type);
+            if (type->category() == ast::type::category::integer_type) {
+                auto rtype = std::dynamic_pointer_cast<ast::integer_type>(type);
                 result.type = rtype;
                 
                 if (rtype->is_signed()) {
@@ -1545,11 +1910,11 @@ namespace nemesis {
             }
         }
         else if (left.type->category() == ast::type::category::chars_type) {
-            if (expr.annotation().type->category() == ast::type::category::chars_type) {
+            if (type->category() == ast::type::category::chars_type) {
                 result = left;
             }
-            else if (expr.annotation().type->category() == ast::type::category::string_type) {
-                result.type = expr.annotation().type;
+            else if (type->category() == ast::type::category::string_type) {
+                result.type = type;
                 result.s = left.s;
             }
             else {
@@ -1557,11 +1922,11 @@ namespace nemesis {
             }
         }
         else if (left.type->category() == ast::type::category::string_type) {
-            if (expr.annotation().type->category() == ast::type::category::chars_type) {
-                result.type = expr.annotation().type;
+            if (type->category() == ast::type::category::chars_type) {
+                result.type = type;
                 result.s = left.s;
             }
-            else if (expr.annotation().type->category() == ast::type::category::string_type) {
+            else if (type->category() == ast::type::category::string_type) {
                 result = left;
             }
             else {
@@ -1572,7 +1937,7 @@ namespace nemesis {
             result.type = types::unknown();
         }
         
-        push(result);
+        return result;
     }
 
     void evaluator::visit(const ast::binary_expression& expr)
@@ -3139,16 +3504,130 @@ namespace nemesis {
     {
         if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type) return push(expr.annotation().value);
         if (expr.invalid()) throw evaluator::error();
-        checker_.error(expr.range(), "You cannot make function calls in constant expression, idiot!", impl::const_expr_explanation); 
-        throw evaluator::error();
+        // construction of tuples and records
+        if (expr.callee()->annotation().istype) {
+            auto type = expr.callee()->annotation().type;
+            constval result;
+            result.type = type;
+
+            if (auto tuple = std::dynamic_pointer_cast<ast::tuple_type>(type)) {
+                if (tuple->components().size() != expr.arguments().size()) throw evaluator::error();
+                allocate(expr.arguments().size());
+                for (std::size_t i = 0; i < expr.arguments().size(); ++i) {
+                    expr.arguments().at(i)->accept(*this);
+                    result.seq.push_back(convert(pop(), tuple->components().at(i)));
+                }
+            }
+            else if (auto structure = std::dynamic_pointer_cast<ast::structure_type>(type)) {
+                if (!structure->declaration() || structure->fields().size() != expr.arguments().size()) throw evaluator::error();
+                allocate(expr.arguments().size());
+                for (std::size_t i = 0; i < expr.arguments().size(); ++i) {
+                    expr.arguments().at(i)->accept(*this);
+                    result.seq.push_back(convert(pop(), structure->fields().at(i).type));
+                }
+            }
+            else {
+                checker_.error(expr.range(), diagnostic::format("You cannot construct values of type `$` in constant expression, idiot!", type->string()), impl::const_expr_explanation);
+                throw evaluator::error();
+            }
+
+            return push(result);
+        }
+        // only functions with a body which has already been checked can be evaluated at compile time, 
+        // where generic functions are evaluated through their instantiations
+        auto function = dynamic_cast<const ast::function_declaration*>(expr.callee()->annotation().referencing);
+
+        if (!function || function->generic() || function->external || !function->body() || function->invalid() || !function->annotation().resolved || function->parameters().size() != expr.arguments().size()) {
+            checker_.error(expr.range(), "You cannot make function calls in constant expression, idiot!", impl::const_expr_explanation); 
+            throw evaluator::error();
+        }
+        // stub bodies of builtin functions don't tell what their C++ implementation does
+        if (checker_.intrinsic(function)) {
+            checker_.error(expr.range(), diagnostic::format("You cannot evaluate builtin function `$` at compile time, idiot!", function->name().lexeme()), "Builtin and extern functions are implemented in C++ and are only executed at run-time.", "not evaluable");
+            throw evaluator::error();
+        }
+
+        if (frames_.size() >= max_depth) throw evaluator::exhausted { evaluator::exhausted::budget::depth };
+
+        step();
+        // arguments are evaluated inside caller frame
+        frame callee;
+
+        for (std::size_t i = 0; i < expr.arguments().size(); ++i) {
+            expr.arguments().at(i)->accept(*this);
+            callee.locals[function->parameters().at(i).get()] = convert(pop(), function->parameters().at(i)->annotation().type);
+        }
+
+        auto result_type = std::static_pointer_cast<ast::function_type>(function->annotation().type)->result();
+        auto depth = stack_.size();
+        constval result;
+
+        frames_.push_back(std::move(callee));
+
+        try {
+            contracts(*function, function->contracts(), true);
+            
+            try {
+                function->body()->accept(*this);
+                result = pop();
+            }
+            catch (evaluator::returning&) {
+                result = signal_;
+            }
+
+            contracts(*function, function->contracts(), false);
+        }
+        catch (evaluator::exhausted& e) {
+            frames_.pop_back();
+            while (stack_.size() > depth) stack_.pop();
+            if (!frames_.empty()) throw;
+            exhaustion(expr, e, "call");
+            throw evaluator::error();
+        }
+        catch (...) {
+            frames_.pop_back();
+            while (stack_.size() > depth) stack_.pop();
+            throw;
+        }
+
+        frames_.pop_back();
+        while (stack_.size() > depth) stack_.pop();
+
+        if (types::compatible(types::unit(), result_type)) {
+            result = constval();
+            result.type = types::unit();
+        }
+        else {
+            result = convert(result, result_type);
+        }
+
+        push(result);
     }
 
     void evaluator::visit(const ast::record_expression& expr)
     {
         if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type) return push(expr.annotation().value);
         if (expr.invalid()) throw evaluator::error();
-        checker_.error(expr.range(), "You cannot create structures or unions in constant expression, idiot!", impl::const_expr_explanation); 
-        throw evaluator::error();
+
+        auto structure = std::dynamic_pointer_cast<ast::structure_type>(expr.annotation().type);
+        // records are built inside functions evaluated at compile time, where fields are stored in declaration order
+        if (frames_.empty() || !structure || !structure->declaration() || structure->fields().size() != expr.initializers().size()) {
+            checker_.error(expr.range(), "You cannot create structures or unions in constant expression, idiot!", impl::const_expr_explanation); 
+            throw evaluator::error();
+        }
+
+        constval result;
+        result.type = structure;
+        allocate(structure->fields().size());
+
+        for (auto field : structure->fields()) {
+            auto init = std::find_if(expr.initializers().begin(), expr.initializers().end(), [&] (const ast::record_expression::initializer& init) { return field.name == init.field().lexeme().string(); });
+            if (init == expr.initializers().end()) throw evaluator::error();
+            init->value()->accept(*this);
+            result.seq.push_back(convert(pop(), field.type));
+        }
+
+        push(result);
     }
 
     void evaluator::visit(const ast::ignore_pattern_expression& expr)
@@ -3227,16 +3706,63 @@ namespace nemesis {
     {
         if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type) return push(expr.annotation().value);
         if (expr.invalid()) throw evaluator::error();
-        checker_.error(expr.range(), "You cannot use when in constant expression, idiot!", impl::const_expr_explanation); 
-        throw evaluator::error();
+
+        if (frames_.empty()) {
+            checker_.error(expr.range(), "You cannot use when in constant expression, idiot!", impl::const_expr_explanation); 
+            throw evaluator::error();
+        }
+
+        if (temporary(expr)) return;
+        // each pattern was compiled by the checker into a condition on the matched expression
+        for (auto& branch : expr.branches()) {
+            step();
+
+            if (auto condition = std::dynamic_pointer_cast<ast::pattern_expression>(branch.pattern())->compiled()) {
+                condition->accept(*this);
+                constval matched = pop();
+                if (matched.type->category() != ast::type::category::bool_type) throw evaluator::error();
+                if (!matched.b) continue;
+            }
+
+            return branch.body()->accept(*this);
+        }
+
+        if (expr.else_body()) return expr.else_body()->accept(*this);
+
+        constval result;
+        result.type = types::unit();
+        push(result);
     }
 
     void evaluator::visit(const ast::when_pattern_expression& expr)
     {
         if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type) return push(expr.annotation().value);
         if (expr.invalid()) throw evaluator::error();
-        checker_.error(expr.range(), "You cannot use when in constant expression, idiot!", impl::const_expr_explanation); 
-        throw evaluator::error();
+
+        if (frames_.empty()) {
+            checker_.error(expr.range(), "You cannot use when in constant expression, idiot!", impl::const_expr_explanation); 
+            throw evaluator::error();
+        }
+
+        if (temporary(expr)) return;
+
+        step();
+
+        bool matched = true;
+
+        if (auto condition = std::dynamic_pointer_cast<ast::pattern_expression>(expr.pattern())->compiled()) {
+            condition->accept(*this);
+            constval value = pop();
+            if (value.type->category() != ast::type::category::bool_type) throw evaluator::error();
+            matched = value.b;
+        }
+
+        if (matched) return expr.body()->accept(*this);
+        if (expr.else_body()) return expr.else_body()->accept(*this);
+
+        constval result;
+        result.type = types::unit();
+        push(result);
     }
 
     void evaluator::visit(const ast::when_cast_expression& expr)
@@ -3251,23 +3777,180 @@ namespace nemesis {
     {
         if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type) return push(expr.annotation().value);
         if (expr.invalid()) throw evaluator::error();
-        checker_.error(expr.range(), "You cannot use for range in constant expression, idiot!", impl::const_expr_explanation); 
-        throw evaluator::error();
+
+        if (frames_.empty() || expr.annotation().implicit_procedure) {
+            checker_.error(expr.range(), "You cannot use for range in constant expression, idiot!", impl::const_expr_explanation); 
+            throw evaluator::error();
+        }
+
+        if (temporary(expr)) return;
+
+        auto variable = expr.variable().get();
+        auto type = variable->annotation().type;
+        // values taken by the loop variable are precomputed as a sequence of values or as bounds of a range
+        constval::sequence elements;
+        constval first, last;
+        bool inclusive = false, range = false;
+        auto condition = expr.condition();
+
+        while (auto parenthesis = std::dynamic_pointer_cast<ast::parenthesis_expression>(condition)) condition = parenthesis->expression();
+
+        if (auto bounds = std::dynamic_pointer_cast<ast::range_expression>(condition)) {
+            if (!bounds->start() || !bounds->end() || (type->category() != ast::type::category::integer_type && type->category() != ast::type::category::char_type)) {
+                checker_.error(expr.condition()->range(), "You can only iterate over bounded ranges of integers or characters in constant expression, idiot!", impl::const_expr_explanation); 
+                throw evaluator::error();
+            }
+
+            bounds->start()->accept(*this);
+            first = convert(pop(), type);
+            bounds->end()->accept(*this);
+            last = convert(pop(), type);
+            inclusive = bounds->is_inclusive();
+            range = true;
+        }
+        else {
+            expr.condition()->accept(*this);
+            constval iterable = pop();
+
+            if (iterable.type->category() != ast::type::category::array_type) {
+                checker_.error(expr.condition()->range(), "You can only iterate over ranges or arrays in constant expression, idiot!", impl::const_expr_explanation); 
+                throw evaluator::error();
+            }
+
+            elements = iterable.seq;
+        }
+        // number of iterations, computed on unsigned integers to avoid overflow
+        std::uint64_t from = 0, count = elements.size();
+        bool is_signed = range && type->category() == ast::type::category::integer_type && std::static_pointer_cast<ast::integer_type>(type)->is_signed();
+
+        if (range) {
+            std::uint64_t to;
+            if (type->category() == ast::type::category::char_type) { from = first.ch; to = last.ch; }
+            else if (is_signed) { from = static_cast<std::uint64_t>(first.i.value()); to = static_cast<std::uint64_t>(last.i.value()); }
+            else { from = first.u.value(); to = last.u.value(); }
+            bool empty = is_signed ? first.i.value() > last.i.value() || (!inclusive && first.i.value() == last.i.value()) : from > to || (!inclusive && from == to);
+            count = empty ? 0 : to - from + (inclusive ? 1 : 0);
+        }
+
+        auto& locals = frames_.back().locals;
+        bool broken = false;
+        constval result;
+        result.type = types::unit();
+
+        for (std::uint64_t i = 0; i < count; ++i) {
+            step();
+
+            if (range) {
+                constval current = first;
+                if (type->category() == ast::type::category::char_type) current.ch = static_cast<constval::character>(from + i);
+                else if (is_signed) current.i.value(static_cast<std::int64_t>(from + i));
+                else current.u.value(from + i);
+                locals[variable] = current;
+            }
+            else {
+                locals[variable] = convert(elements.at(i), type);
+            }
+
+            contracts(expr, expr.contracts(), true);
+
+            try {
+                expr.body()->accept(*this);
+                pop();
+            }
+            catch (evaluator::continuing&) {}
+            catch (evaluator::breaking&) {
+                contracts(expr, expr.contracts(), false);
+                result = signal_;
+                broken = true;
+                break;
+            }
+            catch (evaluator::returning&) {
+                contracts(expr, expr.contracts(), false);
+                throw;
+            }
+
+            contracts(expr, expr.contracts(), false);
+        }
+
+        if (!broken && expr.else_body()) return expr.else_body()->accept(*this);
+
+        push(result);
     }
         
     void evaluator::visit(const ast::for_loop_expression& expr)
     {
         if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type) return push(expr.annotation().value);
         if (expr.invalid()) throw evaluator::error();
-        checker_.error(expr.range(), "You cannot use for loop in constant expression, idiot!", impl::const_expr_explanation); 
-        throw evaluator::error();
+
+        if (frames_.empty()) {
+            checker_.error(expr.range(), "You cannot use for loop in constant expression, idiot!", impl::const_expr_explanation); 
+            throw evaluator::error();
+        }
+
+        if (temporary(expr)) return;
+
+        constval result;
+        result.type = types::unit();
+
+        for (;;) {
+            step();
+
+            if (expr.condition()) {
+                expr.condition()->accept(*this);
+                constval condition = pop();
+                if (condition.type->category() != ast::type::category::bool_type) throw evaluator::error();
+                if (!condition.b) {
+                    if (expr.else_body()) return expr.else_body()->accept(*this);
+                    break;
+                }
+            }
+
+            contracts(expr, expr.contracts(), true);
+
+            try {
+                expr.body()->accept(*this);
+                pop();
+            }
+            catch (evaluator::continuing&) {}
+            catch (evaluator::breaking&) {
+                contracts(expr, expr.contracts(), false);
+                result = signal_;
+                break;
+            }
+            catch (evaluator::returning&) {
+                contracts(expr, expr.contracts(), false);
+                throw;
+            }
+
+            contracts(expr, expr.contracts(), false);
+        }
+
+        push(result);
     }
         
     void evaluator::visit(const ast::if_expression& expr)
     {
         if (expr.annotation().value.type && expr.annotation().value.type->category() != ast::type::category::unknown_type) return push(expr.annotation().value);
         if (expr.invalid()) throw evaluator::error();
-        checker_.error(expr.range(), "You cannot use if in constant expression, idiot!", impl::const_expr_explanation); 
-        throw evaluator::error();
+
+        if (frames_.empty()) {
+            checker_.error(expr.range(), "You cannot use if in constant expression, idiot!", impl::const_expr_explanation); 
+            throw evaluator::error();
+        }
+
+        if (temporary(expr)) return;
+
+        step();
+        expr.condition()->accept(*this);
+        constval condition = pop();
+
+        if (condition.type->category() != ast::type::category::bool_type) throw evaluator::error();
+        
+        if (condition.b) return expr.body()->accept(*this);
+        if (expr.else_body()) return expr.else_body()->accept(*this);
+
+        constval result;
+        result.type = types::unit();
+        push(result);
     }
 }
@@ -53,6 +53,7 @@ namespace nemesis {
         static const std::string extern_decl_explanation = "An extern block contains prototypes of functions defined in another compilation unit using C application binary interface. Here's an example: \\2 `extern { \\4 // this function is defined in another compilation unit and will have external linkage \\4 memcpy(dest: *[u8], src: *[u8], n: usize) \\2 }`";
         static const std::string var_decl_explanation = "To preserve state you can use variables or constants. Here's the differences: • constants, declared as `const`, are evaluated at compile time and cannot be modified • variables, declared as `val`, are evaluated at run-time and can have different lifetimes \\ When a variable is defined as static then it will live as longer as the program lives, otherwise an automatic variable's lifetime is bounded to its enclosing block. Moreover when a variable is defined as: • `val` then it means it cannot be reassigned and its value cannot be changed • `mutable val` then it may be reassigned and its value may be changed \\ Here's an example: \\2 `// variable whose value may be changed \\2 mutable val person = Person(name: \"John Doe\", age: 35) \\2 // compile-time constant \\2 const SIZE: usize = 2**32 \\2 // tupled variable declaration for destructuring \\2 val (name, age) = people.get(i)`";
         static const std::string test_decl_explanation = "Test are very useful for testing singular units of code. Here's an example: \\2 `// this will be executed in non-release mode for unit testing \\2 test my_test {...}`";
+        static const std::string bench_decl_explanation = "Benchmarks measure how long a block of code takes, which is executed many times. Here's an example: \\2 `// this will be executed by command 'nemesis bench' \\2 bench my_bench { black_box(compute(42)) }`";
         static const std::string source_unit_decl_explanation = "At top level context only certain declarations are allowed, including: • library declaration • use declarations • variable or constant declarations • type declarations (including extend, behaviour and concept) • function declarations • test declaration";
         static const std::string local_decl_explanation = "Inside local context only certain statements are allowed, including: • use declarations • variable or constant declarations • type declarations (excluding behaviour and extend) • function declarations • test declaration • jump declaration (break or continue only inside loop) • expression statements (including if, for, when, blocks and others)";
     }
@@ -1989,6 +1990,9 @@ namespace nemesis {
             case token::kind::test_kw:
                 stmt = test_declaration();
                 break;
+            case token::kind::bench_kw:
+                stmt = bench_declaration();
+                break;
             case token::kind::function_kw:
                 stmt = function_declaration();
                 break;
@@ -3190,6 +3194,21 @@ namespace nemesis {
 
         return nullptr;
     }
+
+    ast::pointer<ast::declaration> parser::bench_declaration()
+    {
+        guard guard(this);
+        state saved = state_;
+
+        if (match(token::kind::bench_kw)) {
+            token name = consume(token::kind::identifier, "name", "You have to give your benchmark a name, don't you think?", impl::bench_decl_explanation);
+            ast::pointer<ast::expression> body = expect(block_expression(), "body", "I expect benchmark block in this place, idiot!", impl::bench_decl_explanation);
+            match(token::kind::semicolon);
+            return ast::create<ast::bench_declaration>(source_range(saved.iter->location(), previous().range().end()), name, body);
+        }
+
+        return nullptr;
+    }
     
     ast::pointer<ast::declaration> parser::source_unit_declaration()
     {
@@ -3259,6 +3278,10 @@ namespace nemesis {
                     decl = test_declaration();
                     statements.push_back(decl);
                     break;
+                case token::kind::bench_kw:
+                    decl = bench_declaration();
+                    statements.push_back(decl);
+                    break;
                 default:
                     expect(decl, "declaration", "I was expecting a declaration here, dumb*ss!", impl::source_unit_decl_explanation);
             }
@@ -3300,6 +3323,7 @@ namespace nemesis {
                 case token::kind::const_kw:
                 case token::kind::val_kw:
                 case token::kind::test_kw:
+                case token::kind::bench_kw:
                     builder.message("You cannot write statements on the same line, pr*ck!")
                            .insertion(source_range(previous().range().end(), 1), ";", "Try dividing statements with `;` on the same line")
                            .highlight(before->range(), diagnostic::highlighter::mode::light)
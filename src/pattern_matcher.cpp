@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <limits>
 
 #include "nemesis/analysis/pattern_matcher.hpp"
 #include "nemesis/analysis/type.hpp"
@@ -67,6 +68,7 @@ namespace nemesis {
             
             try {
                 result.condition = match(pattern_, expression.annotation().type, &expression, expression.clone(), result);
+                result.test = test(pattern_, expression.annotation().type);
             }
             catch (mismatch&) {
                 result.invalidate();
@@ -111,8 +113,9 @@ namespace nemesis {
                             auto field = ast::create<ast::identifier_expression>(source_range(), name, ast::pointers<ast::expression>());
                             auto left = ast::create<ast::member_expression>(source_range(), tree, field);
                             field->annotation().type = left->annotation().type = nemesis::types::usize();
-                            auto typehash = std::to_string(std::hash<std::string>()(pattern->annotation().type->string()));
-                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((typehash + "usize").data()).build()).build();
+                            auto typehash = std::to_string(pattern->annotation().type->hash());
+                            auto ordinal = std::to_string(variant->tag(pattern->annotation().type));
+                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((ordinal + "usize").data()).build()).build();
                             auto right = ast::create<ast::literal_expression>(tag);
                             right->annotation().type = nemesis::types::usize();
                             right->annotation().value = checker_.evaluate(right);
@@ -158,8 +161,8 @@ namespace nemesis {
                             auto field = ast::create<ast::identifier_expression>(source_range(), name, ast::pointers<ast::expression>());
                             auto left = ast::create<ast::member_expression>(source_range(), tree, field);
                             field->annotation().type = left->annotation().type = nemesis::types::usize();
-                            auto typehash = std::to_string(std::hash<std::string>()(pattern->annotation().type->string()));
-                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((typehash + "usize").data()).build()).build();
+                            auto ordinal = std::to_string(variant->tag(pattern->annotation().type));
+                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((ordinal + "usize").data()).build()).build();
                             auto right = ast::create<ast::literal_expression>(tag);
                             right->annotation().type = nemesis::types::usize();
                             right->annotation().value = checker_.evaluate(right);
@@ -217,8 +220,8 @@ namespace nemesis {
                             auto field = ast::create<ast::identifier_expression>(source_range(), name, ast::pointers<ast::expression>());
                             auto left = ast::create<ast::member_expression>(source_range(), tree, field);
                             field->annotation().type = left->annotation().type = nemesis::types::usize();
-                            auto typehash = std::to_string(std::hash<std::string>()(pattern->annotation().type->string()));
-                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((typehash + "usize").data()).build()).build();
+                            auto ordinal = std::to_string(variant->tag(pattern->annotation().type));
+                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((ordinal + "usize").data()).build()).build();
                             auto right = ast::create<ast::literal_expression>(tag);
                             right->annotation().type = nemesis::types::usize();
                             right->annotation().value = checker_.evaluate(right);
@@ -263,8 +266,9 @@ namespace nemesis {
                             auto field = ast::create<ast::identifier_expression>(source_range(), name, ast::pointers<ast::expression>());
                             auto left = ast::create<ast::member_expression>(source_range(), tree, field);
                             field->annotation().type = left->annotation().type = nemesis::types::usize();
-                            auto typehash = std::to_string(std::hash<std::string>()(pattern->annotation().type->string()));
-                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((typehash + "usize").data()).build()).build();
+                            auto typehash = std::to_string(pattern->annotation().type->hash());
+                            auto ordinal = std::to_string(variant->tag(pattern->annotation().type));
+                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((ordinal + "usize").data()).build()).build();
                             auto right = ast::create<ast::literal_expression>(tag);
                             right->annotation().type = nemesis::types::usize();
                             right->annotation().value = checker_.evaluate(right);
@@ -308,8 +312,9 @@ namespace nemesis {
                             auto field = ast::create<ast::identifier_expression>(source_range(), name, ast::pointers<ast::expression>());
                             auto left = ast::create<ast::member_expression>(source_range(), tree, field);
                             field->annotation().type = left->annotation().type = nemesis::types::usize();
-                            auto typehash = std::to_string(std::hash<std::string>()(pattern->annotation().type->string()));
-                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((typehash + "usize").data()).build()).build();
+                            auto typehash = std::to_string(pattern->annotation().type->hash());
+                            auto ordinal = std::to_string(variant->tag(pattern->annotation().type));
+                            auto tag = token::builder().artificial(true).kind(token::kind::integer_literal).lexeme(utf8::span::builder().concat((ordinal + "usize").data()).build()).build();
                             auto right = ast::create<ast::literal_expression>(tag);
                             right->annotation().type = nemesis::types::usize();
                             right->annotation().value = checker_.evaluate(right);
@@ -499,5 +504,154 @@ namespace nemesis {
 
             return nullptr;
         }
+        pattern_test pattern_matcher::test(const ast::expression* pattern, ast::pointer<ast::type> expected) const
+        {
+            pattern_test result;
+
+            if (!pattern || pattern->invalid() || !expected) return result;
+            // keys of integer values preserve their order as unsigned integers, so that
+            // signed values are offset by 2^63 and the bounds are those of the matched type
+            std::uint64_t min = 0, max = 0;
+            bool is_signed = false;
+            switch (expected->category()) {
+            case ast::type::category::integer_type:
+            {
+                auto integer = std::static_pointer_cast<ast::integer_type>(expected);
+                if (integer->bits() > 64) return result;
+                is_signed = integer->is_signed();
+                if (is_signed) {
+                    min = (std::uint64_t(1) << 63) - (std::uint64_t(1) << (integer->bits() - 1));
+                    max = (std::uint64_t(1) << 63) + ((std::uint64_t(1) << (integer->bits() - 1)) - 1);
+                }
+                else {
+                    max = integer->bits() == 64 ? std::numeric_limits<std::uint64_t>::max() : (std::uint64_t(1) << integer->bits()) - 1;
+                }
+                break;
+            }
+            case ast::type::category::char_type:
+                max = 0x10ffff;
+                break;
+            case ast::type::category::bool_type:
+                max = 1;
+                break;
+            default:
+                break;
+            }
+
+            auto keyable = expected->category() == ast::type::category::integer_type || expected->category() == ast::type::category::char_type || expected->category() == ast::type::category::bool_type;
+
+            auto key = [&] (const ast::expression* bound, std::uint64_t& key) {
+                auto expr = from_pattern(bound);
+                if (!expr) return false;
+                constval value = expr->annotation().value;
+                if (!value.type) return false;
+                switch (value.type->category()) {
+                case ast::type::category::integer_type:
+                    if (expected->category() != ast::type::category::integer_type) return false;
+                    if (std::static_pointer_cast<ast::integer_type>(value.type)->is_signed()) {
+                        if (!is_signed && value.i.value() < 0) return false;
+                        key = is_signed ? std::uint64_t(value.i.value()) + (std::uint64_t(1) << 63) : std::uint64_t(value.i.value());
+                    }
+                    else {
+                        if (is_signed && value.u.value() > std::uint64_t(std::numeric_limits<std::int64_t>::max())) return false;
+                        key = is_signed ? value.u.value() + (std::uint64_t(1) << 63) : value.u.value();
+                    }
+                    break;
+                case ast::type::category::char_type:
+                    if (expected->category() != ast::type::category::char_type) return false;
+                    key = value.ch;
+                    break;
+                case ast::type::category::bool_type:
+                    if (expected->category() != ast::type::category::bool_type) return false;
+                    key = value.b ? 1 : 0;
+                    break;
+                default:
+                    return false;
+                }
+                return key >= min && key <= max;
+            };
+
+            auto alternative = [&] () {
+                if (auto variant = std::dynamic_pointer_cast<ast::variant_type>(expected)) {
+                    if (pattern->annotation().type && variant->contains(pattern->annotation().type)) {
+                        result.kind = pattern_test::kind::alternative;
+                        result.alternative = pattern->annotation().type;
+                        return true;
+                    }
+                }
+                return false;
+            };
+
+            switch (pattern->kind()) {
+            case ast::kind::ignore_pattern_expression:
+                result.kind = pattern_test::kind::any;
+                break;
+            case ast::kind::path_pattern_expression:
+            {
+                auto path_pattern = static_cast<const path_pattern_expression*>(pattern);
+                std::uint64_t value;
+                if (path_pattern->path()->kind() == ast::kind::identifier_expression && pattern->annotation().type->category() == ast::type::category::unknown_type) {
+                    result.kind = pattern_test::kind::any;
+                }
+                else if (alternative()) {}
+                else if (keyable && key(pattern, value)) {
+                    result.kind = pattern_test::kind::values;
+                    result.intervals.emplace_back(value, value);
+                }
+                break;
+            }
+            case ast::kind::literal_pattern_expression:
+            {
+                std::uint64_t value;
+                if (alternative()) {}
+                else if (keyable && key(pattern, value)) {
+                    result.kind = pattern_test::kind::values;
+                    result.intervals.emplace_back(value, value);
+                }
+                break;
+            }
+            case ast::kind::record_pattern_expression:
+            case ast::kind::labeled_record_pattern_expression:
+                alternative();
+                break;
+            case ast::kind::range_pattern_expression:
+            {
+                auto range = static_cast<const ast::range_pattern_expression*>(pattern);
+                std::uint64_t start = min, end = max;
+                if (alternative() || !keyable || (!range->start() && !range->end())) break;
+                if (range->start() && !key(range->start().get(), start)) break;
+                if (range->end() && !key(range->end().get(), end)) break;
+                result.kind = pattern_test::kind::values;
+                if (range->end() && !range->is_inclusive()) {
+                    if (end == 0) break;
+                    --end;
+                }
+                if (start <= end) result.intervals.emplace_back(start, end);
+                break;
+            }
+            case ast::kind::or_pattern_expression:
+            {
+                auto or_pattern = static_cast<const ast::or_pattern_expression*>(pattern);
+                auto left = test(or_pattern->left().get(), expected), right = test(or_pattern->right().get(), expected);
+                if (left.kind == pattern_test::kind::any || right.kind == pattern_test::kind::any) {
+                    result.kind = pattern_test::kind::any;
+                }
+                else if (left.kind == pattern_test::kind::values && right.kind == pattern_test::kind::values) {
+                    result = left;
+                    result.intervals.insert(result.intervals.end(), right.intervals.begin(), right.intervals.end());
+                }
+                else if (left.kind == pattern_test::kind::alternative && right.kind == pattern_test::kind::alternative && left.alternative == right.alternative) {
+                    result = left;
+                }
+                break;
+            }
+            case ast::kind::implicit_conversion_expression:
+                return test(static_cast<const ast::implicit_conversion_expression*>(pattern)->expression().get(), expected);
+            default:
+                break;
+            }
+
+            return result;
+        }
     }
-}
\ No newline at end of file
+}
@@ -104,6 +104,12 @@ namespace nemesis {
                                 else if (value == "false") result.builtin = false;
                                 else error("`$` is not a value for `builtin` property, which can be `true` or `false`!", value);
                             }
+                            else if (key == "contracts") {
+                                if (value == "off") result.contracts = compilation::package::contracts::off;
+                                else if (value == "entry") result.contracts = compilation::package::contracts::entry;
+                                else if (value == "full") result.contracts = compilation::package::contracts::full;
+                                else error("`$` is not a value for `contracts` property, which can be `off`, `entry` or `full`!", value);
+                            }
                             else error("`$` is not a valid property for manifest file!", key);
                         }
                     }
@@ -133,6 +139,12 @@ namespace nemesis {
                                 else if (value == "false") result.builtin = false;
                                 else error("`$` is not a value for `builtin` property, which can be `true` or `false`!", value);
                             }
+                            else if (key == "contracts") {
+                                if (value == "off") result.contracts = compilation::package::contracts::off;
+                                else if (value == "entry") result.contracts = compilation::package::contracts::entry;
+                                else if (value == "full") result.contracts = compilation::package::contracts::full;
+                                else error("`$` is not a value for `contracts` property, which can be `off`, `entry` or `full`!", value);
+                            }
                             else error("`$` is not a valid property for manifest file!", key);
                         }
                     }
@@ -263,7 +275,8 @@ namespace nemesis {
             outfile << (manifest.kind == manifest::kind::app ? "@application\n" : "@library\n")
                     << "name '" << manifest.name << "'\n"
                     << "version '" << manifest.version << "'\n"
-                    << "builtin " << (manifest.builtin ? "true" : "false") << "\n";
+                    << "builtin " << (manifest.builtin ? "true" : "false") << "\n"
+                    << "contracts " << (manifest.contracts == compilation::package::contracts::off ? "off" : manifest.contracts == compilation::package::contracts::entry ? "entry" : "full") << "\n";
             // prints dependencies
             outfile << "@dependencies\n";
             for (auto dep : manifest.dependencies) {
@@ -814,10 +827,13 @@ namespace nemesis {
                     cpp_sources.push_back(&cppsource);
                 }
             }
+            // level of checking of contracts is read from package manifest, which is not recorded inside lock file
+            auto contracts = compilation::package::contracts::full;
+            if (std::filesystem::exists(package.path + "/" + manager::manifest_path, code)) contracts = parse_manifest_file(package.path + "/" + manager::manifest_path).contracts;
             // if dependency, then it is added to our compilation
-            if (is_dependency) compilation.dependency(package.name, package.version, sources, cpp_sources, package.builtin);
+            if (is_dependency) compilation.dependency(package.name, package.version, sources, cpp_sources, package.builtin, contracts);
             // current workspace
-            else compilation.current(package.name, package.version, sources, cpp_sources, package.builtin, lockfile.kind == manifest::kind::app ? compilation::package::kind::app : lockfile.kind == manifest::kind::lib ? compilation::package::kind::lib : compilation::package::kind::none);
+            else compilation.current(package.name, package.version, sources, cpp_sources, package.builtin, lockfile.kind == manifest::kind::app ? compilation::package::kind::app : lockfile.kind == manifest::kind::lib ? compilation::package::kind::lib : compilation::package::kind::none, contracts);
         }
 
         compilation manager::build_compilation_chain(pm::lock lockfile) const
@@ -848,7 +864,7 @@ namespace nemesis {
             // loads core manifest for info
             auto manifest = parse_manifest_file(std::string(std::getenv("HOME")).append("/Desktop/nemesis/libcore/nemesis.manifest"));
             // creates the core package
-            compilation.dependency(manifest.name, manifest.version, { &source_handler_.get(source) }, { &source_handler_.get(cppheader), &source_handler_.get(cppsource) }, manifest.builtin);
+            compilation.dependency(manifest.name, manifest.version, { &source_handler_.get(source) }, { &source_handler_.get(cppheader), &source_handler_.get(cppsource) }, manifest.builtin, manifest.contracts);
         }
     }
 }
\ No newline at end of file
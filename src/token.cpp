@@ -117,6 +117,7 @@ namespace nemesis {
             case token::kind::app_kw:
             case token::kind::as_kw:
             case token::kind::behaviour_kw:
+            case token::kind::bench_kw:
             case token::kind::break_kw:
             case token::kind::concept_kw:
             case token::kind::const_kw:
@@ -286,6 +287,7 @@ namespace nemesis {
                 case token::kind::app_kw: return "app_kw";
                 case token::kind::as_kw: return "as_kw";
                 case token::kind::behaviour_kw: return "behaviour_kw";
+                case token::kind::bench_kw: return "bench_kw";
                 case token::kind::break_kw: return "break_kw";
                 case token::kind::concept_kw: return "concept_kw";
                 case token::kind::const_kw: return "const_kw";
@@ -181,6 +181,7 @@ namespace nemesis {
             { utf8::span("app"), token::kind::app_kw },
             { utf8::span("as"), token::kind::as_kw },
             { utf8::span("behaviour"), token::kind::behaviour_kw },
+            { utf8::span("bench"), token::kind::bench_kw },
             { utf8::span("break"), token::kind::break_kw },
             { utf8::span("concept"), token::kind::concept_kw },
             { utf8::span("const"), token::kind::const_kw },
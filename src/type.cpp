@@ -1,6 +1,7 @@
 #include <stdexcept>
 
 #include "nemesis/analysis/type.hpp"
+#include "nemesis/analysis/statistics.hpp"
 
 namespace nemesis {
     constval::constval()
@@ -114,7 +115,7 @@ namespace nemesis {
             return false;
         }
 
-        std::string pointer_type::string(bool absolute) const 
+        std::string pointer_type::describe(bool absolute) const 
         {
             if (base_->category() == ast::type::category::variant_type && !base_->declaration() && std::static_pointer_cast<ast::variant_type>(base_)->types().size() > 1) {
                 return "*{ " + base_->string() + " }";
@@ -184,17 +185,29 @@ namespace nemesis {
         return false;
     }
 
-    void ast::behaviour_type::implements(ast::pointer<ast::type> type) { implementors.insert(type); }
+    std::size_t ast::variant_type::tag(ast::pointer<ast::type> subtype) const
+    {
+        for (std::size_t i = 0; i < types_.size(); ++i) {
+            if (nemesis::types::compatible(subtype, types_.at(i))) return i;
+        }
+
+        return types_.size();
+    }
+
+    void ast::behaviour_type::implements(ast::pointer<ast::type> type) { implementors_.insert(type); }
 
     bool ast::behaviour_type::implementor(ast::pointer<ast::type> type) const
     {
-        for (auto implementor : implementors) {
+        for (auto implementor : implementors_) {
             if (nemesis::types::compatible(type, implementor)) return true;
         }
 
         return false;
     }
     
+    // starts from one so that types which were never memoized are always invalid
+    std::size_t ast::type::generation_ = 1;
+
     ast::types types::others_ {};
 
     std::unordered_map<ast::pointer<ast::type>, std::set<ast::pointer<ast::type>>> types::implementors_ {};
@@ -483,6 +496,8 @@ namespace nemesis {
 
     bool types::compatible(ast::pointer<ast::type> left, ast::pointer<ast::type> right, bool strict)
     {
+        statistics::compatibility();
+
         if (!left || !right || left->category() == ast::type::category::unknown_type || right->category() == ast::type::category::unknown_type) return false;
 
         if (left->category() != right->category()) return false;
@@ -1,6 +1,7 @@
 #include <algorithm>
 
 #include "nemesis/analysis/type_matcher.hpp"
+#include "nemesis/analysis/statistics.hpp"
 
 namespace nemesis {
     namespace ast {
@@ -24,6 +25,8 @@ namespace nemesis {
 
         bool type_matcher::match(ast::pointer<ast::type> expression, result& result, bool variadic_pattern) const
         {
+            statistics::type_matching();
+
             try {
                 auto pattern = parameter::make_type(pattern_);
                 pattern.variadic = variadic_pattern;